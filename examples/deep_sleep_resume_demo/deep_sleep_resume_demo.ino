@@ -0,0 +1,98 @@
+/*
+ * ESP32_AI_Connect - Deep Sleep Resume Demo
+ *
+ * Description:
+ * This example demonstrates saveState() and restoreState(). The board wakes up every minute,
+ * asks the AI for a short status line and goes back to deep sleep. Deep sleep clears the RAM,
+ * so before sleeping the sketch saves the client's settings and conversation history as a
+ * compact binary record in RTC memory, which survives deep sleep. After waking up, one
+ * restoreState() call brings them back, and the AI still knows the earlier exchanges.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit)
+ *
+ * Dependencies:
+ * - ESP32_AI_Connect library (available at https://github.com/AvantMaker/ESP32_AI_Connect)
+ * - ArduinoJson library (version 7.0.0 or higher, available at https://arduinojson.org/)
+ *
+ * Setup Instructions:
+ * 1. Update my_info.h with your WiFi credentials, API key, platform and model
+ * 2. Upload the sketch to your ESP32 board and open the Serial Monitor (115200 baud)
+ *
+ * License: MIT License
+ * Repository: https://github.com/AvantMaker/ESP32_AI_Connect
+ *
+ * Usage Notes:
+ * - RTC memory is small (8 KB on the ESP32, shared with other RTC data). Keep the history
+ *   arena small, or save the state to LittleFS with saveState(file) instead.
+ * - The API key is not part of the saved state; begin() (the constructor here) sets it.
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards
+ */
+
+#include <WiFi.h>
+#include <ESP32_AI_Connect.h>
+#include "my_info.h"  // Contains your WiFi, API key, model, and platform details
+
+#define SLEEP_SECONDS 60
+#define STATE_BUFFER_SIZE 3072
+
+ESP32_AI_Connect aiClient(platform, apiKey, model);
+
+// Kept in RTC memory across deep sleep
+RTC_DATA_ATTR uint8_t stateBuffer[STATE_BUFFER_SIZE];
+RTC_DATA_ATTR size_t stateLength = 0;
+RTC_DATA_ATTR uint32_t wakeCount = 0;
+
+void configureClient() {
+  aiClient.setChatSystemRole("You report on a plant sensor. Answer in one short sentence.");
+  aiClient.setChatMaxTokens(60);
+  aiClient.setChatHistory(2048);             // Small enough for RTC memory
+  aiClient.setChatHistoryTokenBudget(400);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+  wakeCount++;
+
+  // Settings and history come back from RTC memory; on the first boot they are set up once
+  if (stateLength > 0 && aiClient.restoreState(stateBuffer, stateLength)) {
+    Serial.printf("Wake %u: state restored (%u bytes, %u turns)\n", (unsigned)wakeCount,
+                  (unsigned)stateLength, (unsigned)aiClient.getChatHistoryTurnCount());
+  } else {
+    Serial.println("First boot: configuring the client");
+    configureClient();
+  }
+
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(100);
+  }
+
+  int moisture = random(20, 80); // Stands in for a soil moisture reading
+  String reply = aiClient.chat("Soil moisture is now " + String(moisture) +
+                               "%. How does it compare to the earlier readings?");
+  if (reply.isEmpty()) {
+    Serial.println("Error: " + aiClient.getLastError());
+  } else {
+    Serial.println("AI: " + reply);
+  }
+
+  stateLength = aiClient.saveState(stateBuffer, sizeof(stateBuffer));
+  if (stateLength == 0) {
+    Serial.println("Could not save the state: " + aiClient.getLastError());
+  }
+
+  Serial.printf("Sleeping for %d s\n", SLEEP_SECONDS);
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_SECONDS * 1000000ULL);
+  esp_deep_sleep_start();
+}
+
+void loop() {
+  // Never reached: the board restarts from setup() after each deep sleep
+}
@@ -0,0 +1,250 @@
+/*
+ * ESP32_AI_Connect - Handler Benchmark
+ *
+ * Description:
+ * This example measures the platform handlers (OpenAI, DeepSeek, Claude, Gemini) on the
+ * device, without a network connection. Each handler is run against recorded API responses
+ * (see payloads.h) for four operations:
+ *   - build:      building and serializing a chat request body
+ *   - parse:      parsing a complete chat response
+ *   - chunk:      parsing one stream chunk (averaged over a recorded stream)
+ *   - tc_followup: building and serializing a tool calls follow-up request body
+ * For each it prints the time per call in microseconds, the JSON allocations per call, the
+ * peak bytes held by the JSON documents, chunk pool fallbacks and the free heap change.
+ * The output is CSV, so runs of two library versions can be compared side by side before
+ * an upgrade is rolled out.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit, etc.)
+ *
+ * Dependencies:
+ * - ESP32_AI_Connect library (available at https://github.com/AvantMaker/ESP32_AI_Connect)
+ * - ArduinoJson library (version 7.0.0 or higher (available at https://arduinojson.org/)
+ *
+ * Setup Instructions:
+ * 1. Install the ESP32_AI_Connect library.
+ * 2. Upload the sketch to your ESP32 board and open the Serial Monitor (115200 baud).
+ *    No WiFi or API key is needed.
+ *
+ * License: MIT License
+ * Repository: https://github.com/AvantMaker/ESP32_AI_Connect
+ *
+ * Usage Notes:
+ * - Build with DISABLE_DEBUG_OUTPUT (see ESP32_AI_Connect_config.h): debug prints would be
+ *   measured too.
+ * - "json_allocs" and "json_peak_bytes" count the request and response documents, which
+ *   the benchmark owns. Stream chunks are parsed into the handler's pooled document;
+ *   "pool_fallbacks" counts chunk allocations that did not fit the pool and used the heap.
+ * - "heap_delta" is the free heap lost over all iterations; anything but 0 is a leak.
+ * - Compare numbers from the same board, core version and CPU frequency only.
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
+ */
+
+#include <ESP32_AI_Connect.h>
+#include <esp_heap_caps.h>
+#include "payloads.h"
+
+const int ITERATIONS = 200; // Calls per operation
+
+// Allocator for the benchmark's JSON documents that counts allocations and live bytes
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+  uint32_t allocations = 0;
+  size_t liveBytes = 0;
+  size_t peakBytes = 0;
+
+  void* allocate(size_t size) override {
+    Header* block = (Header*)malloc(sizeof(Header) + size);
+    if (block == nullptr) return nullptr;
+    block->size = size;
+    allocations++;
+    addLive(size);
+    return block + 1;
+  }
+
+  void deallocate(void* ptr) override {
+    if (ptr == nullptr) return;
+    Header* block = (Header*)ptr - 1;
+    liveBytes -= block->size;
+    free(block);
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    if (ptr == nullptr) return allocate(newSize);
+    Header* block = (Header*)ptr - 1;
+    size_t oldSize = block->size;
+    Header* newBlock = (Header*)realloc(block, sizeof(Header) + newSize);
+    if (newBlock == nullptr) return nullptr;
+    newBlock->size = newSize;
+    allocations++;
+    liveBytes -= oldSize;
+    addLive(newSize);
+    return newBlock + 1;
+  }
+
+private:
+  union Header {
+    size_t size;
+    max_align_t align; // Keeps the returned block aligned
+  };
+
+  void addLive(size_t size) {
+    liveBytes += size;
+    if (liveBytes > peakBytes) peakBytes = liveBytes;
+  }
+};
+
+CountingAllocator jsonAllocator;
+JsonDocument reqDoc(&jsonAllocator);
+JsonDocument respDoc(&jsonAllocator);
+char serializeBuffer[4096]; // Request bodies are serialized here, as they would be sent
+
+// Runs call ITERATIONS times after one warm-up call (which builds filters and pools)
+// and prints one CSV line. callsPerRun: handler calls made by one call of call
+void runBenchmark(const char* platform, const char* operation, std::function<bool()> call, int callsPerRun = 1) {
+  if (!call()) {
+    Serial.printf("%s,%s,FAILED\n", platform, operation);
+    return;
+  }
+
+  jsonAllocator.allocations = 0;
+  jsonAllocator.peakBytes = jsonAllocator.liveBytes;
+  uint32_t fallbacksBefore = AI_API_Pool_Allocator::instance()->getFallbackCount();
+  size_t heapBefore = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+
+  uint32_t start = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    call();
+  }
+  uint32_t elapsed = micros() - start;
+
+  int heapDelta = (int)heapBefore - (int)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+  uint32_t calls = (uint32_t)ITERATIONS * callsPerRun;
+  Serial.printf("%s,%s,%.1f,%.2f,%u,%u,%d\n", platform, operation,
+                (float)elapsed / calls,
+                (float)jsonAllocator.allocations / calls,
+                (unsigned)jsonAllocator.peakBytes,
+                (unsigned)(AI_API_Pool_Allocator::instance()->getFallbackCount() - fallbacksBefore),
+                heapDelta);
+}
+
+// Builds the results of the recorded tool calls, in the format tcReply() takes
+String buildToolResults(const String& toolCallsJson) {
+  JsonDocument callsDoc;
+  deserializeJson(callsDoc, toolCallsJson);
+  JsonDocument resultsDoc;
+  JsonArray results = resultsDoc.to<JsonArray>();
+  int index = 0;
+  for (JsonObject call : callsDoc.as<JsonArray>()) {
+    String id = call["id"] | "";
+    if (id.isEmpty()) id = "call_" + String(index); // Gemini calls carry no id
+    index++;
+    JsonObject result = results.add<JsonObject>();
+    result["tool_call_id"] = id;
+    result["function"]["name"] = call["function"]["name"];
+    result["function"]["output"] = "{\"temperature\":21,\"conditions\":\"sunny\"}";
+  }
+  String resultsJson;
+  serializeJson(resultsDoc, resultsJson);
+  return resultsJson;
+}
+
+void benchmarkHandler(const char* platform, AI_API_Platform_Handler& handler, const char* model,
+                      const char* response, const char* toolCallsResponse,
+                      const char** streamChunks, int streamChunkCount) {
+  String modelName = model;
+  String systemRole = benchSystemRole;
+  String userMessage = benchUserMessage;
+
+  runBenchmark(platform, "build", [&]() {
+    if (!handler.buildRequestBody(modelName, systemRole, 0.7, 256, userMessage, reqDoc)) return false;
+    return serializeJson(reqDoc, serializeBuffer, sizeof(serializeBuffer)) > 0;
+  });
+
+  String responsePayload = response;
+  runBenchmark(platform, "parse", [&]() {
+    String errorMsg;
+    return !handler.parseResponseBody(responsePayload, errorMsg, respDoc).isEmpty();
+  });
+
+#ifdef ENABLE_STREAM_CHAT
+  runBenchmark(platform, "chunk", [&]() {
+    bool ok = true;
+    handler.beginStream();
+    for (int i = 0; i < streamChunkCount; i++) {
+      bool isComplete = false;
+      String errorMsg;
+      handler.processStreamChunk(streamChunks[i], strlen(streamChunks[i]), isComplete, errorMsg);
+      if (!errorMsg.isEmpty()) ok = false;
+    }
+    handler.endStream();
+    return ok;
+  }, streamChunkCount);
+#endif
+
+#ifdef ENABLE_TOOL_CALLS
+  // Inputs of the follow-up request, prepared the way tcChat() prepares them
+  String tools[benchToolCount];
+  for (int i = 0; i < benchToolCount; i++) tools[i] = benchTools[i];
+  String errorMsg;
+  String toolsJson = handler.buildToolsJson(tools, benchToolCount, errorMsg);
+  String toolCallsJson = handler.parseToolCallsResponseBody(toolCallsResponse, errorMsg, respDoc);
+  String toolResultsJson = buildToolResults(toolCallsJson);
+
+  runBenchmark(platform, "tc_followup", [&]() {
+    if (!handler.buildToolCallsFollowUpRequestBody(modelName, toolsJson, systemRole, "auto",
+                                                   userMessage, toolCallsJson, toolResultsJson,
+                                                   256, "", reqDoc)) return false;
+    return serializeJson(reqDoc, serializeBuffer, sizeof(serializeBuffer)) > 0;
+  });
+#endif
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.printf("ESP32_AI_Connect handler benchmark: %d iterations, CPU %u MHz\n",
+                ITERATIONS, (unsigned)getCpuFrequencyMhz());
+  Serial.println("platform,operation,us_per_call,json_allocs_per_call,json_peak_bytes,pool_fallbacks,heap_delta");
+
+#ifdef USE_AI_API_OPENAI
+  {
+    AI_API_OpenAI_Handler handler;
+    benchmarkHandler("openai", handler, "gpt-4.1-mini", openaiResponse, openaiToolCallsResponse,
+                     openaiStreamChunks, openaiStreamChunkCount);
+  }
+#endif
+#ifdef USE_AI_API_DEEPSEEK
+  {
+    // DeepSeek sends the same response shapes as OpenAI
+    AI_API_DeepSeek_Handler handler;
+    benchmarkHandler("deepseek", handler, "deepseek-chat", openaiResponse, openaiToolCallsResponse,
+                     openaiStreamChunks, openaiStreamChunkCount);
+  }
+#endif
+#ifdef USE_AI_API_CLAUDE
+  {
+    AI_API_Claude_Handler handler;
+    benchmarkHandler("claude", handler, "claude-3-5-haiku-20241022", claudeResponse, claudeToolCallsResponse,
+                     claudeStreamChunks, claudeStreamChunkCount);
+  }
+#endif
+#ifdef USE_AI_API_GEMINI
+  {
+    AI_API_Gemini_Handler handler;
+    benchmarkHandler("gemini", handler, "gemini-2.5-flash", geminiResponse, geminiToolCallsResponse,
+                     geminiStreamChunks, geminiStreamChunkCount);
+  }
+#endif
+
+  Serial.println("Benchmark done.");
+}
+
+void loop() {
+  delay(1000);
+}
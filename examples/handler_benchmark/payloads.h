@@ -0,0 +1,185 @@
+// Recorded API responses used by handler_benchmark.ino
+// Captured from real requests and trimmed (ids shortened, long texts cut); the structure
+// and field order are as the providers send them.
+
+#ifndef HANDLER_BENCHMARK_PAYLOADS_H
+#define HANDLER_BENCHMARK_PAYLOADS_H
+
+// --- Request inputs (shared by all platforms) ---
+const char* benchSystemRole = "You are a concise assistant running on an ESP32.";
+const char* benchUserMessage = "Explain in two sentences why the sky is blue.";
+
+const char* benchTools[] = {
+  R"({"type":"function","function":{"name":"get_weather","description":"Get the current weather conditions for a specified city.","parameters":{"type":"object","properties":{"city":{"type":"string","description":"The name of the city."},"units":{"type":"string","enum":["celsius","fahrenheit"],"description":"Temperature unit to use."}},"required":["city"]}}})",
+  R"({"type":"function","function":{"name":"control_device","description":"Control a smart home device such as lights or a thermostat.","parameters":{"type":"object","properties":{"device":{"type":"string","description":"Device name."},"action":{"type":"string","enum":["on","off"]}},"required":["device","action"]}}})"
+};
+const int benchToolCount = 2;
+
+// --- OpenAI (DeepSeek uses the same response shapes) ---
+const char* openaiResponse = R"({
+  "id": "chatcmpl-B9MBs8CjcvOU2jLn4n570S5qMJKcT",
+  "object": "chat.completion",
+  "created": 1741569952,
+  "model": "gpt-4.1-mini-2025-04-14",
+  "choices": [
+    {
+      "index": 0,
+      "message": {
+        "role": "assistant",
+        "content": "Sunlight is scattered by the molecules in the air, and shorter blue wavelengths scatter much more than longer red ones (Rayleigh scattering). So blue light reaches your eyes from every direction of the sky.",
+        "refusal": null,
+        "annotations": []
+      },
+      "logprobs": null,
+      "finish_reason": "stop"
+    }
+  ],
+  "usage": {
+    "prompt_tokens": 31,
+    "completion_tokens": 44,
+    "total_tokens": 75,
+    "prompt_tokens_details": { "cached_tokens": 0, "audio_tokens": 0 },
+    "completion_tokens_details": { "reasoning_tokens": 0, "audio_tokens": 0, "accepted_prediction_tokens": 0, "rejected_prediction_tokens": 0 }
+  },
+  "service_tier": "default",
+  "system_fingerprint": "fp_6ec83003ad"
+})";
+
+const char* openaiToolCallsResponse = R"({
+  "id": "chatcmpl-B9MHDbslfkBeAs8l4bebGdFOJ6PeG",
+  "object": "chat.completion",
+  "created": 1741570283,
+  "model": "gpt-4.1-mini-2025-04-14",
+  "choices": [
+    {
+      "index": 0,
+      "message": {
+        "role": "assistant",
+        "content": null,
+        "tool_calls": [
+          {
+            "id": "call_FthC9qRpsL5kBpwwyw6c7j4k",
+            "type": "function",
+            "function": { "name": "get_weather", "arguments": "{\"city\":\"Paris\",\"units\":\"celsius\"}" }
+          }
+        ],
+        "refusal": null,
+        "annotations": []
+      },
+      "logprobs": null,
+      "finish_reason": "tool_calls"
+    }
+  ],
+  "usage": { "prompt_tokens": 113, "completion_tokens": 20, "total_tokens": 133 },
+  "service_tier": "default",
+  "system_fingerprint": "fp_6ec83003ad"
+})";
+
+// Payloads of the "data:" lines of one stream
+const char* openaiStreamChunks[] = {
+  R"({"id":"chatcmpl-B9MBs","object":"chat.completion.chunk","created":1741569952,"model":"gpt-4.1-mini-2025-04-14","system_fingerprint":"fp_6ec83003ad","choices":[{"index":0,"delta":{"role":"assistant","content":"","refusal":null},"logprobs":null,"finish_reason":null}],"usage":null})",
+  R"({"id":"chatcmpl-B9MBs","object":"chat.completion.chunk","created":1741569952,"model":"gpt-4.1-mini-2025-04-14","system_fingerprint":"fp_6ec83003ad","choices":[{"index":0,"delta":{"content":"Sunlight"},"logprobs":null,"finish_reason":null}],"usage":null})",
+  R"({"id":"chatcmpl-B9MBs","object":"chat.completion.chunk","created":1741569952,"model":"gpt-4.1-mini-2025-04-14","system_fingerprint":"fp_6ec83003ad","choices":[{"index":0,"delta":{"content":" is scattered"},"logprobs":null,"finish_reason":null}],"usage":null})",
+  R"({"id":"chatcmpl-B9MBs","object":"chat.completion.chunk","created":1741569952,"model":"gpt-4.1-mini-2025-04-14","system_fingerprint":"fp_6ec83003ad","choices":[{"index":0,"delta":{"content":" by the air"},"logprobs":null,"finish_reason":null}],"usage":null})",
+  R"({"id":"chatcmpl-B9MBs","object":"chat.completion.chunk","created":1741569952,"model":"gpt-4.1-mini-2025-04-14","system_fingerprint":"fp_6ec83003ad","choices":[{"index":0,"delta":{},"logprobs":null,"finish_reason":"stop"}],"usage":null})",
+  R"({"id":"chatcmpl-B9MBs","object":"chat.completion.chunk","created":1741569952,"model":"gpt-4.1-mini-2025-04-14","system_fingerprint":"fp_6ec83003ad","choices":[],"usage":{"prompt_tokens":31,"completion_tokens":44,"total_tokens":75}})",
+  "[DONE]"
+};
+const int openaiStreamChunkCount = sizeof(openaiStreamChunks) / sizeof(openaiStreamChunks[0]);
+
+// --- Claude ---
+const char* claudeResponse = R"({
+  "id": "msg_01XFDUDYJgAACzvnptvVoYEL",
+  "type": "message",
+  "role": "assistant",
+  "model": "claude-3-5-haiku-20241022",
+  "content": [
+    {
+      "type": "text",
+      "text": "Sunlight is scattered by the molecules in the air, and shorter blue wavelengths scatter much more than longer red ones (Rayleigh scattering). So blue light reaches your eyes from every direction of the sky."
+    }
+  ],
+  "stop_reason": "end_turn",
+  "stop_sequence": null,
+  "usage": { "input_tokens": 27, "cache_creation_input_tokens": 0, "cache_read_input_tokens": 0, "output_tokens": 46 }
+})";
+
+const char* claudeToolCallsResponse = R"({
+  "id": "msg_01Aq9w938a90dw8q",
+  "type": "message",
+  "role": "assistant",
+  "model": "claude-3-5-haiku-20241022",
+  "content": [
+    { "type": "text", "text": "I'll check the current weather in Paris for you." },
+    { "type": "tool_use", "id": "toolu_01A09q90qw90lq917835lq9", "name": "get_weather", "input": { "city": "Paris", "units": "celsius" } }
+  ],
+  "stop_reason": "tool_use",
+  "stop_sequence": null,
+  "usage": { "input_tokens": 402, "output_tokens": 67 }
+})";
+
+const char* claudeStreamChunks[] = {
+  R"({"type":"message_start","message":{"id":"msg_01XFDUDYJgAACzvnptvVoYEL","type":"message","role":"assistant","model":"claude-3-5-haiku-20241022","content":[],"stop_reason":null,"stop_sequence":null,"usage":{"input_tokens":27,"cache_creation_input_tokens":0,"cache_read_input_tokens":0,"output_tokens":1}}})",
+  R"({"type":"content_block_start","index":0,"content_block":{"type":"text","text":""}})",
+  R"({"type":"ping"})",
+  R"({"type":"content_block_delta","index":0,"delta":{"type":"text_delta","text":"Sunlight"}})",
+  R"({"type":"content_block_delta","index":0,"delta":{"type":"text_delta","text":" is scattered"}})",
+  R"({"type":"content_block_delta","index":0,"delta":{"type":"text_delta","text":" by the air"}})",
+  R"({"type":"content_block_stop","index":0})",
+  R"({"type":"message_delta","delta":{"stop_reason":"end_turn","stop_sequence":null},"usage":{"output_tokens":46}})",
+  R"({"type":"message_stop"})"
+};
+const int claudeStreamChunkCount = sizeof(claudeStreamChunks) / sizeof(claudeStreamChunks[0]);
+
+// --- Gemini ---
+const char* geminiResponse = R"({
+  "candidates": [
+    {
+      "content": {
+        "parts": [
+          { "text": "Sunlight is scattered by the molecules in the air, and shorter blue wavelengths scatter much more than longer red ones (Rayleigh scattering). So blue light reaches your eyes from every direction of the sky." }
+        ],
+        "role": "model"
+      },
+      "finishReason": "STOP",
+      "avgLogprobs": -0.1263
+    }
+  ],
+  "usageMetadata": {
+    "promptTokenCount": 25,
+    "candidatesTokenCount": 45,
+    "totalTokenCount": 70,
+    "promptTokensDetails": [ { "modality": "TEXT", "tokenCount": 25 } ],
+    "candidatesTokensDetails": [ { "modality": "TEXT", "tokenCount": 45 } ]
+  },
+  "modelVersion": "gemini-2.5-flash",
+  "responseId": "8UXNaK3FNPqbz7IPvq-w0AQ"
+})";
+
+const char* geminiToolCallsResponse = R"({
+  "candidates": [
+    {
+      "content": {
+        "parts": [
+          { "functionCall": { "name": "get_weather", "args": { "city": "Paris", "units": "celsius" } } }
+        ],
+        "role": "model"
+      },
+      "finishReason": "STOP",
+      "avgLogprobs": -0.0021
+    }
+  ],
+  "usageMetadata": { "promptTokenCount": 98, "candidatesTokenCount": 8, "totalTokenCount": 106 },
+  "modelVersion": "gemini-2.5-flash",
+  "responseId": "2kbNaJ3xH4q7z7IP5YiSeA"
+})";
+
+const char* geminiStreamChunks[] = {
+  R"({"candidates": [{"content": {"parts": [{"text": "Sunlight"}],"role": "model"},"index": 0}],"usageMetadata": {"promptTokenCount": 25,"totalTokenCount": 25},"modelVersion": "gemini-2.5-flash","responseId": "8UXNaK3FNPqbz7IPvq"})",
+  R"({"candidates": [{"content": {"parts": [{"text": " is scattered"}],"role": "model"},"index": 0}],"usageMetadata": {"promptTokenCount": 25,"totalTokenCount": 25},"modelVersion": "gemini-2.5-flash","responseId": "8UXNaK3FNPqbz7IPvq"})",
+  R"({"candidates": [{"content": {"parts": [{"text": " by the air"}],"role": "model"},"index": 0}],"usageMetadata": {"promptTokenCount": 25,"totalTokenCount": 25},"modelVersion": "gemini-2.5-flash","responseId": "8UXNaK3FNPqbz7IPvq"})",
+  R"({"candidates": [{"content": {"parts": [{"text": ""}],"role": "model"},"finishReason": "STOP","index": 0}],"usageMetadata": {"promptTokenCount": 25,"candidatesTokenCount": 45,"totalTokenCount": 70},"modelVersion": "gemini-2.5-flash","responseId": "8UXNaK3FNPqbz7IPvq"})"
+};
+const int geminiStreamChunkCount = sizeof(geminiStreamChunks) / sizeof(geminiStreamChunks[0]);
+
+#endif // HANDLER_BENCHMARK_PAYLOADS_H
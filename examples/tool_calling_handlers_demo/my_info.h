@@ -0,0 +1,7 @@
+// --- User Credentials ---
+const char* ssid = "YOUR_WIFI_SSID";
+const char* password = "YOUR_WIFI_PASSWORD";
+const char* apiKey = "YOUR_API_KEY";  // Your OpenAI API Key
+const char* model = "YOUR_LLM_MODEL"; // Or another model supporting tool calls
+const char* platform = "openai";      // Or "gemini", "openai-compatible" - must match compiled handlers
+// const char* customEndpoint = "YOUR-CUSTOM-ENDPOINT"; // Replace with your custom endpoint
\ No newline at end of file
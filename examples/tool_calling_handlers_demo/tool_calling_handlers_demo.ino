@@ -0,0 +1,167 @@
+/*
+ * ESP32_AI_Connect - Tool Handlers Demo
+ *
+ * Description:
+ * This example demonstrates tool handlers. Instead of parsing the tool calls JSON returned
+ * by tcChat(), running each tool and building the results JSON for tcReply(), the sketch
+ * registers one handler per tool with setTCToolHandler(). tcRunTools() then runs the handlers
+ * of all tool calls of a response, at the same time on separate tasks, and sends their results
+ * back to the AI. Two of the tools are slow on purpose (a sensor that takes 400 ms to read and
+ * a local server that takes 600 ms to answer): asked for both, the handlers finish in about
+ * 600 ms instead of 1 s.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit)
+ *
+ * Dependencies:
+ * - ESP32_AI_Connect library (available at https://github.com/AvantMaker/ESP32_AI_Connect)
+ * - ArduinoJson library (version 7.0.0 or higher, available at https://arduinojson.org/)
+ *
+ * Setup Instructions:
+ * 1. Update my_info.h with your WiFi credentials, API key, platform and model
+ * 2. Upload the sketch to your ESP32 board and open the Serial Monitor (115200 baud)
+ * 3. Type a question, e.g. "How warm is it in the room, and is the garage door closed?"
+ *
+ * License: MIT License
+ * Repository: https://github.com/AvantMaker/ESP32_AI_Connect
+ *
+ * Usage Notes:
+ * - Parallel handlers run on their own tasks: they must not share unprotected state.
+ *   Register handlers that must run alone (e.g. on a shared I2C bus) with parallel = false.
+ * - A response with calls of an unregistered tool gets an error output for them, so the AI
+ *   can tell the user.
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards
+ */
+
+#include <WiFi.h>
+#include <ESP32_AI_Connect.h>
+#include "my_info.h"  // Contains your WiFi, API key, model, and platform details
+
+ESP32_AI_Connect aiClient(platform, apiKey, model);
+
+// --- Tool handlers: each gets the call's arguments as JSON text and returns the output ---
+String readRoomSensor(const String& arguments) {
+  delay(400); // Stands in for a slow sensor conversion
+  return "{\"temperature\":22.5,\"humidity\":41}";
+}
+
+String queryDoorServer(const String& arguments) {
+  JsonDocument argsDoc;
+  deserializeJson(argsDoc, arguments);
+  String door = argsDoc["door"] | "front";
+  delay(600); // Stands in for a request to a local server
+  return "{\"door\":\"" + door + "\",\"state\":\"closed\"}";
+}
+
+String setBuzzer(const String& arguments) {
+  JsonDocument argsDoc;
+  deserializeJson(argsDoc, arguments);
+  bool on = argsDoc["on"] | false;
+  Serial.printf("[Buzzer] %s\n", on ? "ON" : "OFF");
+  return on ? "{\"buzzer\":\"on\"}" : "{\"buzzer\":\"off\"}";
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  WiFi.begin(ssid, password);
+  Serial.print("Connecting to WiFi");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println("\nWiFi connected");
+
+  String tools[3];
+  tools[0] = R"({
+    "type": "function",
+    "function": {
+      "name": "read_room_sensor",
+      "description": "Read the temperature and humidity of the room",
+      "parameters": { "type": "object", "properties": {} }
+    }
+  })";
+  tools[1] = R"({
+    "type": "function",
+    "function": {
+      "name": "get_door_state",
+      "description": "Ask the home server whether a door is open or closed",
+      "parameters": {
+        "type": "object",
+        "properties": {
+          "door": { "type": "string", "enum": ["front", "garage"] }
+        },
+        "required": ["door"]
+      }
+    }
+  })";
+  tools[2] = R"({
+    "type": "function",
+    "function": {
+      "name": "set_buzzer",
+      "description": "Switch the alarm buzzer on or off",
+      "parameters": {
+        "type": "object",
+        "properties": {
+          "on": { "type": "boolean" }
+        },
+        "required": ["on"]
+      }
+    }
+  })";
+
+  if (!aiClient.setTCTools(tools, 3)) {
+    Serial.println("Failed to set up tool calling: " + aiClient.getLastError());
+    while (true) delay(1000);
+  }
+  aiClient.setTCToolHandler("read_room_sensor", readRoomSensor);
+  aiClient.setTCToolHandler("get_door_state", queryDoorServer);
+  aiClient.setTCToolHandler("set_buzzer", setBuzzer, false); // Runs alone, after the others
+
+  aiClient.setTCChatSystemRole("You are a home assistant. Use the tools to answer.");
+  aiClient.setTCChatMaxTokens(300);
+  aiClient.setTCReplyMaxTokens(300);
+
+  Serial.println("Ask something about the home and press Enter:");
+}
+
+void processQuestion(const String& userMessage) {
+  String response = aiClient.tcChat(userMessage);
+  if (response.isEmpty()) {
+    Serial.println("Error: " + aiClient.getLastError());
+    return;
+  }
+
+  // While the AI asks for tools, run them and send the results back
+  String finishReason = aiClient.getFinishReason();
+  while (finishReason == "tool_calls" || finishReason == "tool_use") {
+    Serial.println("Tool calls: " + response);
+    response = aiClient.tcRunTools();
+    Serial.printf("Ran the tools in %u ms: %s\n", (unsigned)aiClient.getTCToolRunTime(),
+                  aiClient.getTCToolResults().c_str());
+    if (response.isEmpty()) {
+      Serial.println("Error: " + aiClient.getLastError());
+      return;
+    }
+    finishReason = aiClient.getFinishReason();
+  }
+
+  Serial.println("AI: " + response);
+}
+
+void loop() {
+  if (Serial.available() > 0) {
+    String userMessage = Serial.readStringUntil('\n');
+    userMessage.trim();
+    if (userMessage.length() > 0) {
+      Serial.println("\nUser: " + userMessage);
+      processQuestion(userMessage);
+    }
+  }
+  delay(10);
+}
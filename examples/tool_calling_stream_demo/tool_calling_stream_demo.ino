@@ -0,0 +1,190 @@
+/*
+ * ESP32_AI_Connect - Streaming Tool Calls Demo
+ *
+ * Description:
+ * This example demonstrates streamTcChat(), the streaming variant of tcChat(). The AI controls
+ * the board's LED through two tools. Instead of waiting for the whole response, the sketch prints
+ * the AI's text as it arrives and switches the LED as soon as each tool call is complete, while
+ * the model may still be generating the next one. The results are then sent back with tcReply()
+ * for the final answer, as with tcChat().
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: https://www.AvantMaker.com
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit)
+ * - An LED on LED_PIN (most DevKit boards have one on GPIO 2)
+ *
+ * Dependencies:
+ * - ESP32_AI_Connect library (available at https://github.com/AvantMaker/ESP32_AI_Connect)
+ * - ArduinoJson library (version 7.0.0 or higher, available at https://arduinojson.org/)
+ *
+ * Setup Instructions:
+ * 1. Update my_info.h with your WiFi credentials, API key, platform and model
+ * 2. Upload the sketch to your ESP32 board and open the Serial Monitor (115200 baud)
+ * 3. Type a command, e.g. "Turn the light on, then blink it three times"
+ *
+ * License: MIT License
+ * Repository: https://github.com/AvantMaker/ESP32_AI_Connect
+ *
+ * Usage Notes:
+ * - The text callback may be nullptr if only the tool calls are of interest.
+ * - Returning false from either callback stops the stream; tool calls completed until then can
+ *   still be answered with tcReply().
+ * - For cleaner output, #define DISABLE_DEBUG_OUTPUT before #include <ESP32_AI_Connect.h>.
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards
+ */
+
+#include <WiFi.h>
+#include <ESP32_AI_Connect.h>
+#include "my_info.h"  // Contains your WiFi, API key, model, and platform details
+
+#define LED_PIN 2
+
+ESP32_AI_Connect aiClient(platform, apiKey, model);
+
+// Results of the tool calls of the current request, in the format tcReply() takes
+JsonDocument toolResultsDoc;
+
+// --- Tools ---
+String setLed(const String& state) {
+  bool on = (state == "on");
+  digitalWrite(LED_PIN, on ? HIGH : LOW);
+  Serial.printf("\n[LED] %s\n", on ? "ON" : "OFF");
+  return on ? "{\"status\":\"success\",\"led\":\"on\"}" : "{\"status\":\"success\",\"led\":\"off\"}";
+}
+
+String blinkLed(int times) {
+  times = constrain(times, 1, 10);
+  Serial.printf("\n[LED] Blinking %d times\n", times);
+  for (int i = 0; i < times; i++) {
+    digitalWrite(LED_PIN, HIGH);
+    delay(200);
+    digitalWrite(LED_PIN, LOW);
+    delay(200);
+  }
+  return "{\"status\":\"success\",\"blinked\":" + String(times) + "}";
+}
+
+// Called for each tool call as soon as its arguments are complete
+bool onToolCall(const ESP32_AI_Connect::ToolCallInfo& toolCall) {
+  Serial.printf("\n[Tool call %u after %u ms] %s %s\n", (unsigned)toolCall.index,
+                (unsigned)toolCall.elapsedMs, toolCall.name.c_str(), toolCall.arguments.c_str());
+
+  JsonDocument argsDoc;
+  deserializeJson(argsDoc, toolCall.arguments);
+
+  String output;
+  if (toolCall.name == "set_led") {
+    output = setLed(argsDoc["state"] | "off");
+  } else if (toolCall.name == "blink_led") {
+    output = blinkLed(argsDoc["times"] | 1);
+  } else {
+    output = "{\"status\":\"error\",\"message\":\"Unknown tool\"}";
+  }
+
+  JsonObject result = toolResultsDoc.add<JsonObject>();
+  result["tool_call_id"] = toolCall.id.isEmpty() ? "call_" + String(toolCall.index) : toolCall.id;
+  result["function"]["name"] = toolCall.name;
+  result["function"]["output"] = output;
+  return true; // Keep streaming
+}
+
+// Called with the AI's text as it arrives
+bool onText(const ESP32_AI_Connect::StreamChunkInfo& chunk) {
+  Serial.print(chunk.content);
+  return true;
+}
+
+void processCommand(const String& userMessage) {
+  toolResultsDoc.clear();
+  toolResultsDoc.to<JsonArray>();
+
+  Serial.print("AI: ");
+  if (!aiClient.streamTcChat(userMessage, onText, onToolCall)) {
+    Serial.println("\nError: " + aiClient.getLastError());
+    return;
+  }
+  Serial.println();
+
+  if (aiClient.getStreamTCToolCalls().isEmpty()) {
+    return; // Answered without calling tools
+  }
+
+  // Send the results of the (already executed) tool calls for the final answer
+  String toolResultsJson;
+  serializeJson(toolResultsDoc, toolResultsJson);
+  String reply = aiClient.tcReply(toolResultsJson);
+  if (reply.isEmpty()) {
+    Serial.println("Follow-up error: " + aiClient.getLastError());
+    return;
+  }
+  Serial.println("AI: " + reply);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  pinMode(LED_PIN, OUTPUT);
+
+  WiFi.begin(ssid, password);
+  Serial.print("Connecting to WiFi");
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println("\nWiFi connected");
+
+  String tools[2];
+  tools[0] = R"({
+    "type": "function",
+    "function": {
+      "name": "set_led",
+      "description": "Switch the LED on or off",
+      "parameters": {
+        "type": "object",
+        "properties": {
+          "state": { "type": "string", "enum": ["on", "off"] }
+        },
+        "required": ["state"]
+      }
+    }
+  })";
+  tools[1] = R"({
+    "type": "function",
+    "function": {
+      "name": "blink_led",
+      "description": "Blink the LED a number of times",
+      "parameters": {
+        "type": "object",
+        "properties": {
+          "times": { "type": "integer", "description": "How often to blink, from 1 to 10" }
+        },
+        "required": ["times"]
+      }
+    }
+  })";
+
+  if (!aiClient.setTCTools(tools, 2)) {
+    Serial.println("Failed to set up tool calling: " + aiClient.getLastError());
+    while (true) delay(1000);
+  }
+  aiClient.setTCChatSystemRole("You control an LED with the tools you are given. Briefly say what you are doing, then call the tools.");
+  aiClient.setTCChatMaxTokens(300);
+  aiClient.setTCReplyMaxTokens(200);
+
+  Serial.println("Type a command for the LED and press Enter:");
+}
+
+void loop() {
+  if (Serial.available() > 0) {
+    String userMessage = Serial.readStringUntil('\n');
+    userMessage.trim();
+    if (userMessage.length() > 0) {
+      Serial.println("\nUser: " + userMessage);
+      processCommand(userMessage); // Each streamTcChat() starts a new tool calls conversation
+    }
+  }
+  delay(10);
+}
@@ -0,0 +1,108 @@
+// ESP32_AI_Connect/AI_API_Allocator.cpp
+
+#include "AI_API_Allocator.h"
+#include <esp_heap_caps.h>
+
+// --- AI_API_Psram_Allocator ---
+
+AI_API_Psram_Allocator* AI_API_Psram_Allocator::instance() {
+    static AI_API_Psram_Allocator allocator;
+    return &allocator;
+}
+
+void* AI_API_Psram_Allocator::allocate(size_t size) {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr == nullptr) {
+        ptr = heap_caps_malloc(size, MALLOC_CAP_DEFAULT); // No PSRAM: internal RAM
+    }
+    return ptr;
+}
+
+void AI_API_Psram_Allocator::deallocate(void* ptr) {
+    heap_caps_free(ptr); // Works for blocks from either heap
+}
+
+void* AI_API_Psram_Allocator::reallocate(void* ptr, size_t newSize) {
+    void* newPtr = heap_caps_realloc(ptr, newSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (newPtr == nullptr) {
+        newPtr = heap_caps_realloc(ptr, newSize, MALLOC_CAP_DEFAULT);
+    }
+    return newPtr;
+}
+
+// --- AI_API_Pool_Allocator ---
+
+AI_API_Pool_Allocator* AI_API_Pool_Allocator::instance() {
+    static AI_API_Pool_Allocator allocator;
+    return &allocator;
+}
+
+bool AI_API_Pool_Allocator::_ensureBlocks() {
+    if (_blocks != nullptr) return true;
+
+    // Allocate outside the critical section; if another task won the race, drop ours
+    uint8_t* blocks = (uint8_t*)heap_caps_malloc(BLOCK_COUNT * BLOCK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (blocks == nullptr) return false;
+
+    portENTER_CRITICAL(&_mux);
+    if (_blocks == nullptr) {
+        _blocks = blocks;
+        blocks = nullptr;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    if (blocks != nullptr) heap_caps_free(blocks);
+    return true;
+}
+
+void* AI_API_Pool_Allocator::allocate(size_t size) {
+    if (size <= BLOCK_SIZE && _ensureBlocks()) {
+        int block = -1;
+        portENTER_CRITICAL(&_mux);
+        for (uint8_t i = 0; i < BLOCK_COUNT; i++) {
+            if (!(_used & (1UL << i))) {
+                _used |= (1UL << i);
+                block = i;
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&_mux);
+        if (block >= 0) return _blocks + block * BLOCK_SIZE;
+    }
+
+    _fallbacks++;
+    return malloc(size);
+}
+
+void AI_API_Pool_Allocator::deallocate(void* ptr) {
+    if (!_owns(ptr)) {
+        free(ptr);
+        return;
+    }
+    size_t block = ((uint8_t*)ptr - _blocks) / BLOCK_SIZE;
+    portENTER_CRITICAL(&_mux);
+    _used &= ~(1UL << block);
+    portEXIT_CRITICAL(&_mux);
+}
+
+void* AI_API_Pool_Allocator::reallocate(void* ptr, size_t newSize) {
+    if (ptr == nullptr) return allocate(newSize);
+    if (!_owns(ptr)) return realloc(ptr, newSize);
+
+    if (newSize <= BLOCK_SIZE) return ptr; // Still fits its block (including shrinking)
+
+    // Outgrew the block: move to the heap
+    void* newPtr = malloc(newSize);
+    if (newPtr == nullptr) return nullptr; // ArduinoJson keeps the old block
+    memcpy(newPtr, ptr, BLOCK_SIZE);
+    deallocate(ptr);
+    _fallbacks++;
+    return newPtr;
+}
+
+uint8_t AI_API_Pool_Allocator::getBlocksInUse() const {
+    portENTER_CRITICAL(&_mux);
+    uint32_t used = _used;
+    portEXIT_CRITICAL(&_mux);
+    return __builtin_popcount(used);
+}
@@ -0,0 +1,70 @@
+// ESP32_AI_Connect/AI_API_Allocator.h
+
+#ifndef AI_API_ALLOCATOR_H
+#define AI_API_ALLOCATOR_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+// ArduinoJson allocators used by the library.
+//
+// Any ArduinoJson::Allocator can be given to ESP32_AI_Connect::setAllocator() for the
+// large request and response documents; these two are built in.
+
+// Allocates from PSRAM, falling back to internal RAM when there is no PSRAM (or it is full).
+//
+// Usage:
+//   ai.setAllocator(AI_API_Psram_Allocator::instance());
+class AI_API_Psram_Allocator : public ArduinoJson::Allocator {
+public:
+    static AI_API_Psram_Allocator* instance();
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+private:
+    AI_API_Psram_Allocator() {}
+};
+
+// Fixed pool of AI_API_CHUNK_POOL_BLOCKS internal-RAM blocks of AI_API_CHUNK_POOL_BLOCK_SIZE
+// bytes, for the short-lived documents a streamed chunk is parsed into. Handing the
+// same few blocks out again for every chunk keeps hundreds of small allocations per
+// response off the heap. Requests that don't fit a block, or arrive while all blocks
+// are in use, go to the default heap. The blocks are allocated on first use.
+// Safe to use from several tasks at once.
+class AI_API_Pool_Allocator : public ArduinoJson::Allocator {
+public:
+    static AI_API_Pool_Allocator* instance();
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    // Blocks currently handed out, and allocations that had to use the heap
+    uint8_t getBlocksInUse() const;
+    uint32_t getFallbackCount() const { return _fallbacks; }
+
+private:
+    AI_API_Pool_Allocator() {}
+
+    static const size_t BLOCK_SIZE = AI_API_CHUNK_POOL_BLOCK_SIZE;
+    static const uint8_t BLOCK_COUNT = AI_API_CHUNK_POOL_BLOCKS;
+    static_assert(BLOCK_COUNT > 0 && BLOCK_COUNT <= 32, "AI_API_CHUNK_POOL_BLOCKS must be 1..32");
+
+    uint8_t* _blocks = nullptr;  // BLOCK_COUNT * BLOCK_SIZE bytes
+    uint32_t _used = 0;          // Bit i set: block i handed out
+    volatile uint32_t _fallbacks = 0;
+    mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+    bool _ensureBlocks();
+    bool _owns(const void* ptr) const {
+        return _blocks != nullptr && (const uint8_t*)ptr >= _blocks &&
+               (const uint8_t*)ptr < _blocks + BLOCK_COUNT * BLOCK_SIZE;
+    }
+};
+
+#endif // AI_API_ALLOCATOR_H
@@ -0,0 +1,164 @@
+// ESP32_AI_Connect/AI_API_Chat_History.cpp
+
+#include "AI_API_Chat_History.h"
+#include <esp_heap_caps.h>
+
+AI_API_Chat_History::~AI_API_Chat_History() {
+    end();
+}
+
+bool AI_API_Chat_History::begin(size_t arenaBytes, bool usePsram) {
+    end();
+    if (arenaBytes == 0) return true; // History disabled
+
+    if (usePsram) {
+        _arena = (uint8_t*)heap_caps_malloc(arenaBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (_arena == nullptr) {
+        _arena = (uint8_t*)heap_caps_malloc(arenaBytes, MALLOC_CAP_DEFAULT); // No PSRAM: internal RAM
+    }
+    if (_arena == nullptr) return false;
+
+    _capacity = arenaBytes;
+    return true;
+}
+
+void AI_API_Chat_History::end() {
+    if (_arena != nullptr) {
+        heap_caps_free(_arena);
+        _arena = nullptr;
+    }
+    _capacity = 0;
+    clear();
+}
+
+void AI_API_Chat_History::clear() {
+    _used = 0;
+    _turnCount = 0;
+    _contentBytes = 0;
+}
+
+bool AI_API_Chat_History::addTurn(Role role, const String& content) {
+    if (_arena == nullptr) return false;
+
+    // Encode once as a JSON string literal; builders splice it without re-escaping
+    JsonDocument encoder;
+    encoder.set(content);
+    size_t jsonLength = measureJson(encoder);
+
+    if (!_fits(jsonLength)) return false; // Would never fit, keep the existing history intact
+    _trim(HEADER_SIZE + jsonLength + 1);
+    _append(role, encoder, jsonLength);
+    return true;
+}
+
+bool AI_API_Chat_History::addExchange(const String& userMessage, const String& assistantReply) {
+    if (_arena == nullptr) return false;
+
+    JsonDocument userEncoder, replyEncoder;
+    userEncoder.set(userMessage);
+    replyEncoder.set(assistantReply);
+    size_t userLength = measureJson(userEncoder);
+    size_t replyLength = measureJson(replyEncoder);
+
+    // Both turns are checked and trimmed for together, so a user turn is never
+    // stored without its reply (or pushed out by it)
+    if (userLength > 0xFFFFFF || replyLength > 0xFFFFFF ||
+        !_fits(userLength + replyLength + HEADER_SIZE + 1)) {
+        return false;
+    }
+    _trim(2 * (HEADER_SIZE + 1) + userLength + replyLength);
+    _append(USER, userEncoder, userLength);
+    _append(ASSISTANT, replyEncoder, replyLength);
+    return true;
+}
+
+bool AI_API_Chat_History::addEncodedTurn(Role role, const char* json, size_t jsonLength) {
+    if (_arena == nullptr || json == nullptr) return false;
+    if (jsonLength < 2 || json[0] != '"' || json[jsonLength - 1] != '"') return false;
+
+    // It is spliced into requests as is: it must be exactly one JSON string, nothing after it
+    JsonDocument check;
+    if (deserializeJson(check, json, jsonLength) || !check.is<const char*>()) return false;
+    if (measureJson(check) != jsonLength) return false;
+
+    if (!_fits(jsonLength)) return false;
+    _trim(HEADER_SIZE + jsonLength + 1);
+    memcpy(_appendRecord(role, jsonLength), json, jsonLength);
+    return true;
+}
+
+bool AI_API_Chat_History::readTurn(size_t& position, Turn& turn) const {
+    if (_arena == nullptr || position >= _used) return false;
+
+    size_t jsonLength = 0;
+    Role role = USER;
+    size_t recordSize = _recordSize(position, &role, &jsonLength);
+
+    turn.role = role;
+    turn.json = (const char*)_arena + position + HEADER_SIZE;
+    turn.jsonLength = jsonLength;
+    position += recordSize;
+    return true;
+}
+
+size_t AI_API_Chat_History::_recordSize(size_t offset, Role* role, size_t* jsonLength) const {
+    uint32_t header;
+    memcpy(&header, _arena + offset, HEADER_SIZE);
+    size_t length = header & 0xFFFFFF;
+    if (role) *role = (Role)(header >> 24);
+    if (jsonLength) *jsonLength = length;
+    return HEADER_SIZE + length + 1;
+}
+
+bool AI_API_Chat_History::_fits(size_t jsonLength) const {
+    if (jsonLength > 0xFFFFFF || HEADER_SIZE + jsonLength + 1 > _capacity) return false;
+    return _tokenBudget == 0 || jsonLength / 4 <= _tokenBudget;
+}
+
+void AI_API_Chat_History::_append(Role role, JsonDocument& encoder, size_t jsonLength) {
+    serializeJson(encoder, _appendRecord(role, jsonLength), jsonLength + 1);
+}
+
+char* AI_API_Chat_History::_appendRecord(Role role, size_t jsonLength) {
+    uint8_t* record = _arena + _used;
+    uint32_t header = ((uint32_t)role << 24) | (uint32_t)jsonLength;
+    memcpy(record, &header, HEADER_SIZE);
+    record[HEADER_SIZE + jsonLength] = '\0';
+
+    _used += HEADER_SIZE + jsonLength + 1;
+    _contentBytes += jsonLength;
+    _turnCount++;
+    return (char*)record + HEADER_SIZE;
+}
+
+void AI_API_Chat_History::_trim(size_t extraBytes) {
+    size_t extraTokens = extraBytes / 4; // Headers included: errs on the side of trimming
+    while (_turnCount > 0 &&
+           (_used + extraBytes > _capacity ||
+            (_tokenBudget > 0 && getEstimatedTokens() + extraTokens > _tokenBudget))) {
+        _dropOldest();
+    }
+}
+
+void AI_API_Chat_History::_dropOldest() {
+    size_t jsonLength = 0;
+    size_t dropped = _recordSize(0, nullptr, &jsonLength);
+    _contentBytes -= jsonLength;
+    _turnCount--;
+
+    // Keep the history starting with a user turn
+    Role nextRole;
+    if (dropped < _used) {
+        size_t nextLength = 0;
+        size_t nextSize = _recordSize(dropped, &nextRole, &nextLength);
+        if (nextRole == ASSISTANT) {
+            dropped += nextSize;
+            _contentBytes -= nextLength;
+            _turnCount--;
+        }
+    }
+
+    memmove(_arena, _arena + dropped, _used - dropped);
+    _used -= dropped;
+}
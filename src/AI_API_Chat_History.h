@@ -0,0 +1,105 @@
+// ESP32_AI_Connect/AI_API_Chat_History.h
+
+#ifndef AI_API_CHAT_HISTORY_H
+#define AI_API_CHAT_HISTORY_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Conversation history stored in one fixed-size arena.
+//
+// Each turn is kept as a small header followed by its content already encoded as a
+// JSON string literal (quotes and escapes included), so request builders can splice
+// it into the request with serialized() instead of copying and escaping it again.
+// When a new turn does not fit, or the token budget is exceeded, the oldest turns
+// are dropped. The arena can be placed in PSRAM.
+//
+// Usage (inside a request builder):
+//   AI_API_Chat_History::Turn turn;
+//   for (size_t pos = 0; history->readTurn(pos, turn); ) {
+//       msg["role"] = turn.role == AI_API_Chat_History::ASSISTANT ? "assistant" : "user";
+//       msg["content"] = serialized(turn.json, turn.jsonLength);
+//   }
+class AI_API_Chat_History {
+public:
+    enum Role : uint8_t {
+        USER = 0,
+        ASSISTANT = 1
+    };
+
+    struct Turn {
+        Role role;
+        const char* json;   // JSON string literal, e.g. "\"Hello\"" (NUL-terminated)
+        size_t jsonLength;
+    };
+
+    AI_API_Chat_History() {}
+    ~AI_API_Chat_History();
+
+    // Allocate an arena of arenaBytes bytes (PSRAM if requested and available).
+    // Existing turns are discarded. Returns false if the allocation failed; 0 disables history.
+    bool begin(size_t arenaBytes, bool usePsram = false);
+
+    // Release the arena
+    void end();
+
+    // True if an arena is allocated
+    bool isEnabled() const { return _arena != nullptr; }
+
+    // Limit the stored history to about maxTokens (estimated at 4 bytes per token), 0 = no limit
+    void setTokenBudget(size_t maxTokens) { _tokenBudget = maxTokens; _trim(0); }
+    size_t getTokenBudget() const { return _tokenBudget; }
+
+    // Append a turn, dropping the oldest turns as needed. Returns false if the turn
+    // alone is larger than the arena or token budget.
+    bool addTurn(Role role, const String& content);
+
+    // Append a user message and the assistant reply to it
+    bool addExchange(const String& userMessage, const String& assistantReply);
+
+    // Append a turn already encoded as a JSON string literal, as read with readTurn()
+    // (e.g. from a saved state), without encoding it again. json is parsed once to check it;
+    // returns false unless it is exactly one JSON string, or if the turn alone does not fit.
+    bool addEncodedTurn(Role role, const char* json, size_t jsonLength);
+
+    // Read the turn at position and advance position to the next one.
+    // Start with position = 0. Returns false when there are no more turns.
+    bool readTurn(size_t& position, Turn& turn) const;
+
+    // Remove all turns (keeps the arena)
+    void clear();
+
+    size_t getTurnCount() const { return _turnCount; }
+    size_t getUsedBytes() const { return _used; }
+    size_t getCapacity() const { return _capacity; }
+    // Estimated tokens of the stored turns
+    size_t getEstimatedTokens() const { return _contentBytes / 4; }
+
+private:
+    uint8_t* _arena = nullptr;
+    size_t _capacity = 0;
+    size_t _used = 0;
+    size_t _turnCount = 0;
+    size_t _contentBytes = 0; // Sum of encoded turn sizes, used for the token estimate
+    size_t _tokenBudget = 0;
+
+    // Record layout: [uint32_t header: role << 24 | jsonLength][json][NUL]
+    static const size_t HEADER_SIZE = sizeof(uint32_t);
+
+    // True if a turn of jsonLength encoded bytes can be stored at all
+    bool _fits(size_t jsonLength) const;
+    // Store an encoded turn at the end of the arena (space must be available)
+    void _append(Role role, JsonDocument& encoder, size_t jsonLength);
+    // Reserve a record and write its header; returns where the encoded turn goes
+    char* _appendRecord(Role role, size_t jsonLength);
+    // Drop the oldest turns until extraBytes more fit in the arena and the token budget
+    void _trim(size_t extraBytes);
+    // Drop the oldest turn; a following assistant turn is dropped with it so the
+    // history always starts with a user message
+    void _dropOldest();
+    size_t _recordSize(size_t offset, Role* role = nullptr, size_t* jsonLength = nullptr) const;
+};
+
+#endif // AI_API_CHAT_HISTORY_H
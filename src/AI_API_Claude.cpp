@@ -2,7 +2,64 @@
 
 // Constructor
 AI_API_Claude_Handler::AI_API_Claude_Handler() {
-    // Any initialization needed
+    // Non-streaming response: text content blocks, stop_reason and usage
+    _responseFilter["error"] = true;
+    _responseFilter["stop_reason"] = true;
+    _responseFilter["usage"]["input_tokens"] = true;
+    _responseFilter["usage"]["output_tokens"] = true;
+    _responseFilter["usage"]["cache_read_input_tokens"] = true;
+    _responseFilter["usage"]["cache_creation_input_tokens"] = true;
+    _responseFilter["content"][0]["type"] = true;
+    _responseFilter["content"][0]["text"] = true;
+
+#ifdef ENABLE_TOOL_CALLS
+    // Tool calls response: same fields plus the tool_use block members
+    _toolCallsResponseFilter = _responseFilter;
+    _toolCallsResponseFilter["content"][0]["id"] = true;
+    _toolCallsResponseFilter["content"][0]["name"] = true;
+    _toolCallsResponseFilter["content"][0]["input"] = true;
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+    // Stream event: event type, text deltas, the final stop_reason and token usage
+    _streamChunkFilter["type"] = true;
+    _streamChunkFilter["error"] = true;
+    _streamChunkFilter["delta"]["type"] = true;
+    _streamChunkFilter["delta"]["text"] = true;
+    _streamChunkFilter["delta"]["stop_reason"] = true;
+    _streamChunkFilter["message"]["usage"]["input_tokens"] = true;
+    _streamChunkFilter["message"]["usage"]["cache_read_input_tokens"] = true;
+    _streamChunkFilter["message"]["usage"]["cache_creation_input_tokens"] = true;
+    _streamChunkFilter["usage"]["output_tokens"] = true;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Tool calls stream event: same fields plus tool_use blocks and their argument deltas
+    _toolCallsStreamChunkFilter = _streamChunkFilter;
+    _toolCallsStreamChunkFilter["index"] = true;
+    _toolCallsStreamChunkFilter["content_block"]["type"] = true;
+    _toolCallsStreamChunkFilter["content_block"]["id"] = true;
+    _toolCallsStreamChunkFilter["content_block"]["name"] = true;
+    _toolCallsStreamChunkFilter["delta"]["partial_json"] = true;
+#endif
+}
+
+void AI_API_Claude_Handler::_setSystem(JsonDocument& doc, const String& systemRole) const {
+    if (!_promptCaching) {
+        doc["system"] = systemRole;
+        return;
+    }
+    // As a text block with a cache breakpoint, which caches the tools before it too
+    JsonObject block = doc["system"].to<JsonArray>().add<JsonObject>();
+    block["type"] = "text";
+    block["text"] = systemRole;
+    block["cache_control"]["type"] = "ephemeral";
+}
+
+int AI_API_Claude_Handler::_inputTokens(JsonObjectConst usage) {
+    _lastCachedTokens = usage["cache_read_input_tokens"] | 0;
+    _lastCacheWriteTokens = usage["cache_creation_input_tokens"] | 0;
+    return (usage["input_tokens"] | 0) + _lastCachedTokens + _lastCacheWriteTokens;
 }
 
 // Destructor
@@ -26,29 +83,23 @@ void AI_API_Claude_Handler::setHeaders(HTTPClient& httpClient, const String& api
 }
 
 // Build request body for Claude API
-String AI_API_Claude_Handler::buildRequestBody(const String& modelName, const String& systemRole,
+bool AI_API_Claude_Handler::buildRequestBody(const String& modelName, const String& systemRole,
                                              float temperature, int maxTokens,
                                              const String& userMessage, JsonDocument& doc,
-                                             const String& customParams) {
+                                             JsonObjectConst customParams,
+                                             const AI_API_Chat_History* history) {
     try {
         // Set the model
         doc["model"] = modelName;
         
-        // Process custom parameters if provided
-        if (customParams.length() > 0) {
-            // Create a temporary document to parse the custom parameters
-            JsonDocument paramsDoc;
-            DeserializationError error = deserializeJson(paramsDoc, customParams);
-            
-            // Only proceed if parsing was successful
-            if (!error) {
-                // Add each parameter from customParams to the request
-                for (JsonPair param : paramsDoc.as<JsonObject>()) {
-                    // Skip model, messages, system as they are handled separately
-                    if (param.key() != "model" && param.key() != "messages" && param.key() != "system") {
-                        // Copy the parameter to our request document
-                        doc[param.key()] = param.value();
-                    }
+        // Copy custom parameters (parsed once by setChatParameters/setStreamChatParameters)
+        if (!customParams.isNull()) {
+            // Add each parameter from customParams to the request
+            for (JsonPairConst param : customParams) {
+                // Skip model, messages, system as they are handled separately
+                if (param.key() != "model" && param.key() != "messages" && param.key() != "system") {
+                    // Copy the parameter to our request document
+                    doc[param.key()] = param.value();
                 }
             }
         }
@@ -66,22 +117,22 @@ String AI_API_Claude_Handler::buildRequestBody(const String& modelName, const St
         
         // Add system message if specified (only if user has set it with setTCChatSystemRole)
         if (systemRole.length() > 0) {
-            doc["system"] = systemRole;
+            _setSystem(doc, systemRole);
         }
         
         // Create messages array with user message
         JsonArray messages = doc["messages"].to<JsonArray>();
+        // Previous conversation turns (empty unless chat history is enabled)
+        appendHistoryMessages(messages, history);
+        
         JsonObject userMsg = messages.add<JsonObject>();
         userMsg["role"] = "user";
         userMsg["content"] = userMessage;
         
-        // Serialize the request body
-        String requestBody;
-        serializeJson(doc, requestBody);
-        return requestBody;
+        return true;
     } 
     catch (const std::exception& e) {
-        return "";
+        return false;
     }
 }
 
@@ -89,10 +140,21 @@ String AI_API_Claude_Handler::buildRequestBody(const String& modelName, const St
 String AI_API_Claude_Handler::parseResponseBody(const String& responsePayload,
                                               String& errorMsg, JsonDocument& doc) {
     resetState();  // Reset finish reason and token count
-    
+
+    DeserializationError error = deserializeJson(doc, responsePayload, DeserializationOption::Filter(_responseFilter));
+    return _extractResponseContent(error, errorMsg, doc);
+}
+
+String AI_API_Claude_Handler::parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) {
+    resetState();  // Reset finish reason and token count
+
+    DeserializationError error = deserializeJson(doc, responseStream, DeserializationOption::Filter(_responseFilter));
+    return _extractResponseContent(error, errorMsg, doc);
+}
+
+// Extract the content from a deserialized response (shared by the String and Stream variants)
+String AI_API_Claude_Handler::_extractResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc) {
     try {
-        // Parse the JSON response
-        DeserializationError error = deserializeJson(doc, responsePayload);
         if (error) {
             errorMsg = "JSON parsing error: " + String(error.c_str());
             return "";
@@ -129,7 +191,7 @@ String AI_API_Claude_Handler::parseResponseBody(const String& responsePayload,
                 
                 // Extract token count if available
                 if (!doc["usage"].isNull()) {
-                    _lastTotalTokens = doc["usage"]["input_tokens"].as<int>() + 
+                    _lastTotalTokens = _inputTokens(doc["usage"]) + 
                                       doc["usage"]["output_tokens"].as<int>();
                 }
                 
@@ -148,67 +210,46 @@ String AI_API_Claude_Handler::parseResponseBody(const String& responsePayload,
 }
 
 #ifdef ENABLE_TOOL_CALLS
-// Build tool calls request body for Claude API
-String AI_API_Claude_Handler::buildToolCallsRequestBody(const String& modelName,
-                                                    const String* toolsArray, int toolsArraySize,
-                                                    const String& systemMessage, const String& toolChoice,
-                                                    int maxTokens,
-                                                    const String& userMessage, JsonDocument& doc) {
-    resetState();  // Reset finish reason and token count
+// Convert the tool definitions to Claude's "tools" array
+String AI_API_Claude_Handler::buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) {
+    errorMsg = "";
     
     try {
-        // Clear the document first to ensure no leftover fields
-        doc.clear();
-        
-        // Set the model
-        doc["model"] = modelName;
-        
-        // IMPORTANT: Claude API requires 'max_tokens' field - it cannot be omitted
-        // According to Anthropic documentation: https://docs.anthropic.com/en/api/messages
-        // The 'max_tokens' field is required and cannot be left empty
-        // Use provided value if > 0, otherwise use default of 1024
-        doc["max_tokens"] = (maxTokens > 0) ? maxTokens : 1024;
-        
-        // Add system message if specified (only if user has set it with setTCChatSystemRole)
-        if (systemMessage.length() > 0) {
-            doc["system"] = systemMessage;
-        }
+        JsonDocument toolsDoc;
         
         // Create tools array
-        JsonArray tools = doc["tools"].to<JsonArray>();
-        
+        JsonArray tools = toolsDoc.to<JsonArray>();
+    
         // Add each tool to the tools array
         for (int i = 0; i < toolsArraySize; i++) {
             // Parse the tool definition from the input array
             JsonDocument toolDoc;
             DeserializationError error = deserializeJson(toolDoc, toolsArray[i]);
-            
+        
             if (error) {
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Error parsing tool JSON: " + String(error.c_str()));
-                #endif
+                errorMsg = "Invalid JSON in tool #" + String(i+1) + ": " + String(error.c_str());
                 return "";
             }
-            
+        
             // Create a new tool object in Claude's format
             JsonObject tool = tools.add<JsonObject>();
-            
+        
             // Extract data from the library's tool format and convert to Claude's format
             if (!toolDoc["type"].isNull() && !toolDoc["function"].isNull()) {
                 // OpenAI-style tool format: convert to Claude format
                 JsonObject function = toolDoc["function"];
-                
+            
                 // Add name and description
                 tool["name"] = function["name"].as<String>();
                 tool["description"] = function["description"].as<String>();
-                
+            
                 // Add input schema
                 JsonObject inputSchema = tool["input_schema"].to<JsonObject>();
-                
+            
                 // Copy parameters object to input_schema
                 if (!function["parameters"].isNull()) {
                     JsonObject params = function["parameters"];
-                    
+                
                     // Directly copy parameters
                     for (JsonPair kv : params) {
                         inputSchema[kv.key()] = kv.value();
@@ -217,18 +258,18 @@ String AI_API_Claude_Handler::buildToolCallsRequestBody(const String& modelName,
             } else {
                 // Simpler format - copy directly
                 tool["name"] = toolDoc["name"].as<String>();
-                
+            
                 if (!toolDoc["description"].isNull()) {
                     tool["description"] = toolDoc["description"].as<String>();
                 }
-                
+            
                 // Add input schema
                 JsonObject inputSchema = tool["input_schema"].to<JsonObject>();
-                
+            
                 // Copy parameters object to input_schema
                 if (!toolDoc["parameters"].isNull()) {
                     JsonObject params = toolDoc["parameters"];
-                    
+                
                     // Directly copy parameters
                     for (JsonPair kv : params) {
                         inputSchema[kv.key()] = kv.value();
@@ -237,8 +278,56 @@ String AI_API_Claude_Handler::buildToolCallsRequestBody(const String& modelName,
             }
         }
         
+        // A cache breakpoint on the last tool caches all tool definitions
+        if (_promptCaching && tools.size() > 0) {
+            tools[tools.size() - 1]["cache_control"]["type"] = "ephemeral";
+        }
+        
+        String toolsJson;
+        serializeJson(toolsDoc, toolsJson);
+        return toolsJson;
+    }
+    catch (const std::exception& e) {
+        errorMsg = "Exception while converting tools: " + String(e.what());
+        return "";
+    }
+}
+
+// Build tool calls request body for Claude API
+bool AI_API_Claude_Handler::buildToolCallsRequestBody(const String& modelName,
+                                                    const String& toolsJson,
+                                                    const String& systemMessage, const String& toolChoice,
+                                                    int maxTokens,
+                                                    const String& userMessage, JsonDocument& doc,
+                                                    const AI_API_Chat_History* history) {
+    resetState();  // Reset finish reason and token count
+    
+    try {
+        // Clear the document first to ensure no leftover fields
+        doc.clear();
+        
+        // Set the model
+        doc["model"] = modelName;
+        
+        // IMPORTANT: Claude API requires 'max_tokens' field - it cannot be omitted
+        // According to Anthropic documentation: https://docs.anthropic.com/en/api/messages
+        // The 'max_tokens' field is required and cannot be left empty
+        // Use provided value if > 0, otherwise use default of 1024
+        doc["max_tokens"] = (maxTokens > 0) ? maxTokens : 1024;
+        
+        // Add system message if specified (only if user has set it with setTCChatSystemRole)
+        if (systemMessage.length() > 0) {
+            _setSystem(doc, systemMessage);
+        }
+        
+        // Add tools array (converted once by buildToolsJson)
+        doc["tools"] = serialized(toolsJson);
+
         // Create messages array with user message
         JsonArray messages = doc["messages"].to<JsonArray>();
+        // Previous conversation turns (empty unless chat history is enabled)
+        appendHistoryMessages(messages, history);
+        
         JsonObject userMsg = messages.add<JsonObject>();
         userMsg["role"] = "user";
         userMsg["content"] = userMessage;
@@ -279,32 +368,23 @@ String AI_API_Claude_Handler::buildToolCallsRequestBody(const String& modelName,
                     }
                 } else {
                     // Not valid JSON - add as object with type field but this will likely cause an API error
-                    #ifdef ENABLE_DEBUG_OUTPUT
-                    Serial.println("Warning: tool_choice value is not valid JSON: " + trimmedChoice);
-                    #endif
+                    AI_API_LOGW("tool_choice value is not valid JSON: %s", trimmedChoice.c_str());
                     JsonObject toolChoiceObj = doc["tool_choice"].to<JsonObject>();
                     toolChoiceObj["type"] = trimmedChoice;
                 }
             } else {
                 // Not a recognized string value or JSON - add as object with type field but will likely cause an API error
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Warning: tool_choice value is not recognized: " + trimmedChoice);
-                #endif
+                AI_API_LOGW("tool_choice value is not recognized: %s", trimmedChoice.c_str());
                 JsonObject toolChoiceObj = doc["tool_choice"].to<JsonObject>();
                 toolChoiceObj["type"] = trimmedChoice;
             }
         }
         
-        // Serialize the request body
-        String requestBody;
-        serializeJson(doc, requestBody);
-        return requestBody;
+        return true;
     } 
     catch (const std::exception& e) {
-        #ifdef ENABLE_DEBUG_OUTPUT
-        Serial.println("Exception in buildToolCallsRequestBody: " + String(e.what()));
-        #endif
-        return "";
+        AI_API_LOGE("Exception in buildToolCallsRequestBody: %s", e.what());
+        return false;
     }
 }
 
@@ -312,10 +392,21 @@ String AI_API_Claude_Handler::buildToolCallsRequestBody(const String& modelName,
 String AI_API_Claude_Handler::parseToolCallsResponseBody(const String& responsePayload,
                                                     String& errorMsg, JsonDocument& doc) {
     resetState();  // Reset finish reason and token count
-    
+
+    DeserializationError error = deserializeJson(doc, responsePayload, DeserializationOption::Filter(_toolCallsResponseFilter));
+    return _extractToolCallsResponseContent(error, errorMsg, doc);
+}
+
+String AI_API_Claude_Handler::parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) {
+    resetState();  // Reset finish reason and token count
+
+    DeserializationError error = deserializeJson(doc, responseStream, DeserializationOption::Filter(_toolCallsResponseFilter));
+    return _extractToolCallsResponseContent(error, errorMsg, doc);
+}
+
+// Extract the content from a deserialized response (shared by the String and Stream variants)
+String AI_API_Claude_Handler::_extractToolCallsResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc) {
     try {
-        // Parse the JSON response
-        DeserializationError error = deserializeJson(doc, responsePayload);
         if (error) {
             errorMsg = "JSON parsing error: " + String(error.c_str());
             return "";
@@ -333,7 +424,7 @@ String AI_API_Claude_Handler::parseToolCallsResponseBody(const String& responseP
         
         // Extract token count if available
         if (!doc["usage"].isNull()) {
-            _lastTotalTokens = doc["usage"]["input_tokens"].as<int>() + 
+            _lastTotalTokens = _inputTokens(doc["usage"]) + 
                               doc["usage"]["output_tokens"].as<int>();
         }
         
@@ -396,9 +487,7 @@ String AI_API_Claude_Handler::parseToolCallsResponseBody(const String& responseP
             String toolCallsJson;
             serializeJson(toolCalls, toolCallsJson);
             
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Tool calls detected: " + toolCallsJson);
-            #endif
+            AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Tool calls detected", toolCallsJson.c_str(), toolCallsJson.length());
             
             return toolCallsJson;
         } 
@@ -419,24 +508,23 @@ String AI_API_Claude_Handler::parseToolCallsResponseBody(const String& responseP
     catch (const std::exception& e) {
         errorMsg = "Exception during response parsing: " + String(e.what());
         
-        #ifdef ENABLE_DEBUG_OUTPUT
-        Serial.println("Exception in parseToolCallsResponseBody: " + String(e.what()));
-        #endif
+        AI_API_LOGE("Exception in parseToolCallsResponseBody: %s", e.what());
         
         return "";
     }
 }
 
 // Build follow-up request with tool results
-String AI_API_Claude_Handler::buildToolCallsFollowUpRequestBody(const String& modelName,
-                                                           const String* toolsArray, int toolsArraySize,
+bool AI_API_Claude_Handler::buildToolCallsFollowUpRequestBody(const String& modelName,
+                                                           const String& toolsJson,
                                                            const String& systemMessage, const String& toolChoice,
                                                            const String& lastUserMessage,
                                                            const String& lastAssistantToolCallsJson,
                                                            const String& toolResultsJson,
                                                            int followUpMaxTokens,
                                                            const String& followUpToolChoice,
-                                                           JsonDocument& doc) {
+                                                           JsonDocument& doc,
+                                                           const AI_API_Chat_History* history) {
     resetState();  // Reset finish reason and token count
     
     try {
@@ -454,204 +542,26 @@ String AI_API_Claude_Handler::buildToolCallsFollowUpRequestBody(const String& mo
         
         // Add system message if specified (only if user has set it with setTCChatSystemRole)
         if (systemMessage.length() > 0) {
-            doc["system"] = systemMessage;
-        }
-        
-        // Create tools array (same as in the original request)
-        JsonArray tools = doc["tools"].to<JsonArray>();
-        
-        // Add each tool to the tools array
-        for (int i = 0; i < toolsArraySize; i++) {
-            // Parse the tool definition from the input array
-            JsonDocument toolDoc;
-            DeserializationError error = deserializeJson(toolDoc, toolsArray[i]);
-            
-            if (error) {
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Error parsing tool JSON in follow-up: " + String(error.c_str()));
-                #endif
-                return "";
-            }
-            
-            // Create a new tool object in Claude's format
-            JsonObject tool = tools.add<JsonObject>();
-            
-            // Extract data from the library's tool format and convert to Claude's format
-            if (!toolDoc["type"].isNull() && !toolDoc["function"].isNull()) {
-                // OpenAI-style tool format: convert to Claude format
-                JsonObject function = toolDoc["function"];
-                
-                // Add name and description
-                tool["name"] = function["name"].as<String>();
-                tool["description"] = function["description"].as<String>();
-                
-                // Add input schema
-                JsonObject inputSchema = tool["input_schema"].to<JsonObject>();
-                
-                // Copy parameters object to input_schema
-                if (!function["parameters"].isNull()) {
-                    JsonObject params = function["parameters"];
-                    
-                    // Directly copy parameters
-                    for (JsonPair kv : params) {
-                        inputSchema[kv.key()] = kv.value();
-                    }
-                }
-            } else {
-                // Simpler format - copy directly
-                tool["name"] = toolDoc["name"].as<String>();
-                
-                if (!toolDoc["description"].isNull()) {
-                    tool["description"] = toolDoc["description"].as<String>();
-                }
-                
-                // Add input schema
-                JsonObject inputSchema = tool["input_schema"].to<JsonObject>();
-                
-                // Copy parameters object to input_schema
-                if (!toolDoc["parameters"].isNull()) {
-                    JsonObject params = toolDoc["parameters"];
-                    
-                    // Directly copy parameters
-                    for (JsonPair kv : params) {
-                        inputSchema[kv.key()] = kv.value();
-                    }
-                }
-            }
+            _setSystem(doc, systemMessage);
         }
         
+        // Add tools array (converted once by buildToolsJson)
+        doc["tools"] = serialized(toolsJson);
+
         // Create messages array
         JsonArray messages = doc["messages"].to<JsonArray>();
         
+        // Previous conversation turns (empty unless chat history is enabled)
+        appendHistoryMessages(messages, history);
+        
         // Add original user message
         JsonObject userMsg = messages.add<JsonObject>();
         userMsg["role"] = "user";
         userMsg["content"] = lastUserMessage;
         
-        // Parse the assistant's response to extract the tool_use content
-        JsonDocument assistantResponseDoc;
-        DeserializationError assistantError = deserializeJson(assistantResponseDoc, lastAssistantToolCallsJson);
-        
-        if (assistantError) {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Error parsing assistant tool calls: " + String(assistantError.c_str()));
-            #endif
-            return ""; // Error parsing assistant's tool calls
-        }
-        
-        // Add assistant's response as a message
-        JsonObject assistantMsg = messages.add<JsonObject>();
-        assistantMsg["role"] = "assistant";
-        
-        // Create content array for assistant message
-        JsonArray assistantContent = assistantMsg["content"].to<JsonArray>();
-        
-        // Check if the assistant response is already in Claude's format
-        // (it might be the direct response from Claude with content array)
-        if (assistantResponseDoc["content"].is<JsonArray>()) {
-            // Copy the entire content array from the original response
-            JsonArray originalContent = assistantResponseDoc["content"];
-            for (size_t i = 0; i < originalContent.size(); i++) {
-                // Deep copy each element in the content array
-                assistantContent.add(originalContent[i]);
-            }
-        } 
-        // If it's in our library's format (array of tool calls)
-        else if (assistantResponseDoc.is<JsonArray>()) {
-            // First add a placeholder text element (required by Claude)
-            JsonObject textBlock = assistantContent.add<JsonObject>();
-            textBlock["type"] = "text";
-            textBlock["text"] = "I'll help you with that.";
-            
-            // Then add the tool_use blocks
-            JsonArray toolCalls = assistantResponseDoc.as<JsonArray>();
-            for (JsonObject toolCall : toolCalls) {
-                JsonObject toolUseBlock = assistantContent.add<JsonObject>();
-                toolUseBlock["type"] = "tool_use";
-                toolUseBlock["id"] = toolCall["id"].as<String>();
-                toolUseBlock["name"] = toolCall["function"]["name"].as<String>();
-                
-                // Handle input parameters
-                JsonObject inputObj = toolUseBlock["input"].to<JsonObject>();
-                // Parse arguments string to object
-                String argsStr = toolCall["function"]["arguments"].as<String>();
-                JsonDocument argsDoc;
-                DeserializationError argsError = deserializeJson(argsDoc, argsStr);
-                if (!argsError) {
-                    // Copy arguments to input
-                    for (JsonPair kv : argsDoc.as<JsonObject>()) {
-                        inputObj[kv.key()] = kv.value();
-                    }
-                } else {
-                    #ifdef ENABLE_DEBUG_OUTPUT
-                    Serial.println("Error parsing tool arguments: " + String(argsError.c_str()));
-                    #endif
-                }
-            }
-        }
-        
-        // Add user's tool result message according to Claude's format
-        JsonObject toolResultMsg = messages.add<JsonObject>();
-        toolResultMsg["role"] = "user";
-        
-        // Create content array for tool result message
-        JsonArray toolResultContent = toolResultMsg["content"].to<JsonArray>();
-        
-        // Parse the tool results JSON and format for Claude
-        JsonDocument resultsDoc;
-        DeserializationError resultsError = deserializeJson(resultsDoc, toolResultsJson);
-        
-        if (resultsError) {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Error parsing tool results: " + String(resultsError.c_str()));
-            #endif
-            return ""; // Error parsing tool results
-        }
-        
-        // Process each tool result following Claude's format
-        JsonArray resultsArray = resultsDoc.as<JsonArray>();
-        for (JsonObject result : resultsArray) {
-            // Create tool_result content block
-            JsonObject toolResultBlock = toolResultContent.add<JsonObject>();
-            toolResultBlock["type"] = "tool_result";
-            
-            // Set the tool_use_id from tool_call_id
-            if (!result["tool_call_id"].isNull()) {
-                toolResultBlock["tool_use_id"] = result["tool_call_id"].as<String>();
-            } else {
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Warning: tool_call_id missing in tool result");
-                #endif
-                continue; // Skip this result if no tool_call_id
-            }
-            
-            // Handle function output - for Claude we need to send the content directly
-            if (result["function"].is<JsonObject>() && !result["function"]["output"].isNull()) {
-                String output = result["function"]["output"].as<String>();
-                
-                // Check if output is a JSON string by looking for { at the beginning
-                if (output.startsWith("{")) {
-                    // Try to parse as JSON to see if it's valid
-                    JsonDocument outputDoc;
-                    DeserializationError outputError = deserializeJson(outputDoc, output);
-                    
-                    if (!outputError) {
-                        // It's valid JSON, directly assign as content
-                        toolResultBlock["content"] = output;
-                    } else {
-                        // Not valid JSON, just use as plain text
-                        toolResultBlock["content"] = output;
-                    }
-                } else {
-                    // Plain text output
-                    toolResultBlock["content"] = output;
-                }
-            }
-            
-            // Add is_error flag if present
-            if (!result["is_error"].isNull() && result["is_error"].as<bool>()) {
-                toolResultBlock["is_error"] = true;
-            }
+        // Add the assistant's tool calls and their results
+        if (!_appendToolCallsRound(messages, lastAssistantToolCallsJson, toolResultsJson)) {
+            return false;
         }
         
         // Add tool_choice if specified for the follow-up by user with setTCReplyToolChoice
@@ -690,48 +600,165 @@ String AI_API_Claude_Handler::buildToolCallsFollowUpRequestBody(const String& mo
                     }
                 } else {
                     // Not valid JSON - add as object with type field but this will likely cause an API error
-                    #ifdef ENABLE_DEBUG_OUTPUT
-                    Serial.println("Warning: tool_choice value is not valid JSON: " + trimmedChoice);
-                    #endif
+                    AI_API_LOGW("tool_choice value is not valid JSON: %s", trimmedChoice.c_str());
                     JsonObject toolChoiceObj = doc["tool_choice"].to<JsonObject>();
                     toolChoiceObj["type"] = trimmedChoice;
                 }
             } else {
                 // Not a recognized string value or JSON - add as object with type field but will likely cause an API error
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Warning: tool_choice value is not recognized: " + trimmedChoice);
-                #endif
+                AI_API_LOGW("tool_choice value is not recognized: %s", trimmedChoice.c_str());
                 JsonObject toolChoiceObj = doc["tool_choice"].to<JsonObject>();
                 toolChoiceObj["type"] = trimmedChoice;
             }
         }
         
-        // Serialize the request body
-        String requestBody;
-        serializeJson(doc, requestBody);
         
-        #ifdef ENABLE_DEBUG_OUTPUT
-        Serial.println("---------- Claude Tool Calls Follow-up Request ----------");
-        Serial.println(requestBody);
-        Serial.println("----------------------------------------------------------");
-        #endif
+        AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Claude tool calls follow-up body", doc);
         
-        return requestBody;
+        return true;
     } 
     catch (const std::exception& e) {
-        #ifdef ENABLE_DEBUG_OUTPUT
-        Serial.println("Exception in buildToolCallsFollowUpRequestBody: " + String(e.what()));
-        #endif
-        return "";
+        AI_API_LOGE("Exception in buildToolCallsFollowUpRequestBody: %s", e.what());
+        return false;
+    }
+}
+
+bool AI_API_Claude_Handler::appendToolCallsRound(const String& assistantToolCallsJson,
+                                                const String& toolResultsJson, JsonDocument& doc) {
+    JsonArray messages = doc["messages"];
+    if (messages.isNull()) return false;
+    return _appendToolCallsRound(messages, assistantToolCallsJson, toolResultsJson);
+}
+
+bool AI_API_Claude_Handler::_appendToolCallsRound(JsonArray messages, const String& lastAssistantToolCallsJson,
+                                                  const String& toolResultsJson) {
+    // Parse the assistant's response to extract the tool_use content
+    JsonDocument assistantResponseDoc;
+    DeserializationError assistantError = deserializeJson(assistantResponseDoc, lastAssistantToolCallsJson);
+    
+    if (assistantError) {
+        AI_API_LOGE("Error parsing assistant tool calls: %s", assistantError.c_str());
+        return false; // Error parsing assistant's tool calls
+    }
+    
+    // Add assistant's response as a message
+    JsonObject assistantMsg = messages.add<JsonObject>();
+    assistantMsg["role"] = "assistant";
+    
+    // Create content array for assistant message
+    JsonArray assistantContent = assistantMsg["content"].to<JsonArray>();
+    
+    // Check if the assistant response is already in Claude's format
+    // (it might be the direct response from Claude with content array)
+    if (assistantResponseDoc["content"].is<JsonArray>()) {
+        // Copy the entire content array from the original response
+        JsonArray originalContent = assistantResponseDoc["content"];
+        for (size_t i = 0; i < originalContent.size(); i++) {
+            // Deep copy each element in the content array
+            assistantContent.add(originalContent[i]);
+        }
+    } 
+    // If it's in our library's format (array of tool calls)
+    else if (assistantResponseDoc.is<JsonArray>()) {
+        // First add a placeholder text element (required by Claude)
+        JsonObject textBlock = assistantContent.add<JsonObject>();
+        textBlock["type"] = "text";
+        textBlock["text"] = "I'll help you with that.";
+        
+        // Then add the tool_use blocks
+        JsonArray toolCalls = assistantResponseDoc.as<JsonArray>();
+        for (JsonObject toolCall : toolCalls) {
+            JsonObject toolUseBlock = assistantContent.add<JsonObject>();
+            toolUseBlock["type"] = "tool_use";
+            toolUseBlock["id"] = toolCall["id"].as<String>();
+            toolUseBlock["name"] = toolCall["function"]["name"].as<String>();
+            
+            // Handle input parameters
+            JsonObject inputObj = toolUseBlock["input"].to<JsonObject>();
+            // Parse arguments string to object
+            String argsStr = toolCall["function"]["arguments"].as<String>();
+            JsonDocument argsDoc;
+            DeserializationError argsError = deserializeJson(argsDoc, argsStr);
+            if (!argsError) {
+                // Copy arguments to input
+                for (JsonPair kv : argsDoc.as<JsonObject>()) {
+                    inputObj[kv.key()] = kv.value();
+                }
+            } else {
+                AI_API_LOGE("Error parsing tool arguments: %s", argsError.c_str());
+            }
+        }
+    }
+    
+    // Add user's tool result message according to Claude's format
+    JsonObject toolResultMsg = messages.add<JsonObject>();
+    toolResultMsg["role"] = "user";
+    
+    // Create content array for tool result message
+    JsonArray toolResultContent = toolResultMsg["content"].to<JsonArray>();
+    
+    // Parse the tool results JSON and format for Claude
+    JsonDocument resultsDoc;
+    DeserializationError resultsError = deserializeJson(resultsDoc, toolResultsJson);
+    
+    if (resultsError) {
+        AI_API_LOGE("Error parsing tool results: %s", resultsError.c_str());
+        return false; // Error parsing tool results
+    }
+    
+    // Process each tool result following Claude's format
+    JsonArray resultsArray = resultsDoc.as<JsonArray>();
+    for (JsonObject result : resultsArray) {
+        // Create tool_result content block
+        JsonObject toolResultBlock = toolResultContent.add<JsonObject>();
+        toolResultBlock["type"] = "tool_result";
+        
+        // Set the tool_use_id from tool_call_id
+        if (!result["tool_call_id"].isNull()) {
+            toolResultBlock["tool_use_id"] = result["tool_call_id"].as<String>();
+        } else {
+            AI_API_LOGW("tool_call_id missing in tool result");
+            continue; // Skip this result if no tool_call_id
+        }
+        
+        // Handle function output - for Claude we need to send the content directly
+        if (result["function"].is<JsonObject>() && !result["function"]["output"].isNull()) {
+            String output = result["function"]["output"].as<String>();
+            
+            // Check if output is a JSON string by looking for { at the beginning
+            if (output.startsWith("{")) {
+                // Try to parse as JSON to see if it's valid
+                JsonDocument outputDoc;
+                DeserializationError outputError = deserializeJson(outputDoc, output);
+                
+                if (!outputError) {
+                    // It's valid JSON, directly assign as content
+                    toolResultBlock["content"] = output;
+                } else {
+                    // Not valid JSON, just use as plain text
+                    toolResultBlock["content"] = output;
+                }
+            } else {
+                // Plain text output
+                toolResultBlock["content"] = output;
+            }
+        }
+        
+        // Add is_error flag if present
+        if (!result["is_error"].isNull() && result["is_error"].as<bool>()) {
+            toolResultBlock["is_error"] = true;
+        }
     }
+    return true;
 }
 #endif // ENABLE_TOOL_CALLS
 
 #ifdef ENABLE_STREAM_CHAT
-String AI_API_Claude_Handler::buildStreamRequestBody(const String& modelName, const String& systemRole,
+bool AI_API_Claude_Handler::buildStreamRequestBody(const String& modelName, const String& systemRole,
                                                     float temperature, int maxTokens,
                                                     const String& userMessage, JsonDocument& doc,
-                                                    const String& customParams) {
+                                                    JsonObjectConst customParams,
+                                                    const AI_API_Chat_History* history) {
     try {
         // Use the same logic as buildRequestBody but add "stream": true
         
@@ -741,21 +768,14 @@ String AI_API_Claude_Handler::buildStreamRequestBody(const String& modelName, co
         // Enable streaming
         doc["stream"] = true;
         
-        // Process custom parameters if provided
-        if (customParams.length() > 0) {
-            // Create a temporary document to parse the custom parameters
-            JsonDocument paramsDoc;
-            DeserializationError error = deserializeJson(paramsDoc, customParams);
-            
-            // Only proceed if parsing was successful
-            if (!error) {
-                // Add each parameter from customParams to the request (skip conflicting ones)
-                for (JsonPair param : paramsDoc.as<JsonObject>()) {
-                    // Skip model, messages, system, stream as they are handled separately
-                    if (param.key() != "model" && param.key() != "messages" && 
-                        param.key() != "system" && param.key() != "stream") {
-                        doc[param.key()] = param.value();
-                    }
+        // Copy custom parameters (parsed once by setChatParameters/setStreamChatParameters)
+        if (!customParams.isNull()) {
+            // Add each parameter from customParams to the request (skip conflicting ones)
+            for (JsonPairConst param : customParams) {
+                // Skip model, messages, system, stream as they are handled separately
+                if (param.key() != "model" && param.key() != "messages" && 
+                    param.key() != "system" && param.key() != "stream") {
+                    doc[param.key()] = param.value();
                 }
             }
         }
@@ -773,55 +793,56 @@ String AI_API_Claude_Handler::buildStreamRequestBody(const String& modelName, co
         
         // Add system message if specified
         if (systemRole.length() > 0) {
-            doc["system"] = systemRole;
+            _setSystem(doc, systemRole);
         }
         
         // Create messages array with user message
         JsonArray messages = doc["messages"].to<JsonArray>();
+        // Previous conversation turns (empty unless chat history is enabled)
+        appendHistoryMessages(messages, history);
+        
         JsonObject userMsg = messages.add<JsonObject>();
         userMsg["role"] = "user";
         userMsg["content"] = userMessage;
         
-        // Serialize the request body
-        String requestBody;
-        serializeJson(doc, requestBody);
-        return requestBody;
+        return true;
     } 
     catch (const std::exception& e) {
-        return "";
+        return false;
     }
 }
 
-String AI_API_Claude_Handler::processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) {
-    resetState(); // Reset state for each chunk
+void AI_API_Claude_Handler::beginStream() {
+    AI_API_Platform_Handler::beginStream();
+    _streamInputTokens = 0;
+    _streamOutputTokens = 0;
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    _streamToolBlockIndex = -1;
+    _streamToolCall = nullptr;
+#endif
+}
+
+String AI_API_Claude_Handler::processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) {
+    return _processStreamChunk(data, length, isComplete, errorMsg, _streamChunkFilter);
+}
+
+// Shared by the chat and tool calls streams, which differ in the fields their filter keeps
+String AI_API_Claude_Handler::_processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg,
+                                                  const JsonDocument& filter) {
     isComplete = false;
     errorMsg = "";
 
     // Claude streaming uses Server-Sent Events format
     // Format: "event: event_type\ndata: {json}\n" or just "data: {json}\n"
-    
-    if (rawChunk.isEmpty()) {
-        return "";
-    }
-
-    // Look for "data: " prefix (standard SSE format)
-    int dataIndex = rawChunk.indexOf("data: ");
-    if (dataIndex == -1) {
-        // Not a data line, might be event line or empty line, skip
-        return "";
-    }
+    // Only the data payload reaches this point; event lines are skipped by AI_API_SSE_Reader
 
-    // Extract JSON part after "data: "
-    String jsonPart = rawChunk.substring(dataIndex + 6); // 6 = length of "data: "
-    jsonPart.trim(); // Remove any whitespace
-
-    if (jsonPart.isEmpty()) {
+    if (length == 0) {
         return "";
     }
 
-    // Parse the JSON chunk
-    JsonDocument chunkDoc; // Larger buffer for Claude responses
-    DeserializationError error = deserializeJson(chunkDoc, jsonPart);
+    // Parse the JSON chunk directly from the stream buffer
+    JsonDocument& chunkDoc = _streamChunkDoc; // Reused for every chunk, cleared by deserializeJson()
+    DeserializationError error = deserializeJson(chunkDoc, data, length, DeserializationOption::Filter(filter));
     if (error) {
         errorMsg = "Failed to parse Claude streaming chunk JSON: " + String(error.c_str());
         return "";
@@ -841,11 +862,26 @@ String AI_API_Claude_Handler::processStreamChunk(const String& rawChunk, bool& i
 
     // Handle different event types according to Claude's streaming documentation
     if (eventType == "message_start") {
-        // Beginning of message - no content yet
+        // Beginning of message - no content yet, but it carries the input token count
+        if (!chunkDoc["message"]["usage"]["input_tokens"].isNull()) {
+            _streamInputTokens = _inputTokens(chunkDoc["message"]["usage"]);
+            _lastTotalTokens = _streamInputTokens + _streamOutputTokens;
+        }
         return "";
     }
     else if (eventType == "content_block_start") {
         // Start of a content block - no content yet
+#ifdef ENABLE_STREAM_TOOL_CALLS
+        // A tool_use block (only kept by the tool calls filter) starts a tool call
+        if (chunkDoc["content_block"]["type"] == "tool_use") {
+            _streamToolBlockIndex = chunkDoc["index"] | -1;
+            _streamToolCall = beginStreamToolCall();
+            if (_streamToolCall != nullptr) {
+                _streamToolCall->id = chunkDoc["content_block"]["id"] | "";
+                _streamToolCall->name = chunkDoc["content_block"]["name"] | "";
+            }
+        }
+#endif
         return "";
     }
     else if (eventType == "content_block_delta") {
@@ -859,11 +895,26 @@ String AI_API_Claude_Handler::processStreamChunk(const String& rawChunk, bool& i
                     return delta["text"].as<String>();
                 }
             }
+#ifdef ENABLE_STREAM_TOOL_CALLS
+            // A piece of the arguments of the tool call being streamed
+            else if (delta["type"] == "input_json_delta" && _streamToolCall != nullptr &&
+                     (chunkDoc["index"] | -1) == _streamToolBlockIndex) {
+                _streamToolCall->arguments += delta["partial_json"] | "";
+            }
+#endif
         }
         return "";
     }
     else if (eventType == "content_block_stop") {
         // End of a content block - no content
+#ifdef ENABLE_STREAM_TOOL_CALLS
+        // The arguments of a tool call are complete when its block ends
+        if (_streamToolBlockIndex >= 0 && (chunkDoc["index"] | -1) == _streamToolBlockIndex) {
+            completeStreamToolCalls();
+            _streamToolBlockIndex = -1;
+            _streamToolCall = nullptr;
+        }
+#endif
         return "";
     }
     else if (eventType == "message_delta") {
@@ -874,6 +925,11 @@ String AI_API_Claude_Handler::processStreamChunk(const String& rawChunk, bool& i
                 _lastFinishReason = delta["stop_reason"].as<String>();
             }
         }
+        // Output tokens so far (cumulative)
+        if (!chunkDoc["usage"]["output_tokens"].isNull()) {
+            _streamOutputTokens = chunkDoc["usage"]["output_tokens"].as<int>();
+            _lastTotalTokens = _streamInputTokens + _streamOutputTokens;
+        }
         return "";
     }
     else if (eventType == "message_stop") {
@@ -901,3 +957,24 @@ String AI_API_Claude_Handler::processStreamChunk(const String& rawChunk, bool& i
     return "";
 }
 #endif // ENABLE_STREAM_CHAT
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+bool AI_API_Claude_Handler::buildToolCallsStreamRequestBody(const String& modelName,
+                                                            const String& toolsJson,
+                                                            const String& systemMessage, const String& toolChoice,
+                                                            int maxTokens,
+                                                            const String& userMessage, JsonDocument& doc,
+                                                            const AI_API_Chat_History* history) {
+    // Same request as tcChat(), with "stream": true
+    if (!buildToolCallsRequestBody(modelName, toolsJson, systemMessage, toolChoice, maxTokens,
+                                   userMessage, doc, history)) {
+        return false;
+    }
+    doc["stream"] = true;
+    return true;
+}
+
+String AI_API_Claude_Handler::processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) {
+    return _processStreamChunk(data, length, isComplete, errorMsg, _toolCallsStreamChunkFilter);
+}
+#endif // ENABLE_STREAM_TOOL_CALLS
@@ -19,7 +19,7 @@
  * - System prompts
  * - Custom parameters via setChatParameters()
  */
-class AI_API_Claude_Handler : public AI_API_Platform_Handler {
+class AI_API_Claude_Handler final : public AI_API_Platform_Handler {
 public:
     // Constructor and destructor
     AI_API_Claude_Handler();
@@ -28,48 +28,106 @@ public:
     // Implementation of required virtual methods
     String getEndpoint(const String& modelName, const String& apiKey, const String& customEndpoint = "") const override;
     void setHeaders(HTTPClient& httpClient, const String& apiKey) override;
-    String buildRequestBody(const String& modelName, const String& systemRole,
+    bool buildRequestBody(const String& modelName, const String& systemRole,
                            float temperature, int maxTokens,
                            const String& userMessage, JsonDocument& doc,
-                           const String& customParams = "") override;
+                           JsonObjectConst customParams = JsonObjectConst(),
+                           const AI_API_Chat_History* history = nullptr) override;
     String parseResponseBody(const String& responsePayload,
                             String& errorMsg, JsonDocument& doc) override;
+    String parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) override;
                             
 #ifdef ENABLE_TOOL_CALLS
     // Tool calls support methods
-    String buildToolCallsRequestBody(const String& modelName,
-                               const String* toolsArray, int toolsArraySize,
+    String buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) override;
+    bool buildToolCallsRequestBody(const String& modelName,
+                               const String& toolsJson,
                                const String& systemMessage, const String& toolChoice,
                                int maxTokens,
-                               const String& userMessage, JsonDocument& doc) override;
+                               const String& userMessage, JsonDocument& doc,
+                               const AI_API_Chat_History* history = nullptr) override;
     
     String parseToolCallsResponseBody(const String& responsePayload,
                                 String& errorMsg, JsonDocument& doc) override;
+    String parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) override;
                                 
-    String buildToolCallsFollowUpRequestBody(const String& modelName,
-                                       const String* toolsArray, int toolsArraySize,
+    bool buildToolCallsFollowUpRequestBody(const String& modelName,
+                                       const String& toolsJson,
                                        const String& systemMessage, const String& toolChoice,
                                        const String& lastUserMessage,
                                        const String& lastAssistantToolCallsJson,
                                        const String& toolResultsJson,
                                        int followUpMaxTokens,
                                        const String& followUpToolChoice,
-                                       JsonDocument& doc) override;
+                                       JsonDocument& doc,
+                                       const AI_API_Chat_History* history = nullptr) override;
+    bool appendToolCallsRound(const String& assistantToolCallsJson,
+                              const String& toolResultsJson, JsonDocument& doc) override;
 #endif
 
 #ifdef ENABLE_STREAM_CHAT
     // Streaming chat methods
-    String buildStreamRequestBody(const String& modelName, const String& systemRole,
+    bool buildStreamRequestBody(const String& modelName, const String& systemRole,
                                 float temperature, int maxTokens,
                                 const String& userMessage, JsonDocument& doc,
-                                const String& customParams = "") override;
+                                JsonObjectConst customParams = JsonObjectConst(),
+                                const AI_API_Chat_History* history = nullptr) override;
                                 
-    String processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) override;
+    void beginStream() override;
+    String processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) override;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Streaming tool calls methods
+    bool buildToolCallsStreamRequestBody(const String& modelName,
+                                         const String& toolsJson,
+                                         const String& systemMessage, const String& toolChoice,
+                                         int maxTokens,
+                                         const String& userMessage, JsonDocument& doc,
+                                         const AI_API_Chat_History* history = nullptr) override;
+    String processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) override;
 #endif
                             
 private:
+#ifdef ENABLE_STREAM_CHAT
+    // Claude reports input tokens in message_start and output tokens in message_delta
+    int _streamInputTokens = 0;
+    int _streamOutputTokens = 0;
+    // Shared by the chat and tool calls streams (filter: the fields to keep)
+    String _processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg,
+                               const JsonDocument& filter);
+#endif
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    int _streamToolBlockIndex = -1;             // Content block of the tool call being streamed
+    StreamToolCall* _streamToolCall = nullptr;  // The call being streamed, nullptr if dropped
+#endif
+    // "system" as a string, or as a cacheable text block with prompt caching enabled
+    void _setSystem(JsonDocument& doc, const String& systemRole) const;
+    // Input tokens of a usage object including cache reads and writes, which Claude
+    // reports apart; sets the cache token counts
+    int _inputTokens(JsonObjectConst usage);
     // Claude API version - can be updated if needed
     String _apiVersion = "2023-06-01";
+    // Shared by the String and Stream parse variants
+    String _extractResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc);
+#ifdef ENABLE_TOOL_CALLS
+    String _extractToolCallsResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc);
+    // The assistant's tool calls and their results, as added to a follow-up body
+    bool _appendToolCallsRound(JsonArray messages, const String& lastAssistantToolCallsJson,
+                               const String& toolResultsJson);
+#endif
+
+    // Precomputed deserialization filters: only the fields this handler reads are kept
+    JsonDocument _responseFilter;
+#ifdef ENABLE_TOOL_CALLS
+    JsonDocument _toolCallsResponseFilter;
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    JsonDocument _streamChunkFilter;
+#endif
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    JsonDocument _toolCallsStreamChunkFilter;
+#endif
 };
 
 #endif // AI_API_CLAUDE_H
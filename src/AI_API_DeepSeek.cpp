@@ -6,6 +6,36 @@
 
 #include "AI_API_DeepSeek.h"
 
+AI_API_DeepSeek_Handler::AI_API_DeepSeek_Handler() {
+    // Non-streaming response: choices[0].message.content, finish_reason and usage.total_tokens
+    _responseFilter["error"] = true;
+    _responseFilter["usage"]["total_tokens"] = true;
+    _responseFilter["usage"]["prompt_cache_hit_tokens"] = true; // Context caching is automatic
+    _responseFilter["choices"][0]["finish_reason"] = true;
+    _responseFilter["choices"][0]["message"]["content"] = true;
+
+#ifdef ENABLE_TOOL_CALLS
+    // Tool calls response: same fields plus the complete tool_calls array
+    _toolCallsResponseFilter = _responseFilter;
+    _toolCallsResponseFilter["choices"][0]["message"]["tool_calls"] = true;
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+    // Stream chunk: choices[0].delta.content and finish_reason
+    _streamChunkFilter["error"] = true;
+    _streamChunkFilter["choices"][0]["finish_reason"] = true;
+    _streamChunkFilter["choices"][0]["delta"]["content"] = true;
+    _streamChunkFilter["usage"]["total_tokens"] = true; // Final chunk, when the server reports usage
+    _streamChunkFilter["usage"]["prompt_cache_hit_tokens"] = true;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Tool calls stream chunk: same fields plus the tool call deltas
+    _toolCallsStreamChunkFilter = _streamChunkFilter;
+    _toolCallsStreamChunkFilter["choices"][0]["delta"]["tool_calls"] = true;
+#endif
+}
+
 String AI_API_DeepSeek_Handler::getEndpoint(const String& modelName, const String& apiKey, const String& customEndpoint) const {
     if (customEndpoint.length() > 0) {
         return customEndpoint;
@@ -18,10 +48,11 @@ void AI_API_DeepSeek_Handler::setHeaders(HTTPClient& httpClient, const String& a
     httpClient.addHeader("Authorization", "Bearer " + apiKey);
 }
 
-String AI_API_DeepSeek_Handler::buildRequestBody(const String& modelName, const String& systemRole,
+bool AI_API_DeepSeek_Handler::buildRequestBody(const String& modelName, const String& systemRole,
                                                 float temperature, int maxTokens,
                                                 const String& userMessage, JsonDocument& doc,
-                                                const String& customParams) {
+                                                JsonObjectConst customParams,
+                                                const AI_API_Chat_History* history) {
     doc.clear();
 
     doc["model"] = modelName;
@@ -32,25 +63,21 @@ String AI_API_DeepSeek_Handler::buildRequestBody(const String& modelName, const
         systemMsg["role"] = "system";
         systemMsg["content"] = systemRole;
     }
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryMessages(messages, history);
+    
     JsonObject userMsg = messages.add<JsonObject>();
     userMsg["role"] = "user";
     userMsg["content"] = userMessage;
 
-    // Process custom parameters if provided
-    if (customParams.length() > 0) {
-        // Create a temporary document to parse the custom parameters
-        JsonDocument paramsDoc;
-        DeserializationError error = deserializeJson(paramsDoc, customParams);
-        
-        // Only proceed if parsing was successful
-        if (!error) {
-            // Add each parameter from customParams to the request
-            for (JsonPair param : paramsDoc.as<JsonObject>()) {
-                // Skip model and messages as they are handled separately
-                if (param.key() != "model" && param.key() != "messages") {
-                    // Copy the parameter to our request document
-                    doc[param.key()] = param.value();
-                }
+    // Copy custom parameters (parsed once by setChatParameters/setStreamChatParameters)
+    if (!customParams.isNull()) {
+        // Add each parameter from customParams to the request
+        for (JsonPairConst param : customParams) {
+            // Skip model and messages as they are handled separately
+            if (param.key() != "model" && param.key() != "messages") {
+                // Copy the parameter to our request document
+                doc[param.key()] = param.value();
             }
         }
     }
@@ -59,9 +86,7 @@ String AI_API_DeepSeek_Handler::buildRequestBody(const String& modelName, const
     if (temperature >= 0.0) doc["temperature"] = temperature;
     if (maxTokens > 0) doc["max_tokens"] = maxTokens; // DeepSeek uses max_tokens instead of max_completion_tokens
 
-    String requestBody;
-    serializeJson(doc, requestBody);
-    return requestBody;
+    return true;
 }
 
 String AI_API_DeepSeek_Handler::parseResponseBody(const String& responsePayload,
@@ -70,7 +95,21 @@ String AI_API_DeepSeek_Handler::parseResponseBody(const String& responsePayload,
     doc.clear();
     errorMsg = ""; // Clear previous error
 
-    DeserializationError error = deserializeJson(doc, responsePayload);
+    DeserializationError error = deserializeJson(doc, responsePayload, DeserializationOption::Filter(_responseFilter));
+    return _extractResponseContent(error, errorMsg, doc);
+}
+
+String AI_API_DeepSeek_Handler::parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) {
+    resetState(); // Reset finish reason and tokens before parsing
+    doc.clear();
+    errorMsg = ""; // Clear previous error
+
+    DeserializationError error = deserializeJson(doc, responseStream, DeserializationOption::Filter(_responseFilter));
+    return _extractResponseContent(error, errorMsg, doc);
+}
+
+// Extract the content from a deserialized response (shared by the String and Stream variants)
+String AI_API_DeepSeek_Handler::_extractResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc) {
     if (error) {
         errorMsg = "JSON Deserialization failed: " + String(error.c_str());
         return "";
@@ -87,6 +126,7 @@ String AI_API_DeepSeek_Handler::parseResponseBody(const String& responsePayload,
         if (!usage["total_tokens"].isNull()) {
             _lastTotalTokens = usage["total_tokens"].as<int>(); // Store in base class member
         }
+        _lastCachedTokens = usage["prompt_cache_hit_tokens"] | 0;
     }
 
     if (doc["choices"].is<JsonArray>() && doc["choices"].size() > 0) {
@@ -110,10 +150,11 @@ String AI_API_DeepSeek_Handler::parseResponseBody(const String& responsePayload,
 }
 
 #ifdef ENABLE_STREAM_CHAT
-String AI_API_DeepSeek_Handler::buildStreamRequestBody(const String& modelName, const String& systemRole,
+bool AI_API_DeepSeek_Handler::buildStreamRequestBody(const String& modelName, const String& systemRole,
                                                       float temperature, int maxTokens,
                                                       const String& userMessage, JsonDocument& doc,
-                                                      const String& customParams) {
+                                                      JsonObjectConst customParams,
+                                                      const AI_API_Chat_History* history) {
     // Use the same logic as buildRequestBody but add "stream": true
     doc.clear();
 
@@ -126,25 +167,21 @@ String AI_API_DeepSeek_Handler::buildStreamRequestBody(const String& modelName,
         systemMsg["role"] = "system";
         systemMsg["content"] = systemRole;
     }
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryMessages(messages, history);
+    
     JsonObject userMsg = messages.add<JsonObject>();
     userMsg["role"] = "user";
     userMsg["content"] = userMessage;
 
-    // Process custom parameters if provided
-    if (customParams.length() > 0) {
-        // Create a temporary document to parse the custom parameters
-        JsonDocument paramsDoc;
-        DeserializationError error = deserializeJson(paramsDoc, customParams);
-        
-        // Only proceed if parsing was successful
-        if (!error) {
-            // Add each parameter from customParams to the request
-            for (JsonPair param : paramsDoc.as<JsonObject>()) {
-                // Skip model, messages, stream as they are handled separately
-                if (param.key() != "model" && param.key() != "messages" && param.key() != "stream") {
-                    // Copy the parameter to our request document
-                    doc[param.key()] = param.value();
-                }
+    // Copy custom parameters (parsed once by setChatParameters/setStreamChatParameters)
+    if (!customParams.isNull()) {
+        // Add each parameter from customParams to the request
+        for (JsonPairConst param : customParams) {
+            // Skip model, messages, stream as they are handled separately
+            if (param.key() != "model" && param.key() != "messages" && param.key() != "stream") {
+                // Copy the parameter to our request document
+                doc[param.key()] = param.value();
             }
         }
     }
@@ -153,50 +190,36 @@ String AI_API_DeepSeek_Handler::buildStreamRequestBody(const String& modelName,
     if (temperature >= 0.0) doc["temperature"] = temperature;
     if (maxTokens > 0) doc["max_tokens"] = maxTokens; // DeepSeek uses max_tokens instead of max_completion_tokens
 
-    String requestBody;
-    serializeJson(doc, requestBody);
-    return requestBody;
+    return true;
 }
 
-String AI_API_DeepSeek_Handler::processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) {
-    resetState(); // Reset state for each chunk
+String AI_API_DeepSeek_Handler::processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) {
+    return _processStreamChunk(data, length, isComplete, errorMsg, _streamChunkFilter);
+}
+
+// Shared by the chat and tool calls streams, which differ in the fields their filter keeps
+String AI_API_DeepSeek_Handler::_processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg,
+                                       const JsonDocument& filter) {
     isComplete = false;
     errorMsg = "";
 
     // DeepSeek uses the same Server-Sent Events (SSE) format as OpenAI
     // Format: "data: {json}\n" or "data: [DONE]\n"
-    
-    if (rawChunk.isEmpty()) {
+    // data holds the payload after "data:", already trimmed by AI_API_SSE_Reader
+
+    if (length == 0) {
         return "";
     }
 
     // Check for completion marker
-    if (rawChunk.indexOf("[DONE]") != -1) {
+    if (length == 6 && strncmp(data, "[DONE]", 6) == 0) {
         isComplete = true;
         return "";
     }
 
-    // Look for "data: " prefix
-    int dataIndex = rawChunk.indexOf("data: ");
-    if (dataIndex == -1) {
-        // Not a data line, skip
-        return "";
-    }
-
-    // Extract JSON part after "data: "
-    String jsonPart = rawChunk.substring(dataIndex + 6); // 6 = length of "data: "
-    jsonPart.trim(); // Remove any whitespace
-
-    if (jsonPart.isEmpty() || jsonPart == "[DONE]") {
-        if (jsonPart == "[DONE]") {
-            isComplete = true;
-        }
-        return "";
-    }
-
-    // Parse the JSON chunk
-    JsonDocument chunkDoc;
-    DeserializationError error = deserializeJson(chunkDoc, jsonPart);
+    // Parse the JSON chunk directly from the stream buffer
+    JsonDocument& chunkDoc = _streamChunkDoc; // Reused for every chunk, cleared by deserializeJson()
+    DeserializationError error = deserializeJson(chunkDoc, data, length, DeserializationOption::Filter(filter));
     if (error) {
         errorMsg = "Failed to parse streaming chunk JSON: " + String(error.c_str());
         return "";
@@ -208,6 +231,12 @@ String AI_API_DeepSeek_Handler::processStreamChunk(const String& rawChunk, bool&
         return "";
     }
 
+    // Token usage, sent with (or after) the finishing chunk
+    if (!chunkDoc["usage"]["total_tokens"].isNull()) {
+        _lastTotalTokens = chunkDoc["usage"]["total_tokens"].as<int>();
+        _lastCachedTokens = chunkDoc["usage"]["prompt_cache_hit_tokens"] | 0;
+    }
+
     // Extract content from delta.content (same format as OpenAI)
     if (chunkDoc["choices"].is<JsonArray>() && 
         chunkDoc["choices"].size() > 0) {
@@ -219,11 +248,31 @@ String AI_API_DeepSeek_Handler::processStreamChunk(const String& rawChunk, bool&
             !firstChoice["finish_reason"].isNull()) {
             isComplete = true;
             _lastFinishReason = firstChoice["finish_reason"].as<String>();
+#ifdef ENABLE_STREAM_TOOL_CALLS
+            completeStreamToolCalls();
+#endif
         }
         
         // Extract delta content
         if (firstChoice["delta"].is<JsonObject>()) {
             JsonObject delta = firstChoice["delta"];
+#ifdef ENABLE_STREAM_TOOL_CALLS
+            // Tool call deltas (only kept by the tool calls filter): the first delta of a call
+            // carries its id and name, the next ones pieces of its arguments
+            for (JsonObject toolCallDelta : delta["tool_calls"].as<JsonArray>()) {
+                int index = toolCallDelta["index"] | 0;
+                if (_streamToolCallCount == 0 || index != _streamToolCallIndex) {
+                    completeStreamToolCalls(); // The next call ends the previous one
+                    _streamToolCallIndex = index;
+                    _streamToolCall = beginStreamToolCall();
+                }
+                if (_streamToolCall == nullptr) continue; // Dropped
+                if (toolCallDelta["id"].is<const char*>()) _streamToolCall->id = toolCallDelta["id"].as<const char*>();
+                JsonObject function = toolCallDelta["function"];
+                if (function["name"].is<const char*>()) _streamToolCall->name += function["name"].as<const char*>();
+                if (function["arguments"].is<const char*>()) _streamToolCall->arguments += function["arguments"].as<const char*>();
+            }
+#endif
             if (delta["content"].is<const char*>()) {
                 return delta["content"].as<String>();
             }
@@ -235,88 +284,13 @@ String AI_API_DeepSeek_Handler::processStreamChunk(const String& rawChunk, bool&
 #endif
 
 #ifdef ENABLE_TOOL_CALLS
-String AI_API_DeepSeek_Handler::buildToolCallsRequestBody(const String& modelName,
-                                                         const String* toolsArray, int toolsArraySize,
-                                                         const String& systemMessage, const String& toolChoice,
-                                                         int maxTokens,
-                                                         const String& userMessage, JsonDocument& doc) {
-    // Clear the document first
-    doc.clear();
+// Convert the tool definitions to the DeepSeek "tools" array
+String AI_API_DeepSeek_Handler::buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) {
+    errorMsg = "";
+    JsonDocument toolsDoc;
 
-    // Set the model
-    doc["model"] = modelName;
-    
-    // Add max_tokens parameter if specified (DeepSeek uses max_tokens)
-    if (maxTokens > 0) {
-        doc["max_tokens"] = maxTokens;
-    }
-    
-    // Add messages array
-    JsonArray messages = doc["messages"].to<JsonArray>();
-    
-    // Add system message if specified
-    if (systemMessage.length() > 0) {
-        JsonObject systemMsg = messages.add<JsonObject>();
-        systemMsg["role"] = "system";
-        systemMsg["content"] = systemMessage;
-    }
-    
-    // Add user message
-    JsonObject userMsg = messages.add<JsonObject>();
-    userMsg["role"] = "user";
-    userMsg["content"] = userMessage;
-    
-    // Add tool_choice if specified (same format as OpenAI)
-    if (toolChoice.length() > 0) {
-        String trimmedChoice = toolChoice;
-        trimmedChoice.trim();
-        
-        // Check if it's one of the allowed string values
-        if (trimmedChoice == "auto" || trimmedChoice == "none" || trimmedChoice == "required") {
-            // Simple string values can be added directly
-            doc["tool_choice"] = trimmedChoice;
-        } 
-        // Check if it starts with { - might be a JSON object string
-        else if (trimmedChoice.startsWith("{")) {
-            // Try to parse it as a JSON object
-            JsonDocument toolChoiceDoc;
-            DeserializationError error = deserializeJson(toolChoiceDoc, trimmedChoice);
-            
-            if (!error) {
-                // Successfully parsed as JSON - add as an object
-                JsonObject toolChoiceObj = doc["tool_choice"].to<JsonObject>();
-                
-                // Copy all fields from the parsed JSON
-                for (JsonPair kv : toolChoiceDoc.as<JsonObject>()) {
-                    if (kv.value().is<JsonObject>()) {
-                        JsonObject subObj = toolChoiceObj[kv.key().c_str()].to<JsonObject>();
-                        JsonObject srcSubObj = kv.value().as<JsonObject>();
-                        
-                        for (JsonPair subKv : srcSubObj) {
-                            subObj[subKv.key().c_str()] = subKv.value();
-                        }
-                    } else {
-                        toolChoiceObj[kv.key().c_str()] = kv.value();
-                    }
-                }
-            } else {
-                // Not valid JSON - add as string but this will likely cause an API error
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Warning: tool_choice value is not valid JSON: " + trimmedChoice);
-                #endif
-                doc["tool_choice"] = trimmedChoice;
-            }
-        } else {
-            // Not a recognized string value or JSON - add as string but will likely cause an API error
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Warning: tool_choice value is not recognized: " + trimmedChoice);
-            #endif
-            doc["tool_choice"] = trimmedChoice;
-        }
-    }
-    
     // Add tools array (same format as OpenAI)
-    JsonArray tools = doc["tools"].to<JsonArray>();
+    JsonArray tools = toolsDoc.to<JsonArray>();
     
     // Parse and add each tool from the toolsArray
     for (int i = 0; i < toolsArraySize; i++) {
@@ -404,10 +378,96 @@ String AI_API_DeepSeek_Handler::buildToolCallsRequestBody(const String& modelNam
             }
         }
     }
+
+    String toolsJson;
+    serializeJson(toolsDoc, toolsJson);
+    return toolsJson;
+}
+
+bool AI_API_DeepSeek_Handler::buildToolCallsRequestBody(const String& modelName,
+                                                         const String& toolsJson,
+                                                         const String& systemMessage, const String& toolChoice,
+                                                         int maxTokens,
+                                                         const String& userMessage, JsonDocument& doc,
+                                                         const AI_API_Chat_History* history) {
+    // Clear the document first
+    doc.clear();
+
+    // Set the model
+    doc["model"] = modelName;
+    
+    // Add max_tokens parameter if specified (DeepSeek uses max_tokens)
+    if (maxTokens > 0) {
+        doc["max_tokens"] = maxTokens;
+    }
+    
+    // Add messages array
+    JsonArray messages = doc["messages"].to<JsonArray>();
+    
+    // Add system message if specified
+    if (systemMessage.length() > 0) {
+        JsonObject systemMsg = messages.add<JsonObject>();
+        systemMsg["role"] = "system";
+        systemMsg["content"] = systemMessage;
+    }
+    
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryMessages(messages, history);
     
-    String requestBody;
-    serializeJson(doc, requestBody);
-    return requestBody;
+    // Add user message
+    JsonObject userMsg = messages.add<JsonObject>();
+    userMsg["role"] = "user";
+    userMsg["content"] = userMessage;
+    
+    // Add tool_choice if specified (same format as OpenAI)
+    if (toolChoice.length() > 0) {
+        String trimmedChoice = toolChoice;
+        trimmedChoice.trim();
+        
+        // Check if it's one of the allowed string values
+        if (trimmedChoice == "auto" || trimmedChoice == "none" || trimmedChoice == "required") {
+            // Simple string values can be added directly
+            doc["tool_choice"] = trimmedChoice;
+        } 
+        // Check if it starts with { - might be a JSON object string
+        else if (trimmedChoice.startsWith("{")) {
+            // Try to parse it as a JSON object
+            JsonDocument toolChoiceDoc;
+            DeserializationError error = deserializeJson(toolChoiceDoc, trimmedChoice);
+            
+            if (!error) {
+                // Successfully parsed as JSON - add as an object
+                JsonObject toolChoiceObj = doc["tool_choice"].to<JsonObject>();
+                
+                // Copy all fields from the parsed JSON
+                for (JsonPair kv : toolChoiceDoc.as<JsonObject>()) {
+                    if (kv.value().is<JsonObject>()) {
+                        JsonObject subObj = toolChoiceObj[kv.key().c_str()].to<JsonObject>();
+                        JsonObject srcSubObj = kv.value().as<JsonObject>();
+                        
+                        for (JsonPair subKv : srcSubObj) {
+                            subObj[subKv.key().c_str()] = subKv.value();
+                        }
+                    } else {
+                        toolChoiceObj[kv.key().c_str()] = kv.value();
+                    }
+                }
+            } else {
+                // Not valid JSON - add as string but this will likely cause an API error
+                AI_API_LOGW("tool_choice value is not valid JSON: %s", trimmedChoice.c_str());
+                doc["tool_choice"] = trimmedChoice;
+            }
+        } else {
+            // Not a recognized string value or JSON - add as string but will likely cause an API error
+            AI_API_LOGW("tool_choice value is not recognized: %s", trimmedChoice.c_str());
+            doc["tool_choice"] = trimmedChoice;
+        }
+    }
+    
+    // Add tools array (converted once by buildToolsJson)
+    doc["tools"] = serialized(toolsJson);
+
+    return true;
 }
 
 String AI_API_DeepSeek_Handler::parseToolCallsResponseBody(const String& responsePayload,
@@ -416,7 +476,21 @@ String AI_API_DeepSeek_Handler::parseToolCallsResponseBody(const String& respons
     doc.clear();
     errorMsg = ""; // Clear previous error
 
-    DeserializationError error = deserializeJson(doc, responsePayload);
+    DeserializationError error = deserializeJson(doc, responsePayload, DeserializationOption::Filter(_toolCallsResponseFilter));
+    return _extractToolCallsResponseContent(error, errorMsg, doc);
+}
+
+String AI_API_DeepSeek_Handler::parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) {
+    resetState(); // Reset finish reason and tokens before parsing
+    doc.clear();
+    errorMsg = ""; // Clear previous error
+
+    DeserializationError error = deserializeJson(doc, responseStream, DeserializationOption::Filter(_toolCallsResponseFilter));
+    return _extractToolCallsResponseContent(error, errorMsg, doc);
+}
+
+// Extract the content from a deserialized response (shared by the String and Stream variants)
+String AI_API_DeepSeek_Handler::_extractToolCallsResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc) {
     if (error) {
         errorMsg = "JSON Deserialization failed: " + String(error.c_str());
         return "";
@@ -433,6 +507,7 @@ String AI_API_DeepSeek_Handler::parseToolCallsResponseBody(const String& respons
         if (!usage["total_tokens"].isNull()) {
             _lastTotalTokens = usage["total_tokens"].as<int>(); // Store in base class member
         }
+        _lastCachedTokens = usage["prompt_cache_hit_tokens"] | 0;
     }
 
     if (doc["choices"].is<JsonArray>() && doc["choices"].size() > 0) {
@@ -465,15 +540,16 @@ String AI_API_DeepSeek_Handler::parseToolCallsResponseBody(const String& respons
     return ""; // Return empty string if content not found
 }
 
-String AI_API_DeepSeek_Handler::buildToolCallsFollowUpRequestBody(const String& modelName,
-                                                                const String* toolsArray, int toolsArraySize,
+bool AI_API_DeepSeek_Handler::buildToolCallsFollowUpRequestBody(const String& modelName,
+                                                                const String& toolsJson,
                                                                 const String& systemMessage, const String& toolChoice,
                                                                 const String& lastUserMessage,
                                                                 const String& lastAssistantToolCallsJson,
                                                                 const String& toolResultsJson,
                                                                 int followUpMaxTokens,
                                                                 const String& followUpToolChoice,
-                                                                JsonDocument& doc) {
+                                                                JsonDocument& doc,
+                                                                const AI_API_Chat_History* history) {
     // Clear the document first
     doc.clear();
 
@@ -495,63 +571,16 @@ String AI_API_DeepSeek_Handler::buildToolCallsFollowUpRequestBody(const String&
         systemMsg["content"] = systemMessage;
     }
     
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryMessages(messages, history);
+    
     // Add the original user message
     JsonObject userMsg = messages.add<JsonObject>();
     userMsg["role"] = "user";
     userMsg["content"] = lastUserMessage;
     
-    // Add the assistant's tool call response
-    JsonObject assistantMsg = messages.add<JsonObject>();
-    assistantMsg["role"] = "assistant";
-    
-    // Parse and add the tool calls
-    JsonDocument toolCallsDoc;
-    DeserializationError error = deserializeJson(toolCallsDoc, lastAssistantToolCallsJson);
-    if (!error && toolCallsDoc.is<JsonArray>()) {
-        JsonArray toolCalls = assistantMsg["tool_calls"].to<JsonArray>();
-        
-        // Copy each tool call
-        for (JsonVariant toolCall : toolCallsDoc.as<JsonArray>()) {
-            JsonObject newToolCall = toolCalls.add<JsonObject>();
-            
-            // Copy all properties of the tool call
-            for (JsonPair kv : toolCall.as<JsonObject>()) {
-                if (kv.value().is<JsonObject>()) {
-                    JsonObject subObj = newToolCall[kv.key().c_str()].to<JsonObject>();
-                    JsonObject srcSubObj = kv.value().as<JsonObject>();
-                    
-                    for (JsonPair subKv : srcSubObj) {
-                        subObj[subKv.key().c_str()] = subKv.value();
-                    }
-                } else {
-                    newToolCall[kv.key().c_str()] = kv.value();
-                }
-            }
-        }
-    }
-    
-    // Parse and add tool results as tool messages
-    JsonDocument toolResultsDoc;
-    error = deserializeJson(toolResultsDoc, toolResultsJson);
-    if (!error && toolResultsDoc.is<JsonArray>()) {
-        for (JsonVariant result : toolResultsDoc.as<JsonArray>()) {
-            JsonObject toolMsg = messages.add<JsonObject>();
-            toolMsg["role"] = "tool";
-            
-            // Copy tool_call_id from the result
-            if (!result["tool_call_id"].isNull()) {
-                toolMsg["tool_call_id"] = result["tool_call_id"];
-            }
-            
-            // Extract content from function.output
-            if (result["function"].is<JsonObject>()) {
-                JsonObject function = result["function"];
-                if (!function["output"].isNull()) {
-                    toolMsg["content"] = function["output"];
-                }
-            }
-        }
-    }
+    // Add the assistant's tool calls and their results
+    _appendToolCallsRound(messages, lastAssistantToolCallsJson, toolResultsJson);
     
     // Add follow-up tool_choice if specified (same format as OpenAI)
     if (followUpToolChoice.length() > 0) {
@@ -588,113 +617,105 @@ String AI_API_DeepSeek_Handler::buildToolCallsFollowUpRequestBody(const String&
                 }
             } else {
                 // Not valid JSON - add as string but this will likely cause an API error
-                #ifdef ENABLE_DEBUG_OUTPUT
-                Serial.println("Warning: follow-up tool_choice value is not valid JSON: " + trimmedChoice);
-                #endif
+                AI_API_LOGW("Follow-up tool_choice value is not valid JSON: %s", trimmedChoice.c_str());
                 doc["tool_choice"] = trimmedChoice;
             }
         } else {
             // Not a recognized string value or JSON - add as string but will likely cause an API error
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Warning: follow-up tool_choice value is not recognized: " + trimmedChoice);
-            #endif
+            AI_API_LOGW("Follow-up tool_choice value is not recognized: %s", trimmedChoice.c_str());
             doc["tool_choice"] = trimmedChoice;
         }
     }
     
-    // Add tools array (same logic as buildToolCallsRequestBody)
-    JsonArray tools = doc["tools"].to<JsonArray>();
+    // Add tools array (converted once by buildToolsJson)
+    doc["tools"] = serialized(toolsJson);
+
+    return true;
+}
+
+bool AI_API_DeepSeek_Handler::appendToolCallsRound(const String& assistantToolCallsJson,
+                                                  const String& toolResultsJson, JsonDocument& doc) {
+    JsonArray messages = doc["messages"];
+    if (messages.isNull()) return false;
+    _appendToolCallsRound(messages, assistantToolCallsJson, toolResultsJson);
+    return true;
+}
+
+void AI_API_DeepSeek_Handler::_appendToolCallsRound(JsonArray messages, const String& lastAssistantToolCallsJson,
+                                                    const String& toolResultsJson) {
+    // Add the assistant's tool call response
+    JsonObject assistantMsg = messages.add<JsonObject>();
+    assistantMsg["role"] = "assistant";
     
-    // Parse and add each tool from the toolsArray
-    for (int i = 0; i < toolsArraySize; i++) {
-        // Create a temporary JsonDocument to parse the tool JSON string
-        JsonDocument tempDoc;
-        DeserializationError error = deserializeJson(tempDoc, toolsArray[i]);
-        
-        if (error) {
-            // Skip invalid JSON
-            continue;
-        }
+    // Parse and add the tool calls
+    JsonDocument toolCallsDoc;
+    DeserializationError error = deserializeJson(toolCallsDoc, lastAssistantToolCallsJson);
+    if (!error && toolCallsDoc.is<JsonArray>()) {
+        JsonArray toolCalls = assistantMsg["tool_calls"].to<JsonArray>();
         
-        // Check if the tool is already in OpenAI format (has 'type' and 'function' fields)
-        if (!tempDoc["type"].isNull() && !tempDoc["function"].isNull()) {
-            // Already in OpenAI format - copy directly to tools array
-            JsonObject tool = tools.add<JsonObject>();
-            
-            // Copy type
-            tool["type"] = tempDoc["type"];
-            
-            // Copy function
-            JsonObject function = tool["function"].to<JsonObject>();
-            JsonObject srcFunction = tempDoc["function"];
-            
-            // Copy function properties
-            if (!srcFunction["name"].isNull()) {
-                function["name"] = srcFunction["name"].as<String>();
-            }
-            
-            if (!srcFunction["description"].isNull()) {
-                function["description"] = srcFunction["description"].as<String>();
-            }
-            
-            if (!srcFunction["parameters"].isNull()) {
-                JsonObject params = function["parameters"].to<JsonObject>();
-                JsonObject srcParams = srcFunction["parameters"];
-                
-                for (JsonPair kv : srcParams) {
-                    if (kv.value().is<JsonObject>()) {
-                        JsonObject subObj = params[kv.key().c_str()].to<JsonObject>();
-                        JsonObject srcSubObj = kv.value().as<JsonObject>();
-                        
-                        for (JsonPair subKv : srcSubObj) {
-                            subObj[subKv.key().c_str()] = subKv.value();
-                        }
-                    } else if (kv.value().is<JsonArray>()) {
-                        JsonArray arr = params[kv.key().c_str()].to<JsonArray>();
-                        JsonArray srcArr = kv.value().as<JsonArray>();
-                        
-                        for (const auto& item : srcArr) {
-                            arr.add(item);
-                        }
-                    } else {
-                        params[kv.key().c_str()] = kv.value();
-                    }
-                }
-            }
-        } else {
-            // Simple format - wrap in OpenAI format
-            // Add this tool to the tools array with type: "function"
-            JsonObject tool = tools.add<JsonObject>();
-            tool["type"] = "function";
-            
-            JsonObject function = tool["function"].to<JsonObject>();
+        // Copy each tool call
+        for (JsonVariant toolCall : toolCallsDoc.as<JsonArray>()) {
+            JsonObject newToolCall = toolCalls.add<JsonObject>();
             
-            // Copy all properties from the simple format to the function object
-            for (JsonPair kv : tempDoc.as<JsonObject>()) {
+            // Copy all properties of the tool call
+            for (JsonPair kv : toolCall.as<JsonObject>()) {
                 if (kv.value().is<JsonObject>()) {
-                    JsonObject subObj = function[kv.key().c_str()].to<JsonObject>();
+                    JsonObject subObj = newToolCall[kv.key().c_str()].to<JsonObject>();
                     JsonObject srcSubObj = kv.value().as<JsonObject>();
                     
                     for (JsonPair subKv : srcSubObj) {
                         subObj[subKv.key().c_str()] = subKv.value();
                     }
-                } else if (kv.value().is<JsonArray>()) {
-                    JsonArray arr = function[kv.key().c_str()].to<JsonArray>();
-                    JsonArray srcArr = kv.value().as<JsonArray>();
-                    
-                    for (const auto& item : srcArr) {
-                        arr.add(item);
-                    }
                 } else {
-                    function[kv.key().c_str()] = kv.value();
+                    newToolCall[kv.key().c_str()] = kv.value();
                 }
             }
         }
     }
     
-    String requestBody;
-    serializeJson(doc, requestBody);
-    return requestBody;
+    // Parse and add tool results as tool messages
+    JsonDocument toolResultsDoc;
+    error = deserializeJson(toolResultsDoc, toolResultsJson);
+    if (!error && toolResultsDoc.is<JsonArray>()) {
+        for (JsonVariant result : toolResultsDoc.as<JsonArray>()) {
+            JsonObject toolMsg = messages.add<JsonObject>();
+            toolMsg["role"] = "tool";
+            
+            // Copy tool_call_id from the result
+            if (!result["tool_call_id"].isNull()) {
+                toolMsg["tool_call_id"] = result["tool_call_id"];
+            }
+            
+            // Extract content from function.output
+            if (result["function"].is<JsonObject>()) {
+                JsonObject function = result["function"];
+                if (!function["output"].isNull()) {
+                    toolMsg["content"] = function["output"];
+                }
+            }
+        }
+    }
+}
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+bool AI_API_DeepSeek_Handler::buildToolCallsStreamRequestBody(const String& modelName,
+                                                     const String& toolsJson,
+                                                     const String& systemMessage, const String& toolChoice,
+                                                     int maxTokens,
+                                                     const String& userMessage, JsonDocument& doc,
+                                                     const AI_API_Chat_History* history) {
+    // Same request as tcChat(), with "stream": true
+    if (!buildToolCallsRequestBody(modelName, toolsJson, systemMessage, toolChoice, maxTokens,
+                                   userMessage, doc, history)) {
+        return false;
+    }
+    doc["stream"] = true;
+    return true;
+}
+
+String AI_API_DeepSeek_Handler::processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) {
+    return _processStreamChunk(data, length, isComplete, errorMsg, _toolCallsStreamChunkFilter);
 }
 #endif
 
@@ -0,0 +1,354 @@
+// ESP32_AI_Connect/AI_API_Dispatcher.cpp
+
+#include "AI_API_Dispatcher.h"
+
+#ifdef ENABLE_ASYNC_CHAT // Only compile this file's content if flag is set
+
+AI_API_Dispatcher::AI_API_Dispatcher(uint8_t maxConnections, size_t queueLength)
+    : _maxConnections(maxConnections > 0 ? maxConnections : 1),
+      _queueLength(queueLength > 0 ? queueLength : 1) {
+    _queue = new Entry[_queueLength];
+    _running = new ESP32_AI_Connect*[_maxConnections]();
+    _connections = new Connection[_maxConnections];
+    _tasks = new TaskHandle_t[_maxConnections]();
+    _workerParams = new WorkerParam[_maxConnections];
+}
+
+AI_API_Dispatcher::~AI_API_Dispatcher() {
+    end();
+    delete[] _queue;
+    delete[] _running;
+    delete[] _connections;
+    delete[] _tasks;
+    delete[] _workerParams;
+}
+
+bool AI_API_Dispatcher::begin(BaseType_t core, UBaseType_t priority) {
+    if (_taskCount > 0) return true; // Already running
+
+    _mutex = xSemaphoreCreateMutex();
+    _wake = xSemaphoreCreateCounting(2 * _queueLength + _maxConnections, 0);
+    _space = xSemaphoreCreateCounting(_queueLength, _queueLength);
+    _stopped = xSemaphoreCreateCounting(_maxConnections, 0);
+    _resultQueue = xQueueCreate(_queueLength, sizeof(AsyncResult*));
+    if (_mutex == nullptr || _wake == nullptr || _space == nullptr ||
+        _stopped == nullptr || _resultQueue == nullptr) {
+        _lastError = "Failed to create dispatcher queues";
+        end();
+        return false;
+    }
+
+    _stopping = false;
+    for (uint8_t slot = 0; slot < _maxConnections; slot++) {
+        _workerParams[slot].dispatcher = this;
+        _workerParams[slot].slot = slot;
+        if (xTaskCreatePinnedToCore(_workerEntry, "ai_dispatch", AI_API_ASYNC_TASK_STACK_SIZE,
+                                    &_workerParams[slot], priority, &_tasks[slot], core) != pdPASS) {
+            _lastError = "Failed to create dispatcher worker task";
+            end();
+            return false;
+        }
+        _taskCount++;
+    }
+    return true;
+}
+
+void AI_API_Dispatcher::end() {
+    // Let every worker finish its current request and exit
+    _stopping = true;
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        xSemaphoreGive(_wake);
+    }
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        xSemaphoreTake(_stopped, portMAX_DELAY);
+    }
+    _taskCount = 0;
+
+    // Drop queued requests and undelivered results
+    for (size_t i = 0; i < _queueLength; i++) {
+        delete _queue[i].job;
+        _queue[i] = Entry();
+    }
+    _queued = 0;
+    if (_resultQueue != nullptr) {
+        AsyncResult* result = nullptr;
+        while (xQueueReceive(_resultQueue, &result, 0) == pdTRUE) {
+            delete result;
+        }
+        vQueueDelete(_resultQueue);
+        _resultQueue = nullptr;
+    }
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        _connections[i] = Connection();
+    }
+
+    if (_mutex != nullptr) { vSemaphoreDelete(_mutex); _mutex = nullptr; }
+    if (_wake != nullptr) { vSemaphoreDelete(_wake); _wake = nullptr; }
+    if (_space != nullptr) { vSemaphoreDelete(_space); _space = nullptr; }
+    if (_stopped != nullptr) { vSemaphoreDelete(_stopped); _stopped = nullptr; }
+}
+
+uint32_t AI_API_Dispatcher::chat(ESP32_AI_Connect& ai, const String& userMessage, Priority priority,
+                                 AsyncCallback onDone, uint32_t waitMs) {
+    ESP32_AI_Connect::AsyncJob* job = new ESP32_AI_Connect::AsyncJob();
+    job->type = ESP32_AI_Connect::AsyncJobType::CHAT;
+    job->message = userMessage;
+    job->onDone = onDone;
+    return _submit(ai, job, priority, waitMs);
+}
+
+#ifdef ENABLE_TOOL_CALLS
+uint32_t AI_API_Dispatcher::tcChat(ESP32_AI_Connect& ai, const String& tcUserMessage, Priority priority,
+                                   AsyncCallback onDone, uint32_t waitMs) {
+    ESP32_AI_Connect::AsyncJob* job = new ESP32_AI_Connect::AsyncJob();
+    job->type = ESP32_AI_Connect::AsyncJobType::TC_CHAT;
+    job->message = tcUserMessage;
+    job->onDone = onDone;
+    return _submit(ai, job, priority, waitMs);
+}
+
+uint32_t AI_API_Dispatcher::tcReply(ESP32_AI_Connect& ai, const String& toolResultsJson, Priority priority,
+                                    AsyncCallback onDone, uint32_t waitMs) {
+    ESP32_AI_Connect::AsyncJob* job = new ESP32_AI_Connect::AsyncJob();
+    job->type = ESP32_AI_Connect::AsyncJobType::TC_REPLY;
+    job->message = toolResultsJson;
+    job->onDone = onDone;
+    return _submit(ai, job, priority, waitMs);
+}
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+uint32_t AI_API_Dispatcher::streamChat(ESP32_AI_Connect& ai, const String& userMessage,
+                                       ESP32_AI_Connect::StreamCallback onChunk, Priority priority,
+                                       AsyncCallback onDone, uint32_t waitMs) {
+    if (!onChunk) {
+        _lastError = "Callback function is null";
+        return 0;
+    }
+    ESP32_AI_Connect::AsyncJob* job = new ESP32_AI_Connect::AsyncJob();
+    job->type = ESP32_AI_Connect::AsyncJobType::STREAM_CHAT;
+    job->message = userMessage;
+    job->onChunk = onChunk;
+    job->onDone = onDone;
+    return _submit(ai, job, priority, waitMs);
+}
+#endif
+
+bool AI_API_Dispatcher::cancel(uint32_t requestId) {
+    if (_mutex == nullptr) return false;
+
+    bool found = false;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < _queueLength; i++) {
+        if (_queue[i].job != nullptr && _queue[i].job->requestId == requestId) {
+            delete _queue[i].job;
+            _queue[i] = Entry();
+            _queued--;
+            found = true;
+            break;
+        }
+    }
+    xSemaphoreGive(_mutex);
+
+    if (found) xSemaphoreGive(_space);
+    return found;
+}
+
+bool AI_API_Dispatcher::pollResult(AsyncResult& result, uint32_t waitMs) {
+    if (_resultQueue == nullptr) return false;
+
+    AsyncResult* finished = nullptr;
+    if (xQueueReceive(_resultQueue, &finished, pdMS_TO_TICKS(waitMs)) != pdTRUE) return false;
+    result = *finished;
+    delete finished;
+    return true;
+}
+
+size_t AI_API_Dispatcher::getQueuedCount() const {
+    return _queued;
+}
+
+uint8_t AI_API_Dispatcher::getRunningCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        if (_running[i] != nullptr) count++;
+    }
+    return count;
+}
+
+uint8_t AI_API_Dispatcher::getOpenConnectionCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        if (_connections[i].ai != nullptr && _connections[i].ai->hasOpenConnection()) count++;
+    }
+    return count;
+}
+
+uint32_t AI_API_Dispatcher::_submit(ESP32_AI_Connect& ai, ESP32_AI_Connect::AsyncJob* job,
+                                    Priority priority, uint32_t waitMs) {
+    if (!begin()) { // Starts the workers on first use
+        delete job;
+        return 0; // _lastError already set
+    }
+
+    // Back-pressure: wait for a free queue entry
+    if (xSemaphoreTake(_space, pdMS_TO_TICKS(waitMs)) != pdTRUE) {
+        delete job;
+        _lastError = "Dispatcher queue is full";
+        return 0;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    job->requestId = _nextId++;
+    if (_nextId == 0) _nextId = 1; // 0 means "not queued"
+    for (size_t i = 0; i < _queueLength; i++) {
+        if (_queue[i].job == nullptr) {
+            _queue[i].ai = &ai;
+            _queue[i].job = job;
+            _queue[i].priority = priority;
+            _queue[i].sequence = _nextSequence++;
+            _queued++;
+            break;
+        }
+    }
+    uint32_t requestId = job->requestId;
+    xSemaphoreGive(_mutex);
+
+    xSemaphoreGive(_wake);
+    return requestId;
+}
+
+bool AI_API_Dispatcher::_takeNext(uint8_t slot, Entry& entry) {
+    int best = -1;
+    for (size_t i = 0; i < _queueLength; i++) {
+        const Entry& candidate = _queue[i];
+        if (candidate.job == nullptr) continue;
+        // An instance runs one request at a time
+        if (_isRunning(candidate.ai) || candidate.ai->isAsyncBusy()) continue;
+        if (best < 0 || candidate.priority > _queue[best].priority ||
+            (candidate.priority == _queue[best].priority &&
+             (int32_t)(candidate.sequence - _queue[best].sequence) < 0)) {
+            best = i;
+        }
+    }
+    if (best < 0) return false;
+
+    entry = _queue[best];
+    _queue[best] = Entry();
+    _queued--;
+    _running[slot] = entry.ai;
+    return true;
+}
+
+void AI_API_Dispatcher::_reserveConnection(ESP32_AI_Connect* ai) {
+    // Forget instances that closed their connection on their own
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        if (_connections[i].ai != nullptr && !_connections[i].ai->hasOpenConnection()) {
+            _connections[i] = Connection();
+        }
+    }
+
+    // Connections in use: this request, other running requests and idle kept-alive ones
+    uint8_t inUse = 1;
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        if (_running[i] != nullptr && _running[i] != ai) inUse++;
+    }
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        ESP32_AI_Connect* holder = _connections[i].ai;
+        if (holder != nullptr && holder != ai && !_isRunning(holder)) inUse++;
+    }
+
+    // Close the least recently used idle connections until this request fits
+    while (inUse > _maxConnections) {
+        int oldest = -1;
+        for (uint8_t i = 0; i < _maxConnections; i++) {
+            ESP32_AI_Connect* holder = _connections[i].ai;
+            if (holder == nullptr || holder == ai || _isRunning(holder)) continue;
+            if (oldest < 0 || (int32_t)(_connections[i].lastUsed - _connections[oldest].lastUsed) < 0) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) break;
+
+        AI_API_LOGI("Dispatcher: closing idle connection to free a slot");
+        _connections[oldest].ai->closeConnection();
+        _connections[oldest] = Connection();
+        inUse--;
+    }
+}
+
+void AI_API_Dispatcher::_updateConnection(ESP32_AI_Connect* ai) {
+    int entry = -1;
+    int freeEntry = -1;
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        if (_connections[i].ai == ai) entry = i;
+        else if (_connections[i].ai == nullptr && freeEntry < 0) freeEntry = i;
+    }
+
+    if (!ai->hasOpenConnection()) {
+        if (entry >= 0) _connections[entry] = Connection();
+        return;
+    }
+    if (entry < 0) entry = freeEntry;
+    if (entry < 0) return; // Not reachable: a slot was reserved before the request
+    _connections[entry].ai = ai;
+    _connections[entry].lastUsed = millis();
+}
+
+bool AI_API_Dispatcher::_isRunning(const ESP32_AI_Connect* ai) const {
+    for (uint8_t i = 0; i < _maxConnections; i++) {
+        if (_running[i] == ai) return true;
+    }
+    return false;
+}
+
+void AI_API_Dispatcher::_deliver(ESP32_AI_Connect::AsyncJob* job, const AsyncResult& result) {
+    if (job->onDone) {
+        job->onDone(result);
+        return;
+    }
+
+    AsyncResult* queued = new AsyncResult(result);
+    if (xQueueSend(_resultQueue, &queued, 0) != pdTRUE) {
+        AI_API_LOGW("Dispatcher result dropped: result queue is full (call pollResult())");
+        delete queued;
+    }
+}
+
+void AI_API_Dispatcher::_workerLoop(uint8_t slot) {
+    while (true) {
+        xSemaphoreTake(_wake, portMAX_DELAY);
+        if (_stopping) break;
+
+        Entry entry;
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool found = _takeNext(slot, entry);
+        if (found) _reserveConnection(entry.ai);
+        xSemaphoreGive(_mutex);
+        if (!found) continue; // Nothing runnable yet: a finishing request wakes us again
+
+        xSemaphoreGive(_space);
+
+        AsyncResult result = entry.ai->_executeAsyncJob(entry.job);
+        _deliver(entry.job, result);
+        delete entry.job;
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        _updateConnection(entry.ai);
+        _running[slot] = nullptr;
+        xSemaphoreGive(_mutex);
+
+        // Requests waiting for this instance (or this slot) can run now
+        xSemaphoreGive(_wake);
+    }
+
+    xSemaphoreGive(_stopped);
+    vTaskDelete(nullptr);
+}
+
+void AI_API_Dispatcher::_workerEntry(void* param) {
+    WorkerParam* worker = static_cast<WorkerParam*>(param);
+    worker->dispatcher->_workerLoop(worker->slot);
+}
+
+#endif // ENABLE_ASYNC_CHAT
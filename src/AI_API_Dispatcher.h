@@ -0,0 +1,139 @@
+// ESP32_AI_Connect/AI_API_Dispatcher.h
+
+#ifndef AI_API_DISPATCHER_H
+#define AI_API_DISPATCHER_H
+
+#include "ESP32_AI_Connect.h"
+
+#ifdef ENABLE_ASYNC_CHAT // Only compile this file's content if flag is set
+
+// Shared scheduler for requests of several ESP32_AI_Connect instances.
+//
+// Each open TLS connection costs tens of KB of RAM, so running a few instances side
+// by side (e.g. a small classifier model and a larger model) can exhaust the heap.
+// The dispatcher runs at most maxConnections requests at a time, one worker task per
+// connection slot, and keeps at most maxConnections kept-alive connections open across
+// all instances (the least recently used idle one is closed when another is needed).
+//
+// Queued requests run highest priority first, in submission order within a priority.
+// The queue is bounded: when it is full, submitting waits up to waitMs for space and
+// returns 0 if none became available (back-pressure for the caller).
+// One instance never runs two requests at once.
+//
+// Instances must outlive the dispatcher (or its end()). Don't use an instance's own
+// chatAsync()/streamChatAsync() while it is used through a dispatcher, and don't call
+// its blocking methods while it has requests queued here.
+//
+// Usage:
+//   AI_API_Dispatcher dispatcher(1);  // One shared TLS connection
+//   dispatcher.chat(classifier, "Is this urgent? ...", AI_API_Dispatcher::PRIORITY_HIGH);
+//   dispatcher.chat(assistant, "Write a summary ...");
+//   ESP32_AI_Connect::AsyncResult result;
+//   while (dispatcher.pollResult(result)) { ... }
+class AI_API_Dispatcher {
+public:
+    enum Priority : uint8_t {
+        PRIORITY_LOW = 0,
+        PRIORITY_NORMAL = 1,
+        PRIORITY_HIGH = 2
+    };
+
+    typedef ESP32_AI_Connect::AsyncResult AsyncResult;
+    typedef ESP32_AI_Connect::AsyncCallback AsyncCallback;
+
+    // maxConnections: connection slots (worker tasks and open connections), at least 1
+    // queueLength: requests that can wait for a slot
+    AI_API_Dispatcher(uint8_t maxConnections = AI_API_DISPATCHER_MAX_CONNECTIONS,
+                      size_t queueLength = AI_API_DISPATCHER_QUEUE_LENGTH);
+    ~AI_API_Dispatcher();
+
+    // Start the worker tasks (optional: started with the configured defaults on first use)
+    bool begin(BaseType_t core = AI_API_ASYNC_TASK_CORE, UBaseType_t priority = AI_API_ASYNC_TASK_PRIORITY);
+    // Stop the worker tasks after their current request. Queued requests and
+    // undelivered results are dropped.
+    void end();
+
+    // Queue a request for an instance. Returns a request id, or 0 if the queue stayed full
+    // for waitMs or the dispatcher could not start (see getLastError()).
+    // onDone runs on a worker task; without it the result goes to pollResult().
+    uint32_t chat(ESP32_AI_Connect& ai, const String& userMessage, Priority priority = PRIORITY_NORMAL,
+                  AsyncCallback onDone = nullptr, uint32_t waitMs = 0);
+#ifdef ENABLE_TOOL_CALLS
+    uint32_t tcChat(ESP32_AI_Connect& ai, const String& tcUserMessage, Priority priority = PRIORITY_NORMAL,
+                    AsyncCallback onDone = nullptr, uint32_t waitMs = 0);
+    uint32_t tcReply(ESP32_AI_Connect& ai, const String& toolResultsJson, Priority priority = PRIORITY_NORMAL,
+                     AsyncCallback onDone = nullptr, uint32_t waitMs = 0);
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    uint32_t streamChat(ESP32_AI_Connect& ai, const String& userMessage, ESP32_AI_Connect::StreamCallback onChunk,
+                        Priority priority = PRIORITY_NORMAL, AsyncCallback onDone = nullptr, uint32_t waitMs = 0);
+#endif
+
+    // Remove a request that has not started yet. Returns false if it is running or unknown.
+    bool cancel(uint32_t requestId);
+
+    // Take the next finished result (requests without onDone). Waits up to waitMs.
+    bool pollResult(AsyncResult& result, uint32_t waitMs = 0);
+
+    size_t getQueuedCount() const;
+    uint8_t getRunningCount() const;
+    // Kept-alive connections currently held by instances using this dispatcher
+    uint8_t getOpenConnectionCount() const;
+    uint8_t getMaxConnections() const { return _maxConnections; }
+
+    String getLastError() const { return _lastError; }
+
+private:
+    struct Entry {
+        ESP32_AI_Connect* ai = nullptr;
+        ESP32_AI_Connect::AsyncJob* job = nullptr;
+        uint8_t priority = PRIORITY_NORMAL;
+        uint32_t sequence = 0;        // Submission order within a priority
+    };
+
+    struct Connection {
+        ESP32_AI_Connect* ai = nullptr; // Instance holding a kept-alive connection
+        uint32_t lastUsed = 0;          // millis() of its last request
+    };
+
+    uint8_t _maxConnections;
+    size_t _queueLength;
+    String _lastError = "";
+
+    Entry* _queue = nullptr;            // _queueLength entries, unordered (job == nullptr: free)
+    size_t _queued = 0;
+    ESP32_AI_Connect** _running = nullptr; // Instance run by each worker, nullptr when idle
+    Connection* _connections = nullptr; // _maxConnections entries
+    uint32_t _nextId = 1;
+    uint32_t _nextSequence = 0;
+
+    SemaphoreHandle_t _mutex = nullptr;      // Protects the arrays above
+    SemaphoreHandle_t _wake = nullptr;       // Counting: work may be available
+    SemaphoreHandle_t _space = nullptr;      // Counting: free queue entries
+    SemaphoreHandle_t _stopped = nullptr;    // Counting: given by each exiting worker
+    QueueHandle_t _resultQueue = nullptr;    // AsyncResult* for pollResult()
+    TaskHandle_t* _tasks = nullptr;
+    uint8_t _taskCount = 0;
+    volatile bool _stopping = false;
+
+    struct WorkerParam {
+        AI_API_Dispatcher* dispatcher;
+        uint8_t slot;
+    };
+    WorkerParam* _workerParams = nullptr;
+
+    uint32_t _submit(ESP32_AI_Connect& ai, ESP32_AI_Connect::AsyncJob* job, Priority priority, uint32_t waitMs);
+    // Take the best runnable entry (mutex held); returns false if none can run now
+    bool _takeNext(uint8_t slot, Entry& entry);
+    // Make room for ai's connection by closing the least recently used idle one (mutex held)
+    void _reserveConnection(ESP32_AI_Connect* ai);
+    // Record whether ai kept its connection open after a request (mutex held)
+    void _updateConnection(ESP32_AI_Connect* ai);
+    bool _isRunning(const ESP32_AI_Connect* ai) const;
+    void _deliver(ESP32_AI_Connect::AsyncJob* job, const AsyncResult& result);
+    void _workerLoop(uint8_t slot);
+    static void _workerEntry(void* param);
+};
+
+#endif // ENABLE_ASYNC_CHAT
+#endif // AI_API_DISPATCHER_H
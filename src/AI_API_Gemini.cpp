@@ -4,6 +4,38 @@
 
 #ifdef USE_AI_API_GEMINI // Only compile this file's content if flag is set
 
+AI_API_Gemini_Handler::AI_API_Gemini_Handler() {
+    // Non-streaming response: candidates[0].content.parts[].text, finishReason and usage.
+    // Safety ratings, citation metadata and token breakdowns are dropped while parsing.
+    _responseFilter["error"] = true;
+    _responseFilter["usageMetadata"]["totalTokenCount"] = true;
+    _responseFilter["usageMetadata"]["cachedContentTokenCount"] = true; // Implicit or explicit cache hits
+    _responseFilter["promptFeedback"]["blockReason"] = true;
+    _responseFilter["candidates"][0]["finishReason"] = true;
+    _responseFilter["candidates"][0]["content"]["parts"][0]["text"] = true;
+
+#ifdef ENABLE_TOOL_CALLS
+    // Tool calls response: same fields plus each part's functionCall
+    _toolCallsResponseFilter = _responseFilter;
+    _toolCallsResponseFilter["candidates"][0]["content"]["parts"][0]["functionCall"] = true;
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+    // Stream chunk: same shape as the non-streaming response
+    _streamChunkFilter["error"] = true;
+    _streamChunkFilter["usageMetadata"]["totalTokenCount"] = true;
+    _streamChunkFilter["usageMetadata"]["cachedContentTokenCount"] = true;
+    _streamChunkFilter["candidates"][0]["finishReason"] = true;
+    _streamChunkFilter["candidates"][0]["content"]["parts"][0]["text"] = true;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Tool calls stream chunk: same fields plus each part's functionCall
+    _toolCallsStreamChunkFilter = _streamChunkFilter;
+    _toolCallsStreamChunkFilter["candidates"][0]["content"]["parts"][0]["functionCall"] = true;
+#endif
+}
+
 String AI_API_Gemini_Handler::getEndpoint(const String& modelName, const String& apiKey, const String& customEndpoint) const {
     // If a custom endpoint is provided, use it
     if (!customEndpoint.isEmpty()) {
@@ -26,16 +58,29 @@ String AI_API_Gemini_Handler::getStreamEndpoint(const String& modelName, const S
 }
 #endif
 
+void AI_API_Gemini_Handler::appendHistoryContents(JsonArray contents, const AI_API_Chat_History* history) const {
+    if (history == nullptr) return;
+    AI_API_Chat_History::Turn turn;
+    for (size_t pos = 0; history->readTurn(pos, turn); ) {
+        JsonObject content = contents.add<JsonObject>();
+        content["role"] = (turn.role == AI_API_Chat_History::ASSISTANT) ? "model" : "user";
+        JsonArray parts = content["parts"].to<JsonArray>();
+        JsonObject part = parts.add<JsonObject>();
+        part["text"] = serialized(turn.json, turn.jsonLength); // Already JSON-encoded
+    }
+}
+
 void AI_API_Gemini_Handler::setHeaders(HTTPClient& httpClient, const String& apiKey) {
     // API key is in the URL, so only Content-Type is strictly needed here.
     // Some Google APIs also accept x-goog-api-key header, but URL method is common.
     httpClient.addHeader("Content-Type", "application/json");
 }
 
-String AI_API_Gemini_Handler::buildRequestBody(const String& modelName, const String& systemRole,
+bool AI_API_Gemini_Handler::buildRequestBody(const String& modelName, const String& systemRole,
                                                float temperature, int maxTokens,
                                                const String& userMessage, JsonDocument& doc,
-                                               const String& customParams) {
+                                               JsonObjectConst customParams,
+                                               const AI_API_Chat_History* history) {
     // Use the provided 'doc' reference. Clear it first.
     doc.clear();
 
@@ -51,48 +96,44 @@ String AI_API_Gemini_Handler::buildRequestBody(const String& modelName, const St
     // --- Add User Content ---
     // Reference: https://ai.google.dev/docs/rest_api_overview#request_body
     JsonArray contents = doc["contents"].to<JsonArray>();
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryContents(contents, history);
+    
     JsonObject userContent = contents.add<JsonObject>();
     userContent["role"] = "user"; // Gemini uses 'user' and 'model' roles
     JsonArray userParts = userContent["parts"].to<JsonArray>();
     JsonObject userTextPart = userParts.add<JsonObject>();
     userTextPart["text"] = userMessage;
 
-    // --- Process custom parameters if provided ---
-    if (customParams.length() > 0) {
-        // Create a temporary document to parse the custom parameters
-        JsonDocument paramsDoc;
-        DeserializationError error = deserializeJson(paramsDoc, customParams);
+    // Copy custom parameters (parsed once by setChatParameters/setStreamChatParameters)
+    if (!customParams.isNull()) {
+        // Check if there are parameters specifically for generationConfig
+        JsonObject generationConfig;
+        bool hasGenerationConfig = false;
         
-        // Only proceed if parsing was successful
-        if (!error) {
-            // Check if there are parameters specifically for generationConfig
-            JsonObject generationConfig;
-            bool hasGenerationConfig = false;
-            
-            for (JsonPair param : paramsDoc.as<JsonObject>()) {
-                // These parameters should go into generationConfig object
-                if (param.key() == "temperature" || param.key() == "topP" || 
-                    param.key() == "topK" || param.key() == "maxOutputTokens" ||
-                    param.key() == "candidateCount" || param.key() == "stopSequences" ||
-                    param.key() == "responseMimeType" || param.key() == "responseSchema" ||
-                    param.key() == "presencePenalty" || param.key() == "frequencyPenalty" ||
-                    param.key() == "seed" || param.key() == "responseLogprobs" ||
-                    param.key() == "logprobs" || param.key() == "enableEnhancedCivicAnswers" || 
-                    param.key() == "speechConfig" || param.key() == "thinkingConfig" || 
-                    param.key() == "mediaResolution") {
-                    
-                    // Create generationConfig object if it doesn't exist yet
-                    if (!hasGenerationConfig) {
-                        generationConfig = doc["generationConfig"].to<JsonObject>();
-                        hasGenerationConfig = true;
-                    }
-                    generationConfig[param.key()] = param.value();
-                }
-                // Other parameters go directly into the root object
-                else if (param.key() != "model" && param.key() != "contents" && 
-                         param.key() != "systemInstruction") {
-                    doc[param.key()] = param.value();
+        for (JsonPairConst param : customParams) {
+            // These parameters should go into generationConfig object
+            if (param.key() == "temperature" || param.key() == "topP" || 
+                param.key() == "topK" || param.key() == "maxOutputTokens" ||
+                param.key() == "candidateCount" || param.key() == "stopSequences" ||
+                param.key() == "responseMimeType" || param.key() == "responseSchema" ||
+                param.key() == "presencePenalty" || param.key() == "frequencyPenalty" ||
+                param.key() == "seed" || param.key() == "responseLogprobs" ||
+                param.key() == "logprobs" || param.key() == "enableEnhancedCivicAnswers" || 
+                param.key() == "speechConfig" || param.key() == "thinkingConfig" || 
+                param.key() == "mediaResolution") {
+                
+                // Create generationConfig object if it doesn't exist yet
+                if (!hasGenerationConfig) {
+                    generationConfig = doc["generationConfig"].to<JsonObject>();
+                    hasGenerationConfig = true;
                 }
+                generationConfig[param.key()] = param.value();
+            }
+            // Other parameters go directly into the root object
+            else if (param.key() != "model" && param.key() != "contents" && 
+                     param.key() != "systemInstruction") {
+                doc[param.key()] = param.value();
             }
         }
     }
@@ -132,11 +173,24 @@ String AI_API_Gemini_Handler::buildRequestBody(const String& modelName, const St
     // safetySetting["category"] = "HARM_CATEGORY_SEXUALLY_EXPLICIT";
     // safetySetting["threshold"] = "BLOCK_MEDIUM_AND_ABOVE"; // Or BLOCK_LOW_AND_ABOVE, BLOCK_ONLY_HIGH
 
-    String requestBody;
-    serializeJson(doc, requestBody);
     // Serial.println("Gemini Request Body:"); // Debug
-    // Serial.println(requestBody); // Debug
-    return requestBody;
+    // serializeJson(doc, Serial); // Debug
+    _applyCachedContent(doc);
+    return true;
+}
+
+bool AI_API_Gemini_Handler::setCachedContent(const String& name) {
+    _cachedContent = name;
+    return true;
+}
+
+void AI_API_Gemini_Handler::_applyCachedContent(JsonDocument& doc) const {
+    if (_cachedContent.isEmpty()) return;
+    // The cached context holds them; Gemini rejects requests that send them again
+    doc.remove("systemInstruction");
+    doc.remove("tools");
+    doc.remove("tool_config");
+    doc["cachedContent"] = _cachedContent;
 }
 
 String AI_API_Gemini_Handler::parseResponseBody(const String& responsePayload,
@@ -146,7 +200,21 @@ String AI_API_Gemini_Handler::parseResponseBody(const String& responsePayload,
     doc.clear();
     errorMsg = ""; // Clear previous error
 
-    DeserializationError error = deserializeJson(doc, responsePayload);
+    DeserializationError error = deserializeJson(doc, responsePayload, DeserializationOption::Filter(_responseFilter));
+    return _extractResponseContent(error, errorMsg, doc);
+}
+
+String AI_API_Gemini_Handler::parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) {
+    resetState(); // Reset finish reason and tokens before parsing
+    doc.clear();
+    errorMsg = ""; // Clear previous error
+
+    DeserializationError error = deserializeJson(doc, responseStream, DeserializationOption::Filter(_responseFilter));
+    return _extractResponseContent(error, errorMsg, doc);
+}
+
+// Extract the content from a deserialized response (shared by the String and Stream variants)
+String AI_API_Gemini_Handler::_extractResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc) {
     if (error) {
         errorMsg = "JSON Deserialization failed: " + String(error.c_str());
         return "";
@@ -166,6 +234,7 @@ String AI_API_Gemini_Handler::parseResponseBody(const String& responsePayload,
         if (!usageMetadata["totalTokenCount"].isNull()) {
             _lastTotalTokens = usageMetadata["totalTokenCount"].as<int>(); // Store in base class member
         }
+        _lastCachedTokens = usageMetadata["cachedContentTokenCount"] | 0;
     }
 
     // Extract the content: response -> candidates[0] -> content -> parts[0] -> text
@@ -193,13 +262,6 @@ String AI_API_Gemini_Handler::parseResponseBody(const String& responsePayload,
             if (content["parts"].is<JsonArray>() && content["parts"].size() > 0) {
                 JsonObject firstPart = content["parts"][0];
                 if (firstPart["text"].is<const char*>()) {
-                    // Store the total tokens if available
-                    if (doc["usageMetadata"].is<JsonObject>()) {
-                        JsonObject usageMetadata = doc["usageMetadata"];
-                        if (!usageMetadata["totalTokenCount"].isNull()) {
-                            _totalTokens = usageMetadata["totalTokenCount"].as<int>();
-                        }
-                    }
                     // Success! Return the text.
                     return firstPart["text"].as<String>();
                 } else {
@@ -226,7 +288,7 @@ String AI_API_Gemini_Handler::parseResponseBody(const String& responsePayload,
         }
         return "";
     } else {
-         errorMsg = "Invalid Gemini response format: Missing 'candidates', 'error', or 'promptFeedback'. Payload: " + responsePayload;
+         errorMsg = "Invalid Gemini response format: Missing 'candidates', 'error', or 'promptFeedback'.";
     }
 
     // If we reached here, something went wrong with parsing the expected structure
@@ -235,39 +297,14 @@ String AI_API_Gemini_Handler::parseResponseBody(const String& responsePayload,
 }
 
 #ifdef ENABLE_TOOL_CALLS
-String AI_API_Gemini_Handler::buildToolCallsRequestBody(const String& modelName,
-                        const String* toolsArray, int toolsArraySize,
-                        const String& systemMessage, const String& toolChoice,
-                        int maxTokens,
-                        const String& userMessage, JsonDocument& doc) {
-    // Use the provided 'doc' reference. Clear it first.
-    doc.clear();
-
-    // --- Add System Instruction (Optional) ---
-    if (systemMessage.length() > 0) {
-        JsonObject systemInstruction = doc["systemInstruction"].to<JsonObject>();
-        JsonArray parts = systemInstruction["parts"].to<JsonArray>();
-        JsonObject textPart = parts.add<JsonObject>();
-        textPart["text"] = systemMessage;
-    }
-
-    // --- Add Generation Config (Optional) for maxTokens ---
-    if (maxTokens > 0) {
-        JsonObject generationConfig = doc["generationConfig"].to<JsonObject>();
-        generationConfig["maxOutputTokens"] = maxTokens;
-    }
-
-    // --- Add User Content ---
-    JsonArray contents = doc["contents"].to<JsonArray>();
-    JsonObject userContent = contents.add<JsonObject>();
-    userContent["role"] = "user";
-    JsonArray userParts = userContent["parts"].to<JsonArray>();
-    JsonObject userTextPart = userParts.add<JsonObject>();
-    userTextPart["text"] = userMessage;
+// Convert the tool definitions to the Gemini "tools" array
+String AI_API_Gemini_Handler::buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) {
+    errorMsg = "";
+    JsonDocument toolsDoc;
 
     // --- Add Tools Array ---
     // Reference: https://ai.google.dev/docs/function_calling
-    JsonArray tools = doc["tools"].to<JsonArray>();
+    JsonArray tools = toolsDoc.to<JsonArray>();
     
     // Create a single tool object with an array of function declarations
     JsonObject tool = tools.add<JsonObject>();
@@ -279,10 +316,8 @@ String AI_API_Gemini_Handler::buildToolCallsRequestBody(const String& modelName,
         JsonDocument toolDoc;
         DeserializationError error = deserializeJson(toolDoc, toolsArray[i]);
         if (error) {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Error parsing tool JSON: " + String(error.c_str()));
-            Serial.println("Tool JSON: " + toolsArray[i]);
-            #endif
+            AI_API_LOGE("Error parsing tool JSON: %s", error.c_str());
+            AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Tool JSON", toolsArray[i].c_str(), toolsArray[i].length());
             continue;
         }
         
@@ -322,9 +357,7 @@ String AI_API_Gemini_Handler::buildToolCallsRequestBody(const String& modelName,
         
         // Skip if no name was found (required field)
         if (name.isEmpty()) {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Skipping tool without name");
-            #endif
+            AI_API_LOGW("Skipping tool without name");
             continue;
         }
         
@@ -406,6 +439,48 @@ String AI_API_Gemini_Handler::buildToolCallsRequestBody(const String& modelName,
         }
     }
 
+    String toolsJson;
+    serializeJson(toolsDoc, toolsJson);
+    return toolsJson;
+}
+
+bool AI_API_Gemini_Handler::buildToolCallsRequestBody(const String& modelName,
+                        const String& toolsJson,
+                        const String& systemMessage, const String& toolChoice,
+                        int maxTokens,
+                        const String& userMessage, JsonDocument& doc,
+                        const AI_API_Chat_History* history) {
+    // Use the provided 'doc' reference. Clear it first.
+    doc.clear();
+
+    // --- Add System Instruction (Optional) ---
+    if (systemMessage.length() > 0) {
+        JsonObject systemInstruction = doc["systemInstruction"].to<JsonObject>();
+        JsonArray parts = systemInstruction["parts"].to<JsonArray>();
+        JsonObject textPart = parts.add<JsonObject>();
+        textPart["text"] = systemMessage;
+    }
+
+    // --- Add Generation Config (Optional) for maxTokens ---
+    if (maxTokens > 0) {
+        JsonObject generationConfig = doc["generationConfig"].to<JsonObject>();
+        generationConfig["maxOutputTokens"] = maxTokens;
+    }
+
+    // --- Add User Content ---
+    JsonArray contents = doc["contents"].to<JsonArray>();
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryContents(contents, history);
+    
+    JsonObject userContent = contents.add<JsonObject>();
+    userContent["role"] = "user";
+    JsonArray userParts = userContent["parts"].to<JsonArray>();
+    JsonObject userTextPart = userParts.add<JsonObject>();
+    userTextPart["text"] = userMessage;
+
+    // Add tools array (converted once by buildToolsJson)
+    doc["tools"] = serialized(toolsJson);
+
     // --- Tool Choice (if specified) ---
     if (toolChoice.length() > 0) {
         // For Gemini, the correct structure is:
@@ -449,21 +524,16 @@ String AI_API_Gemini_Handler::buildToolCallsRequestBody(const String& modelName,
             functionCallingConfig["mode"] = upperChoice;
         }
         else {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Warning: unsupported tool_choice value for Gemini: " + trimmedChoice);
-            #endif
+            AI_API_LOGW("Unsupported tool_choice value for Gemini: %s", trimmedChoice.c_str());
         }
     }
 
-    String requestBody;
-    serializeJson(doc, requestBody);
     
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.println("Gemini Tool Calls Request Body:");
-    Serial.println(requestBody);
-    #endif
+    _applyCachedContent(doc);
+    
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Gemini tool calls body", doc);
     
-    return requestBody;
+    return true;
 }
 
 String AI_API_Gemini_Handler::parseToolCallsResponseBody(const String& responsePayload,
@@ -473,7 +543,21 @@ String AI_API_Gemini_Handler::parseToolCallsResponseBody(const String& responseP
     doc.clear();
     errorMsg = "";
 
-    DeserializationError error = deserializeJson(doc, responsePayload);
+    DeserializationError error = deserializeJson(doc, responsePayload, DeserializationOption::Filter(_toolCallsResponseFilter));
+    return _extractToolCallsResponseContent(error, errorMsg, doc);
+}
+
+String AI_API_Gemini_Handler::parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) {
+    resetState(); 
+    doc.clear();
+    errorMsg = "";
+
+    DeserializationError error = deserializeJson(doc, responseStream, DeserializationOption::Filter(_toolCallsResponseFilter));
+    return _extractToolCallsResponseContent(error, errorMsg, doc);
+}
+
+// Extract the content from a deserialized response (shared by the String and Stream variants)
+String AI_API_Gemini_Handler::_extractToolCallsResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc) {
     if (error) {
         errorMsg = "JSON Deserialization failed: " + String(error.c_str());
         return "";
@@ -491,6 +575,7 @@ String AI_API_Gemini_Handler::parseToolCallsResponseBody(const String& responseP
         if (!usageMetadata["totalTokenCount"].isNull()) {
             _lastTotalTokens = usageMetadata["totalTokenCount"].as<int>();
         }
+        _lastCachedTokens = usageMetadata["cachedContentTokenCount"] | 0;
     }
 
     // Create a new result object with tool calls
@@ -507,9 +592,7 @@ String AI_API_Gemini_Handler::parseToolCallsResponseBody(const String& responseP
             String geminiFinishReason = doc["candidates"][0]["finishReason"].as<String>();
             
             // For debugging
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Original Gemini finishReason: " + geminiFinishReason);
-            #endif
+            AI_API_LOGD("Original Gemini finishReason: %s", geminiFinishReason.c_str());
         }
         
         JsonObject content = doc["candidates"][0]["content"];
@@ -583,15 +666,16 @@ String AI_API_Gemini_Handler::parseToolCallsResponseBody(const String& responseP
     }
 }
 
-String AI_API_Gemini_Handler::buildToolCallsFollowUpRequestBody(const String& modelName,
-                        const String* toolsArray, int toolsArraySize,
+bool AI_API_Gemini_Handler::buildToolCallsFollowUpRequestBody(const String& modelName,
+                        const String& toolsJson,
                         const String& systemMessage, const String& toolChoice,
                         const String& lastUserMessage,
                         const String& lastAssistantToolCallsJson,
                         const String& toolResultsJson,
                         int followUpMaxTokens,
                         const String& followUpToolChoice,
-                        JsonDocument& doc) {
+                        JsonDocument& doc,
+                        const AI_API_Chat_History* history) {
     // Use the provided 'doc' reference. Clear it first.
     doc.clear();
 
@@ -612,6 +696,9 @@ String AI_API_Gemini_Handler::buildToolCallsFollowUpRequestBody(const String& mo
     // --- Build Conversation History ---
     JsonArray contents = doc["contents"].to<JsonArray>();
 
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryContents(contents, history);
+    
     // Add user's original message
     JsonObject userContent = contents.add<JsonObject>();
     userContent["role"] = "user";
@@ -619,226 +706,11 @@ String AI_API_Gemini_Handler::buildToolCallsFollowUpRequestBody(const String& mo
     JsonObject userTextPart = userParts.add<JsonObject>();
     userTextPart["text"] = lastUserMessage;
 
-    // Parse and add the assistant's response with function calls
-    JsonDocument assistantDoc;
-    DeserializationError assistantError = deserializeJson(assistantDoc, lastAssistantToolCallsJson);
-    if (!assistantError) {
-        // Create the assistant message
-        JsonObject assistantContent = contents.add<JsonObject>();
-        assistantContent["role"] = "model";
-        JsonArray assistantParts = assistantContent["parts"].to<JsonArray>();
-        
-        // Add function calls (ensure we have at least one part)
-        if (assistantDoc.is<JsonArray>()) {
-            JsonArray toolCalls = assistantDoc.as<JsonArray>();
-            
-            for (JsonVariant toolCall : toolCalls) {
-                if (toolCall["type"] == "function" && 
-                    !toolCall["function"].isNull()) {
-                    
-                    JsonObject function = toolCall["function"];
-                    
-                    if (!function["name"].isNull() && !function["arguments"].isNull()) {
-                        JsonObject functionCallPart = assistantParts.add<JsonObject>();
-                        JsonObject functionCall = functionCallPart["functionCall"].to<JsonObject>();
-                        
-                        functionCall["name"] = function["name"].as<String>();
-                        
-                        // Parse and add arguments
-                        JsonDocument argsDoc;
-                        DeserializationError argsError = deserializeJson(argsDoc, function["arguments"].as<String>());
-                        if (!argsError) {
-                            functionCall["args"] = argsDoc.as<JsonObject>();
-                        } else {
-                            // If we can't parse as JSON, use as a string
-                            functionCall["args"] = JsonObject();
-                        }
-                    }
-                }
-            }
-            
-            // If no parts were added, add a dummy text part to avoid empty parts array
-            if (assistantParts.size() == 0) {
-                JsonObject textPart = assistantParts.add<JsonObject>();
-                textPart["text"] = "";
-            }
-        }
-    }
-    
-    // Parse and add the tool results
-    JsonDocument resultsDoc;
-    DeserializationError resultsError = deserializeJson(resultsDoc, toolResultsJson);
-    if (!resultsError && resultsDoc.is<JsonArray>()) {
-        JsonArray results = resultsDoc.as<JsonArray>();
-        
-        for (JsonVariant result : results) {
-            if (result["function"].is<JsonObject>() && 
-                !result["function"]["name"].isNull() && 
-                !result["function"]["output"].isNull()) {
-                
-                // Add function response
-                JsonObject userFunctionContent = contents.add<JsonObject>();
-                userFunctionContent["role"] = "user";
-                JsonArray userFunctionParts = userFunctionContent["parts"].to<JsonArray>();
-                
-                JsonObject functionResponsePart = userFunctionParts.add<JsonObject>();
-                JsonObject functionResponse = functionResponsePart["functionResponse"].to<JsonObject>();
-                
-                functionResponse["name"] = result["function"]["name"].as<String>();
-                
-                // Try to parse the output as JSON
-                JsonDocument outputDoc;
-                DeserializationError outputError = deserializeJson(outputDoc, result["function"]["output"].as<String>());
-                if (!outputError) {
-                    JsonObject contentObj = functionResponse["response"].to<JsonObject>();
-                    contentObj["content"] = outputDoc.as<JsonObject>();
-                } else {
-                    // If not valid JSON, use text format
-                    JsonObject contentObj = functionResponse["response"].to<JsonObject>();
-                    contentObj["content"] = result["function"]["output"].as<String>();
-                }
-            }
-        }
-    }
+    // Add the assistant's function calls and their results
+    _appendToolCallsRound(contents, lastAssistantToolCallsJson, toolResultsJson);
 
-    // --- Add Tools Array for Follow-up ---
-    // Create a single tool object with an array of function declarations
-    JsonArray tools = doc["tools"].to<JsonArray>();
-    JsonObject tool = tools.add<JsonObject>();
-    JsonArray functionDeclarations = tool["functionDeclarations"].to<JsonArray>();
-    
-    // Process each tool definition in the toolsArray (copy from buildToolCallsRequestBody)
-    for (int i = 0; i < toolsArraySize; i++) {
-        // Parse the tool JSON
-        JsonDocument toolDoc;
-        DeserializationError error = deserializeJson(toolDoc, toolsArray[i]);
-        if (error) {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Error parsing tool JSON: " + String(error.c_str()));
-            Serial.println("Tool JSON: " + toolsArray[i]);
-            #endif
-            continue;
-        }
-        
-        // Extract the function details based on format (simple or nested)
-        String name, description;
-        JsonVariant parameters;
-        
-        if (!toolDoc["type"].isNull() && !toolDoc["function"].isNull()) {
-            // OpenAI format: {"type":"function", "function":{...}}
-            JsonObject function = toolDoc["function"];
-            
-            if (!function["name"].isNull()) {
-                name = function["name"].as<String>();
-            }
-            
-            if (!function["description"].isNull()) {
-                description = function["description"].as<String>();
-            }
-            
-            if (!function["parameters"].isNull()) {
-                parameters = function["parameters"];
-            }
-        } else {
-            // Simpler format: {"name":"...", "description":"...", "parameters":{...}}
-            if (!toolDoc["name"].isNull()) {
-                name = toolDoc["name"].as<String>();
-            }
-            
-            if (!toolDoc["description"].isNull()) {
-                description = toolDoc["description"].as<String>();
-            }
-            
-            if (!toolDoc["parameters"].isNull()) {
-                parameters = toolDoc["parameters"];
-            }
-        }
-        
-        // Skip if no name was found (required field)
-        if (name.isEmpty()) {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Skipping tool without name");
-            #endif
-            continue;
-        }
-        
-        // Create function declaration object
-        JsonObject functionDeclaration = functionDeclarations.add<JsonObject>();
-        functionDeclaration["name"] = name;
-        
-        if (description.length() > 0) {
-            functionDeclaration["description"] = description;
-        }
-        
-        if (!parameters.isNull()) {
-            // Convert parameters to Gemini format if needed
-            JsonObject geminiParams = functionDeclaration["parameters"].to<JsonObject>();
-            
-            // Check if we need to convert from OpenAI format to Gemini format
-            if (parameters["type"] == "object") {
-                // OpenAI format uses lowercase types, Gemini uses uppercase
-                geminiParams["type"] = "OBJECT";
-                
-                // Copy properties
-                if (!parameters["properties"].isNull()) {
-                    JsonObject srcProps = parameters["properties"];
-                    JsonObject geminiProps = geminiParams["properties"].to<JsonObject>();
-                    
-                    // Copy each property, converting types to uppercase
-                    for (JsonPair kv : srcProps) {
-                        JsonObject srcProp = kv.value().as<JsonObject>();
-                        JsonObject geminiProp = geminiProps[kv.key().c_str()].to<JsonObject>();
-                        
-                        // Convert type to uppercase
-                        if (!srcProp["type"].isNull()) {
-                            String type = srcProp["type"].as<String>();
-                            type.toUpperCase(); // Modify the string in place
-                            geminiProp["type"] = type; // Now assign the modified string
-                        }
-                        
-                        // Copy other fields
-                        if (!srcProp["description"].isNull()) {
-                            geminiProp["description"] = srcProp["description"];
-                        }
-                        
-                        if (!srcProp["enum"].isNull()) {
-                            JsonArray srcEnum = srcProp["enum"];
-                            JsonArray geminiEnum = geminiProp["enum"].to<JsonArray>();
-                            for (JsonVariant enumVal : srcEnum) {
-                                geminiEnum.add(enumVal);
-                            }
-                        }
-                    }
-                }
-                
-                // Copy required array
-                if (!parameters["required"].isNull()) {
-                    JsonArray srcRequired = parameters["required"];
-                    JsonArray geminiRequired = geminiParams["required"].to<JsonArray>();
-                    for (JsonVariant req : srcRequired) {
-                        geminiRequired.add(req);
-                    }
-                }
-            } else {
-                // Assume parameters are already in Gemini format, copy directly
-                for (JsonPair kv : parameters.as<JsonObject>()) {
-                    if (kv.value().is<JsonObject>()) {
-                        JsonObject subObj = geminiParams[kv.key().c_str()].to<JsonObject>();
-                        for (JsonPair subKv : kv.value().as<JsonObject>()) {
-                            subObj[subKv.key().c_str()] = subKv.value();
-                        }
-                    } else if (kv.value().is<JsonArray>()) {
-                        JsonArray arr = geminiParams[kv.key().c_str()].to<JsonArray>();
-                        for (JsonVariant item : kv.value().as<JsonArray>()) {
-                            arr.add(item);
-                        }
-                    } else {
-                        geminiParams[kv.key().c_str()] = kv.value();
-                    }
-                }
-            }
-        }
-    }
+    // Add tools array (converted once by buildToolsJson)
+    doc["tools"] = serialized(toolsJson);
 
     // --- Tool Choice (if specified) ---
     if (followUpToolChoice.length() > 0) {
@@ -883,9 +755,7 @@ String AI_API_Gemini_Handler::buildToolCallsFollowUpRequestBody(const String& mo
             functionCallingConfig["mode"] = upperChoice;
         }
         else {
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("Warning: unsupported tool_choice value for Gemini: " + trimmedChoice);
-            #endif
+            AI_API_LOGW("Unsupported tool_choice value for Gemini: %s", trimmedChoice.c_str());
         }
     } 
     else if (toolChoice.length() > 0) {
@@ -927,23 +797,114 @@ String AI_API_Gemini_Handler::buildToolCallsFollowUpRequestBody(const String& mo
         }
     }
 
-    String requestBody;
-    serializeJson(doc, requestBody);
     
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.println("Gemini Tool Calls Follow-up Request Body:");
-    Serial.println(requestBody);
-    #endif
+    _applyCachedContent(doc);
     
-    return requestBody;
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Gemini tool calls follow-up body", doc);
+    
+    return true;
+}
+
+bool AI_API_Gemini_Handler::appendToolCallsRound(const String& assistantToolCallsJson,
+                                                const String& toolResultsJson, JsonDocument& doc) {
+    JsonArray contents = doc["contents"];
+    if (contents.isNull()) return false;
+    _appendToolCallsRound(contents, assistantToolCallsJson, toolResultsJson);
+    return true;
+}
+
+void AI_API_Gemini_Handler::_appendToolCallsRound(JsonArray contents, const String& lastAssistantToolCallsJson,
+                                                  const String& toolResultsJson) {
+    // Parse and add the assistant's response with function calls
+    JsonDocument assistantDoc;
+    DeserializationError assistantError = deserializeJson(assistantDoc, lastAssistantToolCallsJson);
+    if (!assistantError) {
+        // Create the assistant message
+        JsonObject assistantContent = contents.add<JsonObject>();
+        assistantContent["role"] = "model";
+        JsonArray assistantParts = assistantContent["parts"].to<JsonArray>();
+        
+        // Add function calls (ensure we have at least one part)
+        if (assistantDoc.is<JsonArray>()) {
+            JsonArray toolCalls = assistantDoc.as<JsonArray>();
+            
+            for (JsonVariant toolCall : toolCalls) {
+                if (toolCall["type"] == "function" && 
+                    !toolCall["function"].isNull()) {
+                    
+                    JsonObject function = toolCall["function"];
+                    
+                    if (!function["name"].isNull() && !function["arguments"].isNull()) {
+                        JsonObject functionCallPart = assistantParts.add<JsonObject>();
+                        JsonObject functionCall = functionCallPart["functionCall"].to<JsonObject>();
+                        
+                        functionCall["name"] = function["name"].as<String>();
+                        
+                        // Parse and add arguments
+                        JsonDocument argsDoc;
+                        DeserializationError argsError = deserializeJson(argsDoc, function["arguments"].as<String>());
+                        if (!argsError) {
+                            functionCall["args"] = argsDoc.as<JsonObject>();
+                        } else {
+                            // If we can't parse as JSON, use as a string
+                            functionCall["args"] = JsonObject();
+                        }
+                    }
+                }
+            }
+            
+            // If no parts were added, add a dummy text part to avoid empty parts array
+            if (assistantParts.size() == 0) {
+                JsonObject textPart = assistantParts.add<JsonObject>();
+                textPart["text"] = "";
+            }
+        }
+    }
+    
+    // Parse and add the tool results
+    JsonDocument resultsDoc;
+    DeserializationError resultsError = deserializeJson(resultsDoc, toolResultsJson);
+    if (!resultsError && resultsDoc.is<JsonArray>()) {
+        JsonArray results = resultsDoc.as<JsonArray>();
+        
+        for (JsonVariant result : results) {
+            if (result["function"].is<JsonObject>() && 
+                !result["function"]["name"].isNull() && 
+                !result["function"]["output"].isNull()) {
+                
+                // Add function response
+                JsonObject userFunctionContent = contents.add<JsonObject>();
+                userFunctionContent["role"] = "user";
+                JsonArray userFunctionParts = userFunctionContent["parts"].to<JsonArray>();
+                
+                JsonObject functionResponsePart = userFunctionParts.add<JsonObject>();
+                JsonObject functionResponse = functionResponsePart["functionResponse"].to<JsonObject>();
+                
+                functionResponse["name"] = result["function"]["name"].as<String>();
+                
+                // Try to parse the output as JSON
+                JsonDocument outputDoc;
+                DeserializationError outputError = deserializeJson(outputDoc, result["function"]["output"].as<String>());
+                if (!outputError) {
+                    JsonObject contentObj = functionResponse["response"].to<JsonObject>();
+                    contentObj["content"] = outputDoc.as<JsonObject>();
+                } else {
+                    // If not valid JSON, use text format
+                    JsonObject contentObj = functionResponse["response"].to<JsonObject>();
+                    contentObj["content"] = result["function"]["output"].as<String>();
+                }
+            }
+        }
+    }
 }
 #endif // ENABLE_TOOL_CALLS
 
 #ifdef ENABLE_STREAM_CHAT
-String AI_API_Gemini_Handler::buildStreamRequestBody(const String& modelName, const String& systemRole,
+bool AI_API_Gemini_Handler::buildStreamRequestBody(const String& modelName, const String& systemRole,
                                                     float temperature, int maxTokens,
                                                     const String& userMessage, JsonDocument& doc,
-                                                    const String& customParams) {
+                                                    JsonObjectConst customParams,
+                                                    const AI_API_Chat_History* history) {
     // Use the same logic as buildRequestBody but DON'T add "stream": true
     // Gemini streaming uses a different endpoint (:streamGenerateContent) instead
     doc.clear();
@@ -958,48 +919,44 @@ String AI_API_Gemini_Handler::buildStreamRequestBody(const String& modelName, co
 
     // --- Add User Content ---
     JsonArray contents = doc["contents"].to<JsonArray>();
+    // Previous conversation turns (empty unless chat history is enabled)
+    appendHistoryContents(contents, history);
+    
     JsonObject userContent = contents.add<JsonObject>();
     userContent["role"] = "user";
     JsonArray userParts = userContent["parts"].to<JsonArray>();
     JsonObject userTextPart = userParts.add<JsonObject>();
     userTextPart["text"] = userMessage;
 
-    // --- Process custom parameters if provided ---
-    if (customParams.length() > 0) {
-        // Create a temporary document to parse the custom parameters
-        JsonDocument paramsDoc;
-        DeserializationError error = deserializeJson(paramsDoc, customParams);
+    // Copy custom parameters (parsed once by setChatParameters/setStreamChatParameters)
+    if (!customParams.isNull()) {
+        // Check if there are parameters specifically for generationConfig
+        JsonObject generationConfig;
+        bool hasGenerationConfig = false;
         
-        // Only proceed if parsing was successful
-        if (!error) {
-            // Check if there are parameters specifically for generationConfig
-            JsonObject generationConfig;
-            bool hasGenerationConfig = false;
-            
-            for (JsonPair param : paramsDoc.as<JsonObject>()) {
-                // These parameters should go into generationConfig object
-                if (param.key() == "temperature" || param.key() == "topP" || 
-                    param.key() == "topK" || param.key() == "maxOutputTokens" ||
-                    param.key() == "candidateCount" || param.key() == "stopSequences" ||
-                    param.key() == "responseMimeType" || param.key() == "responseSchema" ||
-                    param.key() == "presencePenalty" || param.key() == "frequencyPenalty" ||
-                    param.key() == "seed" || param.key() == "responseLogprobs" ||
-                    param.key() == "logprobs" || param.key() == "enableEnhancedCivicAnswers" || 
-                    param.key() == "speechConfig" || param.key() == "thinkingConfig" || 
-                    param.key() == "mediaResolution") {
-                    
-                    // Create generationConfig object if it doesn't exist yet
-                    if (!hasGenerationConfig) {
-                        generationConfig = doc["generationConfig"].to<JsonObject>();
-                        hasGenerationConfig = true;
-                    }
-                    generationConfig[param.key()] = param.value();
-                }
-                // Other parameters go directly into the root object (skip stream as it's not used)
-                else if (param.key() != "model" && param.key() != "contents" && 
-                         param.key() != "systemInstruction" && param.key() != "stream") {
-                    doc[param.key()] = param.value();
+        for (JsonPairConst param : customParams) {
+            // These parameters should go into generationConfig object
+            if (param.key() == "temperature" || param.key() == "topP" || 
+                param.key() == "topK" || param.key() == "maxOutputTokens" ||
+                param.key() == "candidateCount" || param.key() == "stopSequences" ||
+                param.key() == "responseMimeType" || param.key() == "responseSchema" ||
+                param.key() == "presencePenalty" || param.key() == "frequencyPenalty" ||
+                param.key() == "seed" || param.key() == "responseLogprobs" ||
+                param.key() == "logprobs" || param.key() == "enableEnhancedCivicAnswers" || 
+                param.key() == "speechConfig" || param.key() == "thinkingConfig" || 
+                param.key() == "mediaResolution") {
+                
+                // Create generationConfig object if it doesn't exist yet
+                if (!hasGenerationConfig) {
+                    generationConfig = doc["generationConfig"].to<JsonObject>();
+                    hasGenerationConfig = true;
                 }
+                generationConfig[param.key()] = param.value();
+            }
+            // Other parameters go directly into the root object (skip stream as it's not used)
+            else if (param.key() != "model" && param.key() != "contents" && 
+                     param.key() != "systemInstruction" && param.key() != "stream") {
+                doc[param.key()] = param.value();
             }
         }
     }
@@ -1033,41 +990,31 @@ String AI_API_Gemini_Handler::buildStreamRequestBody(const String& modelName, co
     // Note: Gemini streaming doesn't use "stream": true in the request body
     // Instead, it uses the :streamGenerateContent endpoint with ?alt=sse
 
-    String requestBody;
-    serializeJson(doc, requestBody);
-    return requestBody;
+    _applyCachedContent(doc);
+    return true;
+}
+
+String AI_API_Gemini_Handler::processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) {
+    return _processStreamChunk(data, length, isComplete, errorMsg, _streamChunkFilter);
 }
 
-String AI_API_Gemini_Handler::processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) {
-    resetState(); // Reset state for each chunk
+// Shared by the chat and tool calls streams, which differ in the fields their filter keeps
+String AI_API_Gemini_Handler::_processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg,
+                                                  const JsonDocument& filter) {
     isComplete = false;
     errorMsg = "";
 
     // Gemini streaming actually DOES use Server-Sent Events format like OpenAI
     // Format: "data: {json}\n" based on the log provided
-    
-    if (rawChunk.isEmpty()) {
-        return "";
-    }
+    // data holds the payload after "data:", already trimmed by AI_API_SSE_Reader
 
-    // Look for "data: " prefix (like OpenAI/DeepSeek)
-    int dataIndex = rawChunk.indexOf("data: ");
-    if (dataIndex == -1) {
-        // Not a data line, skip
+    if (length == 0) {
         return "";
     }
 
-    // Extract JSON part after "data: "
-    String jsonPart = rawChunk.substring(dataIndex + 6); // 6 = length of "data: "
-    jsonPart.trim(); // Remove any whitespace
-
-    if (jsonPart.isEmpty()) {
-        return "";
-    }
-
-    // Parse the JSON chunk
-    JsonDocument chunkDoc; // Larger buffer for Gemini responses
-    DeserializationError error = deserializeJson(chunkDoc, jsonPart);
+    // Parse the JSON chunk directly from the stream buffer
+    JsonDocument& chunkDoc = _streamChunkDoc; // Reused for every chunk, cleared by deserializeJson()
+    DeserializationError error = deserializeJson(chunkDoc, data, length, DeserializationOption::Filter(filter));
     if (error) {
         errorMsg = "Failed to parse Gemini streaming chunk JSON: " + String(error.c_str());
         return "";
@@ -1085,6 +1032,7 @@ String AI_API_Gemini_Handler::processStreamChunk(const String& rawChunk, bool& i
         if (!usageMetadata["totalTokenCount"].isNull()) {
             _lastTotalTokens = usageMetadata["totalTokenCount"].as<int>();
         }
+        _lastCachedTokens = usageMetadata["cachedContentTokenCount"] | 0;
     }
 
     // Extract content from candidates array
@@ -1111,6 +1059,24 @@ String AI_API_Gemini_Handler::processStreamChunk(const String& rawChunk, bool& i
             }
         }
 
+#ifdef ENABLE_STREAM_TOOL_CALLS
+        // Function calls (only kept by the tool calls filter) arrive whole, each in one part
+        for (JsonObject part : firstCandidate["content"]["parts"].as<JsonArray>()) {
+            if (part["functionCall"].isNull()) continue;
+            StreamToolCall* call = beginStreamToolCall();
+            if (call == nullptr) continue; // Dropped
+            call->name = part["functionCall"]["name"] | "";
+            if (!part["functionCall"]["args"].isNull()) {
+                serializeJson(part["functionCall"]["args"], call->arguments);
+            }
+            completeStreamToolCalls();
+        }
+        // Same finish reason as a non-streaming response with function calls
+        if (isComplete && _streamToolCallCount > 0) {
+            _lastFinishReason = "tool_calls";
+        }
+#endif
+
         // Extract content from the candidate
         if (firstCandidate["content"].is<JsonObject>()) {
             JsonObject content = firstCandidate["content"];
@@ -1128,4 +1094,21 @@ String AI_API_Gemini_Handler::processStreamChunk(const String& rawChunk, bool& i
 }
 #endif // ENABLE_STREAM_CHAT
 
+#ifdef ENABLE_STREAM_TOOL_CALLS
+bool AI_API_Gemini_Handler::buildToolCallsStreamRequestBody(const String& modelName,
+                                                            const String& toolsJson,
+                                                            const String& systemMessage, const String& toolChoice,
+                                                            int maxTokens,
+                                                            const String& userMessage, JsonDocument& doc,
+                                                            const AI_API_Chat_History* history) {
+    // Same body as tcChat(): Gemini streams through the :streamGenerateContent endpoint instead
+    return buildToolCallsRequestBody(modelName, toolsJson, systemMessage, toolChoice, maxTokens,
+                                     userMessage, doc, history);
+}
+
+String AI_API_Gemini_Handler::processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) {
+    return _processStreamChunk(data, length, isComplete, errorMsg, _toolCallsStreamChunkFilter);
+}
+#endif // ENABLE_STREAM_TOOL_CALLS
+
 #endif // USE_AI_API_GEMINI
\ No newline at end of file
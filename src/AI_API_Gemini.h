@@ -9,55 +9,109 @@
 
 #include "AI_API_Platform_Handler.h"
 
-class AI_API_Gemini_Handler : public AI_API_Platform_Handler {
+class AI_API_Gemini_Handler final : public AI_API_Platform_Handler {
 public:
+    AI_API_Gemini_Handler(); // Builds the response filters
     String getEndpoint(const String& modelName, const String& apiKey, const String& customEndpoint = "") const override;
     void setHeaders(HTTPClient& httpClient, const String& apiKey) override;
-    String buildRequestBody(const String& modelName, const String& systemRole,
+    bool buildRequestBody(const String& modelName, const String& systemRole,
                             float temperature, int maxTokens,
                             const String& userMessage, JsonDocument& doc,
-                            const String& customParams = "") override;
+                            JsonObjectConst customParams = JsonObjectConst(),
+                            const AI_API_Chat_History* history = nullptr) override;
     String parseResponseBody(const String& responsePayload,
                              String& errorMsg, JsonDocument& doc) override;
+    String parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) override;
 
-    int getTotalTokens() const override { return _totalTokens; }
+    // Use a context created with the cachedContents API ("cachedContents/..."); it replaces
+    // the system instruction and tools of every request. "" for none.
+    bool setCachedContent(const String& name) override;
 
 #ifdef ENABLE_TOOL_CALLS
     // Tool calls methods
-    String buildToolCallsRequestBody(const String& modelName,
-                               const String* toolsArray, int toolsArraySize,
+    String buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) override;
+    bool buildToolCallsRequestBody(const String& modelName,
+                               const String& toolsJson,
                                const String& systemMessage, const String& toolChoice,
                                int maxTokens,
-                               const String& userMessage, JsonDocument& doc) override;
+                               const String& userMessage, JsonDocument& doc,
+                               const AI_API_Chat_History* history = nullptr) override;
                                
     String parseToolCallsResponseBody(const String& responsePayload,
                                 String& errorMsg, JsonDocument& doc) override;
+    String parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) override;
                                 
-    String buildToolCallsFollowUpRequestBody(const String& modelName,
-                               const String* toolsArray, int toolsArraySize,
+    bool buildToolCallsFollowUpRequestBody(const String& modelName,
+                               const String& toolsJson,
                                const String& systemMessage, const String& toolChoice,
                                const String& lastUserMessage,
                                const String& lastAssistantToolCallsJson,
                                const String& toolResultsJson,
                                int followUpMaxTokens,
                                const String& followUpToolChoice,
-                               JsonDocument& doc) override;
+                               JsonDocument& doc,
+                               const AI_API_Chat_History* history = nullptr) override;
+    bool appendToolCallsRound(const String& assistantToolCallsJson,
+                              const String& toolResultsJson, JsonDocument& doc) override;
 #endif
 
 #ifdef ENABLE_STREAM_CHAT
     // Streaming chat methods
     String getStreamEndpoint(const String& modelName, const String& apiKey, const String& customEndpoint = "") const override;
-    String buildStreamRequestBody(const String& modelName, const String& systemRole,
+    bool buildStreamRequestBody(const String& modelName, const String& systemRole,
                                 float temperature, int maxTokens,
                                 const String& userMessage, JsonDocument& doc,
-                                const String& customParams = "") override;
+                                JsonObjectConst customParams = JsonObjectConst(),
+                                const AI_API_Chat_History* history = nullptr) override;
                                 
-    String processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) override;
+    String processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) override;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Streaming tool calls methods
+    bool buildToolCallsStreamRequestBody(const String& modelName,
+                                         const String& toolsJson,
+                                         const String& systemMessage, const String& toolChoice,
+                                         int maxTokens,
+                                         const String& userMessage, JsonDocument& doc,
+                                         const AI_API_Chat_History* history = nullptr) override;
+    String processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) override;
 #endif
 
     // Add Gemini-specific methods here if needed
 private:
-    int _totalTokens = 0;  // Store the total tokens from the last response
+    // Shared by the String and Stream parse variants
+    String _extractResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc);
+#ifdef ENABLE_TOOL_CALLS
+    String _extractToolCallsResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc);
+    // The assistant's tool calls and their results, as added to a follow-up body
+    void _appendToolCallsRound(JsonArray contents, const String& lastAssistantToolCallsJson,
+                               const String& toolResultsJson);
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    // Shared by the chat and tool calls streams (filter: the fields to keep)
+    String _processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg,
+                               const JsonDocument& filter);
+#endif
+
+    // Add the stored conversation turns as "contents" entries (roles "user" and "model")
+    void appendHistoryContents(JsonArray contents, const AI_API_Chat_History* history) const;
+
+    // Replace the system instruction, tools and tool config by the cached context, if set
+    void _applyCachedContent(JsonDocument& doc) const;
+    String _cachedContent = "";   // "cachedContents/..." of setCachedContent(), "" for none
+
+    // Precomputed deserialization filters: only the fields this handler reads are kept
+    JsonDocument _responseFilter;
+#ifdef ENABLE_TOOL_CALLS
+    JsonDocument _toolCallsResponseFilter;
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    JsonDocument _streamChunkFilter;
+#endif
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    JsonDocument _toolCallsStreamChunkFilter;
+#endif
 };
 
 #endif // USE_AI_API_GEMINI
@@ -0,0 +1,115 @@
+// ESP32_AI_Connect/AI_API_Log.cpp
+
+#include "AI_API_Log.h"
+#include <stdarg.h>
+#include <atomic>
+
+#if AI_API_LOG_BUFFER_SIZE > 0
+#include <freertos/FreeRTOS.h>
+#include <freertos/ringbuf.h>
+#include <freertos/task.h>
+#endif
+
+static const char AI_API_LOG_TAGS[] = "-EWIDV"; // Indexed by level
+static Print* _logOutput = &Serial;
+static std::atomic<uint32_t> _logDropped{0};
+
+#if AI_API_LOG_BUFFER_SIZE > 0
+static RingbufHandle_t _logRing = nullptr;
+static portMUX_TYPE _logMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Writes queued lines out; blocks on the ring buffer while it is empty
+static void _logTaskEntry(void* param) {
+    RingbufHandle_t ring = (RingbufHandle_t)param;
+    while (true) {
+        size_t length = 0;
+        void* item = xRingbufferReceive(ring, &length, portMAX_DELAY);
+        if (item == nullptr) continue;
+        _logOutput->write((const uint8_t*)item, length);
+        vRingbufferReturnItem(ring, item);
+    }
+}
+
+// Create the ring buffer and its writer task on first use. Returns false if they
+// could not be created, in which case lines are written directly.
+static bool _logEnsureRing() {
+    if (_logRing != nullptr) return true;
+
+    // Create outside the critical section; if another task won the race, drop ours
+    RingbufHandle_t ring = xRingbufferCreate(AI_API_LOG_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (ring == nullptr) return false;
+
+    bool won = false;
+    portENTER_CRITICAL(&_logMux);
+    if (_logRing == nullptr) {
+        _logRing = ring;
+        won = true;
+    }
+    portEXIT_CRITICAL(&_logMux);
+
+    if (!won) {
+        vRingbufferDelete(ring);
+        return true;
+    }
+    xTaskCreate(_logTaskEntry, "ai_api_log", AI_API_LOG_TASK_STACK_SIZE, ring,
+                AI_API_LOG_TASK_PRIORITY, nullptr);
+    return true;
+}
+#endif
+
+void AI_API_Log::write(uint8_t level, const char* format, ...) {
+    if (level > AI_API_LOG_LEVEL_VERBOSE) level = AI_API_LOG_LEVEL_VERBOSE;
+
+    char line[AI_API_LOG_LINE_SIZE];
+    int prefix = snprintf(line, sizeof(line), "[AI][%c] ", AI_API_LOG_TAGS[level]);
+
+    // Keep one byte for the newline
+    size_t space = sizeof(line) - prefix - 1;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line + prefix, space, format, args);
+    va_end(args);
+    if (length < 0) return;
+
+    size_t written = (size_t)length < space ? (size_t)length : space - 1;
+    if ((size_t)length > written && written >= 3) {
+        memcpy(line + prefix + written - 3, "...", 3); // Mark a cut line
+    }
+    line[prefix + written] = '\n';
+    _emit(line, prefix + written + 1);
+}
+
+void AI_API_Log::preview(uint8_t level, const char* label, const char* data, size_t length) {
+    size_t shown = length < AI_API_LOG_PREVIEW_BYTES ? length : AI_API_LOG_PREVIEW_BYTES;
+    write(level, "%s (%u bytes): %.*s%s", label, (unsigned)length, (int)shown,
+          data != nullptr ? data : "", shown < length ? "..." : "");
+}
+
+void AI_API_Log::previewJson(uint8_t level, const char* label, JsonVariantConst value) {
+    char buffer[AI_API_LOG_PREVIEW_BYTES + 1];
+    size_t shown = serializeJson(value, buffer, sizeof(buffer)); // Stops at the end of the buffer
+    size_t length = measureJson(value);
+    write(level, "%s (%u bytes): %.*s%s", label, (unsigned)length, (int)shown, buffer,
+          shown < length ? "..." : "");
+}
+
+void AI_API_Log::setOutput(Print* output) {
+    if (output != nullptr) _logOutput = output;
+}
+
+uint32_t AI_API_Log::getDroppedCount() {
+    return _logDropped.load(std::memory_order_relaxed);
+}
+
+void AI_API_Log::_emit(const char* line, size_t length) {
+#if AI_API_LOG_BUFFER_SIZE > 0
+    if (_logEnsureRing()) {
+        // Never wait for space: a full buffer means the output can't keep up
+        if (xRingbufferSend(_logRing, line, length, 0) != pdTRUE) {
+            _logDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+#endif
+    _logOutput->write((const uint8_t*)line, length);
+}
@@ -0,0 +1,61 @@
+// ESP32_AI_Connect/AI_API_Log.h
+
+#ifndef AI_API_LOG_H
+#define AI_API_LOG_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Leveled logging of the library.
+//
+// Messages above AI_API_LOG_LEVEL cost nothing: the level test is a constant, so the
+// compiler removes the call and its arguments (which still have to compile).
+// Messages are formatted printf-style into one stack buffer of AI_API_LOG_LINE_SIZE
+// bytes, never by concatenating Strings, and bodies are logged as previews of at most
+// AI_API_LOG_PREVIEW_BYTES followed by their full length.
+//
+// With AI_API_LOG_BUFFER_SIZE > 0 lines are queued in a ring buffer and written by a
+// task of priority AI_API_LOG_TASK_PRIORITY, so a slow serial port doesn't hold up a
+// request. Lines that don't fit are dropped (see getDroppedCount()).
+//
+// Usage:
+//   AI_API_LOGW("Request failed (%d), retrying in %u ms", httpCode, (unsigned)waitMs);
+//   AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Payload", payload.c_str(), payload.length());
+//   AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Body", doc);
+
+#define AI_API_LOG_AT(level, format, ...) \
+    do { if (AI_API_LOG_LEVEL >= (level)) AI_API_Log::write((level), format, ##__VA_ARGS__); } while (0)
+
+#define AI_API_LOGE(format, ...) AI_API_LOG_AT(AI_API_LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#define AI_API_LOGW(format, ...) AI_API_LOG_AT(AI_API_LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#define AI_API_LOGI(format, ...) AI_API_LOG_AT(AI_API_LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define AI_API_LOGD(format, ...) AI_API_LOG_AT(AI_API_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#define AI_API_LOGV(format, ...) AI_API_LOG_AT(AI_API_LOG_LEVEL_VERBOSE, format, ##__VA_ARGS__)
+
+// The first AI_API_LOG_PREVIEW_BYTES of data (not necessarily NUL-terminated) and its length
+#define AI_API_LOG_PREVIEW(level, label, data, length) \
+    do { if (AI_API_LOG_LEVEL >= (level)) AI_API_Log::preview((level), (label), (data), (length)); } while (0)
+
+// The same for a JSON value, serialized into the preview buffer
+#define AI_API_LOG_JSON(level, label, value) \
+    do { if (AI_API_LOG_LEVEL >= (level)) AI_API_Log::previewJson((level), (label), (value)); } while (0)
+
+class AI_API_Log {
+public:
+    // Use the macros above: they skip the call (and its arguments) for disabled levels
+    static void write(uint8_t level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+    static void preview(uint8_t level, const char* label, const char* data, size_t length);
+    static void previewJson(uint8_t level, const char* label, JsonVariantConst value);
+
+    // Where lines are written, Serial by default. Set it before the first message.
+    static void setOutput(Print* output);
+    // Lines dropped because the ring buffer was full
+    static uint32_t getDroppedCount();
+
+private:
+    static void _emit(const char* line, size_t length);
+};
+
+#endif // AI_API_LOG_H
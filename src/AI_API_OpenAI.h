@@ -9,56 +9,104 @@
 
 #include "AI_API_Platform_Handler.h"
 
-class AI_API_OpenAI_Handler : public AI_API_Platform_Handler {
+class AI_API_OpenAI_Handler final : public AI_API_Platform_Handler {
 public:
+    AI_API_OpenAI_Handler(); // Builds the response filters
     String getEndpoint(const String& modelName, const String& apiKey, const String& customEndpoint = "") const override;
     void setHeaders(HTTPClient& httpClient, const String& apiKey) override;
-    String buildRequestBody(const String& modelName, const String& systemRole,
+    bool buildRequestBody(const String& modelName, const String& systemRole,
                             float temperature, int maxTokens,
                             const String& userMessage, JsonDocument& doc,
-                            const String& customParams = "") override;
+                            JsonObjectConst customParams = JsonObjectConst(),
+                            const AI_API_Chat_History* history = nullptr) override;
     String parseResponseBody(const String& responsePayload,
                              String& errorMsg, JsonDocument& doc) override;
+    String parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) override;
 
 #ifdef ENABLE_STREAM_CHAT
     // --- Streaming Chat Methods (Override virtual methods from base class) ---
-    String buildStreamRequestBody(const String& modelName, const String& systemRole,
+    bool buildStreamRequestBody(const String& modelName, const String& systemRole,
                                  float temperature, int maxTokens,
                                  const String& userMessage, JsonDocument& doc,
-                                 const String& customParams = "") override;
-    String processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) override;
+                                 JsonObjectConst customParams = JsonObjectConst(),
+                                 const AI_API_Chat_History* history = nullptr) override;
+    String processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) override;
 #endif
 
 #ifdef ENABLE_TOOL_CALLS
     // --- Tool Calls Methods (Override virtual methods from base class) ---
-    virtual String buildToolCallsRequestBody(const String& modelName,
-                               const String* toolsArray, int toolsArraySize,
+    String buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) override;
+    virtual bool buildToolCallsRequestBody(const String& modelName,
+                               const String& toolsJson,
                                const String& systemMessage, const String& toolChoice,
                                        int maxTokens,
-                               const String& userMessage, JsonDocument& doc) override;
+                               const String& userMessage, JsonDocument& doc,
+                               const AI_API_Chat_History* history = nullptr) override;
                                
     String parseToolCallsResponseBody(const String& responsePayload,
                                 String& errorMsg, JsonDocument& doc) override;
+    String parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) override;
                                 
     // Build a follow-up request body with tool results
     // toolResultsJson: JSON array of tool results
     // lastUserMessage: The original user query
     // lastAssistantToolCallsJson: The tool calls JSON from the assistant's previous response
-    String buildToolCallsFollowUpRequestBody(const String& modelName,
-                                       const String* toolsArray, int toolsArraySize,
+    bool buildToolCallsFollowUpRequestBody(const String& modelName,
+                                       const String& toolsJson,
                                        const String& systemMessage, const String& toolChoice,
                                        const String& lastUserMessage,
                                        const String& lastAssistantToolCallsJson,
                                        const String& toolResultsJson,
                                        int followUpMaxTokens,
                                        const String& followUpToolChoice,
-                                       JsonDocument& doc);
+                                       JsonDocument& doc,
+                                       const AI_API_Chat_History* history = nullptr);
+    bool appendToolCallsRound(const String& assistantToolCallsJson,
+                              const String& toolResultsJson, JsonDocument& doc) override;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // --- Streaming Tool Calls Methods (Override virtual methods from base class) ---
+    bool buildToolCallsStreamRequestBody(const String& modelName,
+                                         const String& toolsJson,
+                                         const String& systemMessage, const String& toolChoice,
+                                         int maxTokens,
+                                         const String& userMessage, JsonDocument& doc,
+                                         const AI_API_Chat_History* history = nullptr) override;
+    String processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) override;
 #endif
 
     // Add OpenAI-specific methods here if needed, e.g.:
     // bool setResponseFormatJson(bool enable);
 
 private:
+    // Shared by the String and Stream parse variants
+    String _extractResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc);
+#ifdef ENABLE_TOOL_CALLS
+    String _extractToolCallsResponseContent(DeserializationError error, String& errorMsg, JsonDocument& doc);
+    // The assistant's tool calls and their results, as added to a follow-up body
+    void _appendToolCallsRound(JsonArray messages, const String& lastAssistantToolCallsJson,
+                               const String& toolResultsJson);
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    // Shared by the chat and tool calls streams (filter: the fields to keep)
+    String _processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg,
+                               const JsonDocument& filter);
+#endif
+
+    // Precomputed deserialization filters: only the fields this handler reads are kept
+    JsonDocument _responseFilter;
+#ifdef ENABLE_TOOL_CALLS
+    JsonDocument _toolCallsResponseFilter;
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    JsonDocument _streamChunkFilter;
+#endif
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    JsonDocument _toolCallsStreamChunkFilter;
+    int _streamToolCallIndex = 0;               // Provider index of the call being streamed
+    StreamToolCall* _streamToolCall = nullptr;  // The call being streamed, nullptr if dropped
+#endif
 };
 
 #endif // USE_AI_API_OPENAI
@@ -9,19 +9,81 @@
 
 // Include configuration to get access to ENABLE_TOOL_CALLS and ENABLE_STREAM_CHAT flags
 #include "ESP32_AI_Connect_config.h"
+#include "AI_API_Chat_History.h"
+#include "AI_API_Allocator.h"
+#include "AI_API_Log.h"
 
 // Forward declaration
 class ESP32_AI_Connect;
 
 class AI_API_Platform_Handler {
+public:
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // A tool call of a streamed response
+    struct StreamToolCall {
+        String id;            // "" on platforms without call ids (Gemini)
+        String name;
+        String arguments;     // JSON text; only complete once the call is counted in getStreamToolCallsCompleted()
+    };
+#endif
+
 protected:
     String _lastFinishReason = ""; // Store the finish reason from the last response
     int _lastTotalTokens = 0;    // Store token count from the last response
+    int _lastCachedTokens = 0;   // Prompt tokens of the last response read from the prompt cache
+    int _lastCacheWriteTokens = 0; // Prompt tokens written to the prompt cache (Claude)
+    bool _promptCaching = false; // Mark the fixed prompt parts as cacheable (see setPromptCaching)
+
+#ifdef ENABLE_STREAM_CHAT
+    // Parse target reused for every chunk of a stream. Its blocks come from the
+    // shared chunk pool, so parsing a chunk doesn't touch the heap.
+    JsonDocument _streamChunkDoc{AI_API_Pool_Allocator::instance()};
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Tool calls assembled from the deltas of the current stream. The first
+    // _streamToolCallsCompleted of them have all their arguments.
+    StreamToolCall _streamToolCalls[AI_API_STREAM_TOOL_CALLS_MAX];
+    size_t _streamToolCallCount = 0;
+    size_t _streamToolCallsCompleted = 0;
+
+    // Start the next tool call; nullptr (and the call is dropped) when
+    // AI_API_STREAM_TOOL_CALLS_MAX calls were started already
+    StreamToolCall* beginStreamToolCall() {
+        if (_streamToolCallCount >= AI_API_STREAM_TOOL_CALLS_MAX) {
+            AI_API_LOGW("More than %d tool calls in a stream, dropping the rest", AI_API_STREAM_TOOL_CALLS_MAX);
+            return nullptr;
+        }
+        StreamToolCall* call = &_streamToolCalls[_streamToolCallCount++];
+        call->id = "";
+        call->name = "";
+        call->arguments = "";
+        return call;
+    }
+    // Mark all calls started so far as complete
+    void completeStreamToolCalls() {
+        _streamToolCallsCompleted = _streamToolCallCount;
+    }
+#endif
 
     // Helper to reset state before parsing a new response
     virtual void resetState() {
         _lastFinishReason = "";
         _lastTotalTokens = 0;
+        _lastCachedTokens = 0;
+        _lastCacheWriteTokens = 0;
+    }
+
+    // Add the stored conversation turns to an OpenAI-style "messages" array.
+    // Turn contents are already JSON-encoded, so they are spliced in as-is.
+    void appendHistoryMessages(JsonArray messages, const AI_API_Chat_History* history) const {
+        if (history == nullptr) return;
+        AI_API_Chat_History::Turn turn;
+        for (size_t pos = 0; history->readTurn(pos, turn); ) {
+            JsonObject msg = messages.add<JsonObject>();
+            msg["role"] = (turn.role == AI_API_Chat_History::ASSISTANT) ? "assistant" : "user";
+            msg["content"] = serialized(turn.json, turn.jsonLength);
+        }
     }
 
     // Allow derived classes access to the main class's members if needed
@@ -42,11 +104,12 @@ public:
 
     // Build the JSON request body
     // Takes user message, config params, and a JsonDocument reference to populate
-    // Returns the serialized JSON string or empty string on error
-    virtual String buildRequestBody(const String& modelName, const String& systemRole,
+    // Returns true if doc was populated, false on error (the caller serializes doc)
+    virtual bool buildRequestBody(const String& modelName, const String& systemRole,
                                     float temperature, int maxTokens,
                                     const String& userMessage, JsonDocument& doc,
-                                    const String& customParams = "") = 0;
+                                    JsonObjectConst customParams = JsonObjectConst(),
+                                    const AI_API_Chat_History* history = nullptr) = 0;
 
     // Parse the JSON response payload
     // Takes raw response, reference to error string, and JsonDocument reference
@@ -55,23 +118,61 @@ public:
     virtual String parseResponseBody(const String& responsePayload,
                                      String& errorMsg, JsonDocument& doc) = 0;
 
+    // Parse the JSON response read directly from the HTTP body stream
+    // Same contract as parseResponseBody, without buffering the payload in a String first
+    virtual String parseResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) = 0;
+
     // Get the total tokens from the last response
     virtual int getTotalTokens() const { return _lastTotalTokens; };
 
     // Get the finish reason from the last response
     virtual String getFinishReason() const { return _lastFinishReason; };
 
+    // Set the finish reason and token count without parsing a response
+    // (e.g. for a reply served from the response cache)
+    void setResultMetadata(const String& finishReason, int totalTokens) {
+        _lastFinishReason = finishReason;
+        _lastTotalTokens = totalTokens;
+        _lastCachedTokens = 0;
+        _lastCacheWriteTokens = 0;
+    }
+
+    // Replace only the finish reason (e.g. when a stream is ended by a local budget)
+    void setFinishReason(const String& finishReason) { _lastFinishReason = finishReason; }
+
+    // --- Prompt Caching ---
+    // Prompt tokens of the last response read from and written to the provider's prompt cache
+    int getCachedTokens() const { return _lastCachedTokens; }
+    int getCacheWriteTokens() const { return _lastCacheWriteTokens; }
+
+    // Mark the system prompt and the tool definitions as cacheable on platforms that need
+    // it (Claude); the others cache long prompt prefixes on their own. Tools are marked
+    // when buildToolsJson is called, so convert them again after changing this.
+    void setPromptCaching(bool enable) { _promptCaching = enable; }
+    bool getPromptCaching() const { return _promptCaching; }
+
+    // Send requests against a context cached on the provider ("" for none). Returns false
+    // on platforms without cached context references (all but Gemini).
+    virtual bool setCachedContent(const String& name) { return name.isEmpty(); }
+
 #ifdef ENABLE_TOOL_CALLS
     // --- Tool Calls Methods ---
     
+    // Convert the tool definitions set with setTCTools() to this platform's "tools" JSON value
+    // Called once per setTCTools()/begin(); the result is passed to the builders below as
+    // toolsJson and spliced into every request without being parsed again
+    // Returns the serialized JSON or empty string on error (errorMsg is set)
+    virtual String buildToolsJson(const String* toolsArray, int toolsArraySize, String& errorMsg) { return ""; }
+
     // Build the JSON request body for tool calls
-    // Takes user message, tools array, system message, tool choice, and a JsonDocument reference to populate
-    // Returns the serialized JSON string or empty string on error
-    virtual String buildToolCallsRequestBody(const String& modelName,
-                                       const String* toolsArray, int toolsArraySize,
+    // Takes user message, pre-converted tools JSON, system message, tool choice, and a JsonDocument reference to populate
+    // Returns true if doc was populated, false on error (the caller serializes doc)
+    virtual bool buildToolCallsRequestBody(const String& modelName,
+                                       const String& toolsJson,
                                        const String& systemMessage, const String& toolChoice,
                                        int maxTokens,
-                                       const String& userMessage, JsonDocument& doc) { return ""; }
+                                       const String& userMessage, JsonDocument& doc,
+                                       const AI_API_Chat_History* history = nullptr) { return false; }
 
     // Parse the JSON response payload for tool calls
     // Returns either the tool_calls array as JSON string (if finish_reason is "tool_calls")
@@ -79,18 +180,28 @@ public:
     // Sets the errorMsg reference if parsing fails or API returns an error object
     virtual String parseToolCallsResponseBody(const String& responsePayload,
                                         String& errorMsg, JsonDocument& doc) { return ""; }
+
+    // Stream variant of parseToolCallsResponseBody (see parseResponseStream)
+    virtual String parseToolCallsResponseStream(Stream& responseStream, String& errorMsg, JsonDocument& doc) { return ""; }
                                         
     // Build a follow-up request body with tool results
-    // Returns the serialized JSON string or empty string on error
-    virtual String buildToolCallsFollowUpRequestBody(const String& modelName,
-                                       const String* toolsArray, int toolsArraySize,
+    // Returns true if doc was populated, false on error (the caller serializes doc)
+    virtual bool buildToolCallsFollowUpRequestBody(const String& modelName,
+                                       const String& toolsJson,
                                        const String& systemMessage, const String& toolChoice,
                                        const String& lastUserMessage,
                                        const String& lastAssistantToolCallsJson,
                                        const String& toolResultsJson,
                                        int followUpMaxTokens,
                                        const String& followUpToolChoice,
-                                       JsonDocument& doc) { return ""; }
+                                       JsonDocument& doc,
+                                       const AI_API_Chat_History* history = nullptr) { return false; }
+
+    // Append one more round (the assistant's next tool calls and their results) to a body
+    // built by buildToolCallsFollowUpRequestBody, so a multi-round exchange extends the
+    // same document instead of being rebuilt. Returns false if doc holds no follow-up body.
+    virtual bool appendToolCallsRound(const String& assistantToolCallsJson,
+                                      const String& toolResultsJson, JsonDocument& doc) { return false; }
 #endif
 
 #ifdef ENABLE_STREAM_CHAT
@@ -104,18 +215,80 @@ public:
     
     // Build streaming request body (similar to buildRequestBody but with stream:true)
     // Takes user message, config params, and a JsonDocument reference to populate
-    // Returns the serialized JSON string or empty string on error
-    virtual String buildStreamRequestBody(const String& modelName, const String& systemRole,
+    // Returns true if doc was populated, false on error (the caller serializes doc)
+    virtual bool buildStreamRequestBody(const String& modelName, const String& systemRole,
                                         float temperature, int maxTokens,
                                         const String& userMessage, JsonDocument& doc,
-                                        const String& customParams = "") { return ""; }
+                                        JsonObjectConst customParams = JsonObjectConst(),
+                                        const AI_API_Chat_History* history = nullptr) { return false; }
+
+    // Called before the first chunk of a stream and after its last one.
+    // Finish reason and token counts accumulate over all chunks in between,
+    // so they describe the whole stream when it ends.
+    virtual void beginStream() {
+        resetState();
+#ifdef ENABLE_STREAM_TOOL_CALLS
+        _streamToolCallCount = 0;
+        _streamToolCallsCompleted = 0;
+#endif
+    }
+    virtual void endStream() {
+        _streamChunkDoc.clear(); // Return the pooled blocks for other streams
+    }
 
     // Process a single stream chunk and extract content
-    // Takes raw chunk data from HTTP stream
+    // Takes the payload of one SSE "data:" line as a view into the stream buffer
+    // (data is not guaranteed to be NUL-terminated, always use length)
     // Returns: extracted content from chunk, empty if no content or error
     // Sets isComplete to true if this is the final chunk
     // Sets errorMsg if there's an error processing the chunk
-    virtual String processStreamChunk(const String& rawChunk, bool& isComplete, String& errorMsg) { return ""; }
+    // Only overwrites the finish reason and token counts when the chunk carries them
+    virtual String processStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) { return ""; }
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // --- Streaming Tool Calls Methods ---
+
+    // Build a streaming tool calls request body (buildToolCallsRequestBody for streaming).
+    // The request is sent to getStreamEndpoint().
+    // Returns true if doc was populated, false on error (the caller serializes doc)
+    virtual bool buildToolCallsStreamRequestBody(const String& modelName,
+                                                 const String& toolsJson,
+                                                 const String& systemMessage, const String& toolChoice,
+                                                 int maxTokens,
+                                                 const String& userMessage, JsonDocument& doc,
+                                                 const AI_API_Chat_History* history = nullptr) { return false; }
+
+    // Process a chunk of a streaming tool calls response. Same contract as
+    // processStreamChunk (text content is returned), and tool call deltas are added to
+    // the calls of the stream: see getStreamToolCallsCompleted()
+    virtual String processToolCallsStreamChunk(const char* data, size_t length, bool& isComplete, String& errorMsg) { return ""; }
+
+    // Tool calls of the current (or last) stream: started / complete ones.
+    // Calls complete in order, so the first getStreamToolCallsCompleted() can be used.
+    size_t getStreamToolCallCount() const { return _streamToolCallCount; }
+    size_t getStreamToolCallsCompleted() const { return _streamToolCallsCompleted; }
+    const StreamToolCall& getStreamToolCall(size_t index) const { return _streamToolCalls[index]; }
+
+    // The complete tool calls of the stream in the format of parseToolCallsResponseBody,
+    // as passed to buildToolCallsFollowUpRequestBody. "" if there are none.
+    String getStreamToolCallsJson() const {
+        if (_streamToolCallsCompleted == 0) return "";
+        JsonDocument toolCallsDoc;
+        JsonArray toolCalls = toolCallsDoc.to<JsonArray>();
+        for (size_t i = 0; i < _streamToolCallsCompleted; i++) {
+            const StreamToolCall& call = _streamToolCalls[i];
+            JsonObject toolCall = toolCalls.add<JsonObject>();
+            if (!call.id.isEmpty()) toolCall["id"] = call.id;
+            toolCall["type"] = "function";
+            JsonObject function = toolCall["function"].to<JsonObject>();
+            function["name"] = call.name;
+            function["arguments"] = call.arguments.isEmpty() ? String("{}") : call.arguments;
+        }
+        String toolCallsJson;
+        serializeJson(toolCallsDoc, toolCallsJson);
+        return toolCallsJson;
+    }
 #endif
 
     // --- Optional Platform-Specific Methods ---
@@ -0,0 +1,89 @@
+// ESP32_AI_Connect/AI_API_Request_Stream.cpp
+
+#include "AI_API_Request_Stream.h"
+
+namespace {
+// Print that discards everything outside [start, start + capacity)
+class WindowPrint : public Print {
+public:
+    WindowPrint(char* buffer, size_t start, size_t capacity)
+        : _buffer(buffer), _start(start), _capacity(capacity) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    // Copy only the part of data that overlaps the window, skip the rest by offset
+    size_t write(const uint8_t* data, size_t size) override {
+        size_t end = _offset + size;
+        size_t from = _offset > _start ? _offset : _start;
+        size_t to = end < _start + _capacity ? end : _start + _capacity;
+        if (from < to) {
+            memcpy(_buffer + (from - _start), data + (from - _offset), to - from);
+            _length += to - from;
+        }
+        _offset = end;
+        return size;
+    }
+
+    size_t length() const { return _length; }
+
+private:
+    char* _buffer;
+    size_t _start;
+    size_t _capacity;
+    size_t _offset = 0;
+    size_t _length = 0;
+};
+} // namespace
+
+void AI_API_Request_Stream::begin(JsonDocument& doc) {
+    _doc = &doc;
+    _size = measureJson(doc);
+    rewind();
+}
+
+void AI_API_Request_Stream::rewind() {
+    _position = 0;
+    _windowStart = 0;
+    _windowLength = 0;
+}
+
+int AI_API_Request_Stream::available() {
+    return _size - _position;
+}
+
+int AI_API_Request_Stream::read() {
+    int c = peek();
+    if (c >= 0) _position++;
+    return c;
+}
+
+int AI_API_Request_Stream::peek() {
+    if (_position >= _size) return -1;
+    if (_position >= _windowStart + _windowLength && !_fillWindow()) return -1;
+    return (uint8_t)_window[_position - _windowStart];
+}
+
+size_t AI_API_Request_Stream::readBytes(char* buffer, size_t length) {
+    size_t copied = 0;
+    while (copied < length && _position < _size) {
+        if (_position >= _windowStart + _windowLength && !_fillWindow()) break;
+
+        size_t chunk = min(length - copied, _windowStart + _windowLength - _position);
+        memcpy(buffer + copied, _window + (_position - _windowStart), chunk);
+        copied += chunk;
+        _position += chunk;
+    }
+    return copied;
+}
+
+bool AI_API_Request_Stream::_fillWindow() {
+    if (_doc == nullptr) return false;
+
+    WindowPrint window(_window, _position, sizeof(_window));
+    serializeJson(*_doc, window);
+    _windowStart = _position;
+    _windowLength = window.length();
+    return _windowLength > 0;
+}
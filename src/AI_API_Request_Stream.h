@@ -0,0 +1,59 @@
+// ESP32_AI_Connect/AI_API_Request_Stream.h
+
+#ifndef AI_API_REQUEST_STREAM_H
+#define AI_API_REQUEST_STREAM_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Read-only Stream that produces the serialized form of a JsonDocument, used to send
+// a request body with HTTPClient::sendRequest(type, Stream*, size) instead of first
+// serializing it into one large String.
+//
+// ArduinoJson can't pause a serialization, so the document is serialized again for
+// every window of AI_API_REQUEST_WINDOW_SIZE bytes and only that window is kept.
+// A body of N bytes costs N / AI_API_REQUEST_WINDOW_SIZE passes (rounded up), so the
+// total work grows with N^2 / window: a 4 KB body takes 3 passes with the default
+// 1460-byte window (one TCP segment, what HTTPClient reads per call), a 16 KB tool round
+// 12. Bytes outside the window are skipped by offset, not copied. Raise the window for
+// large bodies if RAM allows; a few passes still cost far less than one contiguous
+// allocation the size of the whole body on a fragmented heap.
+//
+// Usage:
+//   AI_API_Request_Stream body;
+//   body.begin(doc);
+//   _httpClient.sendRequest("POST", &body, body.size());
+class AI_API_Request_Stream : public Stream {
+public:
+    AI_API_Request_Stream() {}
+
+    // Start streaming doc from its first byte; the size comes from measureJson()
+    void begin(JsonDocument& doc);
+    // Start again from the first byte (e.g. to resend the request)
+    void rewind();
+    // Total body size in bytes (the Content-Length)
+    size_t size() const { return _size; }
+
+    // Stream interface
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    JsonDocument* _doc = nullptr;
+    size_t _size = 0;
+    size_t _position = 0;       // Next body byte to return
+
+    char _window[AI_API_REQUEST_WINDOW_SIZE];
+    size_t _windowStart = 0;    // Body offset of _window[0]
+    size_t _windowLength = 0;
+
+    // Serialize the document again, keeping the bytes starting at _position
+    bool _fillWindow();
+};
+
+#endif // AI_API_REQUEST_STREAM_H
@@ -0,0 +1,219 @@
+// ESP32_AI_Connect/AI_API_Response_Cache.cpp
+
+#include "AI_API_Response_Cache.h"
+#include <new>
+
+#ifdef ENABLE_RESPONSE_CACHE // Only compile this file's content if flag is set
+
+AI_API_Response_Cache::~AI_API_Response_Cache() {
+    end();
+}
+
+bool AI_API_Response_Cache::begin(size_t maxEntries, size_t maxBytes) {
+    _releaseEntries(); // The file tier stays attached
+    if (maxEntries == 0) return true; // Cache disabled
+
+    _entries = new (std::nothrow) Entry[maxEntries];
+    if (_entries == nullptr) return false;
+
+    _maxEntries = maxEntries;
+    _maxBytes = maxBytes;
+    return true;
+}
+
+void AI_API_Response_Cache::end() {
+    _releaseEntries();
+    setStorage(nullptr, nullptr, 0);
+}
+
+void AI_API_Response_Cache::_releaseEntries() {
+    delete[] _entries;
+    _entries = nullptr;
+    _maxEntries = 0;
+    _maxBytes = 0;
+    _entryCount = 0;
+    _usedBytes = 0;
+}
+
+void AI_API_Response_Cache::setStorage(fs::FS* fs, const char* directory, size_t maxFiles) {
+    _fs = fs;
+    _directory = directory != nullptr ? directory : "";
+    while (_directory.endsWith("/")) _directory.remove(_directory.length() - 1);
+    // Every file in the directory is treated as a cache entry, so never use the root
+    if (_fs != nullptr && _directory.isEmpty()) _directory = AI_API_RESPONSE_CACHE_DIR;
+    _maxFiles = maxFiles;
+
+    if (_fs != nullptr && !_fs->exists(_directory)) {
+        _fs->mkdir(_directory);
+    }
+}
+
+uint64_t AI_API_Response_Cache::hashField(uint64_t hash, const void* data, size_t length) {
+    const uint64_t prime = 1099511628211ULL; // FNV-1a 64-bit prime
+    for (size_t i = 0; i < sizeof(length); i++) {
+        hash = (hash ^ ((length >> (i * 8)) & 0xFF)) * prime;
+    }
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+    return hash;
+}
+
+bool AI_API_Response_Cache::lookup(uint64_t key, String& content, String& finishReason) {
+    Entry* entry = _find(key);
+    if (entry != nullptr) {
+        entry->lastUsed = ++_clock;
+        content = entry->content;
+        finishReason = entry->finishReason;
+        _hits++;
+        return true;
+    }
+
+    if (_readFile(key, content, finishReason)) {
+        _storeInRam(key, content, finishReason); // Promote: the next lookup skips the file system
+        _hits++;
+        return true;
+    }
+
+    _misses++;
+    return false;
+}
+
+void AI_API_Response_Cache::store(uint64_t key, const String& content, const String& finishReason) {
+    _storeInRam(key, content, finishReason);
+    _writeFile(key, content, finishReason);
+}
+
+void AI_API_Response_Cache::clear() {
+    for (size_t i = 0; i < _maxEntries; i++) {
+        if (_entries[i].used) _evict(_entries[i]);
+    }
+    _clock = 0;
+
+    // Remove one file per directory pass: removing entries while iterating isn't
+    // reliable on every file system
+    while (_fs != nullptr) {
+        File dir = _fs->open(_directory);
+        if (!dir || !dir.isDirectory()) return;
+        File file = dir.openNextFile();
+        if (!file) return;
+        String path = file.path();
+        file.close();
+        dir.close();
+        if (!_fs->remove(path)) return;
+    }
+}
+
+AI_API_Response_Cache::Entry* AI_API_Response_Cache::_find(uint64_t key) {
+    for (size_t i = 0; i < _maxEntries; i++) {
+        if (_entries[i].used && _entries[i].key == key) return &_entries[i];
+    }
+    return nullptr;
+}
+
+void AI_API_Response_Cache::_storeInRam(uint64_t key, const String& content, const String& finishReason) {
+    if (_entries == nullptr) return;
+    size_t size = content.length() + finishReason.length();
+    if (size > _maxBytes) return; // Would never fit; the file tier may still keep it
+
+    Entry* entry = _find(key);
+    if (entry != nullptr) _evict(*entry); // Replace an older reply to the same request
+
+    // Free a slot and enough bytes, least recently used first
+    while (_entryCount == _maxEntries || _usedBytes + size > _maxBytes) {
+        Entry* oldest = nullptr;
+        for (size_t i = 0; i < _maxEntries; i++) {
+            if (_entries[i].used && (oldest == nullptr || _entries[i].lastUsed < oldest->lastUsed)) {
+                oldest = &_entries[i];
+            }
+        }
+        if (oldest == nullptr) break;
+        _evict(*oldest);
+    }
+
+    for (size_t i = 0; i < _maxEntries; i++) {
+        if (!_entries[i].used) {
+            entry = &_entries[i];
+            break;
+        }
+    }
+    if (entry == nullptr) return;
+
+    entry->key = key;
+    entry->content = content;
+    entry->finishReason = finishReason;
+    entry->lastUsed = ++_clock;
+    entry->used = true;
+    _entryCount++;
+    _usedBytes += size;
+}
+
+void AI_API_Response_Cache::_evict(Entry& entry) {
+    _usedBytes -= entry.content.length() + entry.finishReason.length();
+    _entryCount--;
+    entry.used = false;
+    entry.content = String(); // Release the buffers, not just the length
+    entry.finishReason = String();
+}
+
+String AI_API_Response_Cache::_filePath(uint64_t key) const {
+    char name[24];
+    snprintf(name, sizeof(name), "/%08lx%08lx", (unsigned long)(key >> 32), (unsigned long)(key & 0xFFFFFFFF));
+    return _directory + name;
+}
+
+bool AI_API_Response_Cache::_readFile(uint64_t key, String& content, String& finishReason) {
+    if (_fs == nullptr || _maxFiles == 0) return false;
+    String path = _filePath(key);
+    if (!_fs->exists(path)) return false;
+
+    // Layout: finish reason, '\n', content
+    File file = _fs->open(path, FILE_READ);
+    if (!file) return false;
+    finishReason = file.readStringUntil('\n');
+    content = file.readString();
+    file.close();
+    return !content.isEmpty();
+}
+
+void AI_API_Response_Cache::_writeFile(uint64_t key, const String& content, const String& finishReason) {
+    if (_fs == nullptr || _maxFiles == 0) return;
+    String path = _filePath(key);
+    if (!_fs->exists(path)) _trimFiles();
+
+    File file = _fs->open(path, FILE_WRITE);
+    if (!file) return;
+    file.print(finishReason);
+    file.print('\n');
+    file.print(content);
+    file.close();
+}
+
+void AI_API_Response_Cache::_trimFiles() {
+    while (true) {
+        File dir = _fs->open(_directory);
+        if (!dir || !dir.isDirectory()) return;
+
+        size_t count = 0;
+        String oldestPath = "";
+        time_t oldestTime = 0;
+        for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+            if (!file.isDirectory()) {
+                count++;
+                time_t written = file.getLastWrite();
+                if (oldestPath.isEmpty() || written < oldestTime) {
+                    oldestPath = file.path();
+                    oldestTime = written;
+                }
+            }
+            file.close();
+        }
+        dir.close();
+
+        if (count < _maxFiles || oldestPath.isEmpty()) return;
+        _fs->remove(oldestPath);
+    }
+}
+
+#endif // ENABLE_RESPONSE_CACHE
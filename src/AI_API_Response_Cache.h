@@ -0,0 +1,99 @@
+// ESP32_AI_Connect/AI_API_Response_Cache.h
+
+#ifndef AI_API_RESPONSE_CACHE_H
+#define AI_API_RESPONSE_CACHE_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#ifdef ENABLE_RESPONSE_CACHE // Only compile this file's content if flag is set
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Cache of chat replies, keyed on a 64-bit FNV-1a hash of everything that shapes
+// the reply (endpoint, model, system role, parameters and the message).
+//
+// The first tier is a small LRU in RAM, bounded by entry count and content bytes.
+// An optional second tier keeps one file per reply on any fs::FS (LittleFS, SPIFFS,
+// SD), so answers survive a reboot; replies found there are promoted to RAM.
+// When the file tier is full, the file written longest ago is removed.
+//
+// Usage:
+//   AI_API_Response_Cache cache;
+//   cache.begin(16, 8192);
+//   uint64_t key = AI_API_Response_Cache::hashField(AI_API_Response_Cache::HASH_SEED, message);
+//   if (!cache.lookup(key, reply, finishReason)) { ... cache.store(key, reply, finishReason); }
+class AI_API_Response_Cache {
+public:
+    static const uint64_t HASH_SEED = 14695981039346656037ULL; // FNV-1a offset basis
+
+    AI_API_Response_Cache() {}
+    ~AI_API_Response_Cache();
+
+    // Keep up to maxEntries replies totalling at most maxBytes in RAM.
+    // Existing entries are discarded. maxEntries = 0 disables the cache.
+    // Returns false if the entry table could not be allocated.
+    bool begin(size_t maxEntries, size_t maxBytes);
+    // Release the RAM tier and detach the file tier
+    void end();
+    bool isEnabled() const { return _entries != nullptr; }
+
+    // Also keep up to maxFiles replies as files in directory on fs (nullptr detaches it).
+    // The directory is created if needed and must only hold cache files.
+    void setStorage(fs::FS* fs, const char* directory, size_t maxFiles);
+
+    // Mix one field into hash. The length is mixed in too, so ("ab", "c") and
+    // ("a", "bc") give different keys.
+    static uint64_t hashField(uint64_t hash, const void* data, size_t length);
+    static uint64_t hashField(uint64_t hash, const String& value) {
+        return hashField(hash, value.c_str(), value.length());
+    }
+
+    // Find a stored reply. Counts a hit or a miss.
+    bool lookup(uint64_t key, String& content, String& finishReason);
+    // Store a reply in RAM (if it fits maxBytes) and in the file tier
+    void store(uint64_t key, const String& content, const String& finishReason);
+
+    // Remove all replies from RAM and the file tier
+    void clear();
+
+    size_t getEntryCount() const { return _entryCount; }
+    size_t getUsedBytes() const { return _usedBytes; }
+    uint32_t getHits() const { return _hits; }
+    uint32_t getMisses() const { return _misses; }
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        String content;
+        String finishReason;
+        uint32_t lastUsed = 0;  // _clock value of the last lookup or store
+        bool used = false;
+    };
+
+    Entry* _entries = nullptr;
+    size_t _maxEntries = 0;
+    size_t _maxBytes = 0;
+    size_t _entryCount = 0;
+    size_t _usedBytes = 0;
+    uint32_t _clock = 0;        // Advances on every access, orders entries for LRU
+    uint32_t _hits = 0;
+    uint32_t _misses = 0;
+
+    fs::FS* _fs = nullptr;
+    String _directory = "";
+    size_t _maxFiles = 0;
+
+    void _releaseEntries();
+    Entry* _find(uint64_t key);
+    void _storeInRam(uint64_t key, const String& content, const String& finishReason);
+    void _evict(Entry& entry);
+    String _filePath(uint64_t key) const;
+    bool _readFile(uint64_t key, String& content, String& finishReason);
+    void _writeFile(uint64_t key, const String& content, const String& finishReason);
+    // Remove the oldest files until one more fits in the file tier
+    void _trimFiles();
+};
+
+#endif // ENABLE_RESPONSE_CACHE
+#endif // AI_API_RESPONSE_CACHE_H
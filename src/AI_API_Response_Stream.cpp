@@ -0,0 +1,145 @@
+// ESP32_AI_Connect/AI_API_Response_Stream.cpp
+
+#include "AI_API_Response_Stream.h"
+
+AI_API_Response_Stream::AI_API_Response_Stream(Client& client, int contentLength, bool chunked, String* rawCapture)
+    : _client(client), _chunked(chunked), _unbounded(!chunked && contentLength < 0), _rawCapture(rawCapture) {
+    if (!_chunked && !_unbounded) {
+        _remaining = contentLength;
+        _complete = (contentLength == 0);
+    }
+    if (_rawCapture != nullptr) {
+        *_rawCapture = "";
+        if (contentLength > 0) _rawCapture->reserve(contentLength);
+    }
+}
+
+int AI_API_Response_Stream::available() {
+    if (_complete) return 0;
+    size_t pending = (_bufferLength - _bufferPos) + _client.available();
+    if (!_unbounded && pending > _remaining) pending = _remaining; // Don't count chunk framing
+    return pending;
+}
+
+int AI_API_Response_Stream::read() {
+    return _readBody(false);
+}
+
+size_t AI_API_Response_Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = _readBody(true);
+        if (c < 0) break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+int AI_API_Response_Stream::_readBody(bool wait) {
+    if (!_prepare()) return -1;
+
+    int c = _readByte(wait);
+    if (c < 0) {
+        if (_unbounded && !_client.connected()) _complete = true; // Server closed: end of body
+        return -1;
+    }
+
+    _bytesRead++;
+    if (!_unbounded) {
+        _remaining--;
+        if (_remaining == 0 && !_chunked) _complete = true;
+    }
+    if (_rawCapture != nullptr) *_rawCapture += (char)c;
+    return c;
+}
+
+int AI_API_Response_Stream::peek() {
+    if (!_prepare()) return -1;
+    if (_bufferPos == _bufferLength && !_fill(false)) return -1;
+    return _buffer[_bufferPos];
+}
+
+bool AI_API_Response_Stream::drain() {
+    while (!_complete) {
+        if (_readBody(true) < 0) break;
+    }
+    return _complete;
+}
+
+bool AI_API_Response_Stream::_prepare() {
+    if (_complete) return false;
+    if (_unbounded || _remaining > 0) return true;
+    if (!_chunked) {
+        _complete = true;
+        return false;
+    }
+    return _nextChunk();
+}
+
+bool AI_API_Response_Stream::_nextChunk() {
+    int c;
+
+    // Every chunk after the first starts with the CRLF that ended the previous one
+    if (!_firstChunk) {
+        while ((c = _readByte(true)) >= 0 && c != '\n') {}
+        if (c < 0) return false;
+    }
+    _firstChunk = false;
+
+    // Chunk header: hex size, optionally followed by ";extension", then CRLF
+    size_t size = 0;
+    bool inExtension = false;
+    while ((c = _readByte(true)) >= 0 && c != '\n') {
+        if (inExtension || c == '\r') continue;
+        if (c >= '0' && c <= '9') size = size * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') size = size * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') size = size * 16 + (c - 'A' + 10);
+        else inExtension = true; // ';' or whitespace ends the size field
+    }
+    if (c < 0) return false; // Timed out inside the header
+
+    if (size == 0) {
+        // Terminating chunk: skip optional trailer headers up to the empty line
+        size_t lineLength = 0;
+        while ((c = _readByte(true)) >= 0) {
+            if (c == '\n') {
+                if (lineLength == 0) break;
+                lineLength = 0;
+            } else if (c != '\r') {
+                lineLength++;
+            }
+        }
+        _complete = (c == '\n');
+        return false;
+    }
+
+    _remaining = size;
+    return true;
+}
+
+int AI_API_Response_Stream::_readByte(bool wait) {
+    if (_bufferPos == _bufferLength && !_fill(wait)) return -1;
+    return _buffer[_bufferPos++];
+}
+
+bool AI_API_Response_Stream::_fill(bool wait) {
+    unsigned long start = millis();
+    do {
+        int available = _client.available();
+        if (available > 0) {
+            size_t toRead = min((size_t)available, sizeof(_buffer));
+            // Never read past Content-Length: the next response on a kept-alive socket follows it
+            if (!_chunked && !_unbounded) toRead = min(toRead, _remaining);
+            int bytesRead = _client.read(_buffer, toRead);
+            if (bytesRead > 0) {
+                _bufferPos = 0;
+                _bufferLength = bytesRead;
+                return true;
+            }
+        } else if (!_client.connected()) {
+            return false;
+        }
+        if (wait) delay(1); // Yield while the next TLS record arrives
+    } while (wait && millis() - start < _timeout);
+    return false;
+}
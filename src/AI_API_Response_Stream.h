@@ -0,0 +1,76 @@
+// ESP32_AI_Connect/AI_API_Response_Stream.h
+
+#ifndef AI_API_RESPONSE_STREAM_H
+#define AI_API_RESPONSE_STREAM_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Read-only Stream over an HTTP response body, used to deserialize a response
+// directly from the socket instead of buffering it with HTTPClient::getString().
+//
+// HTTPClient::getStreamPtr() returns the raw socket, so this class removes the
+// "Transfer-Encoding: chunked" framing when present and stops at Content-Length
+// otherwise. Optionally every body byte is also appended to a capture String.
+//
+// Usage:
+//   AI_API_Response_Stream body(*_httpClient.getStreamPtr(), _httpClient.getSize(), chunked);
+//   deserializeJson(doc, body);
+//   bool reusable = body.drain();
+class AI_API_Response_Stream : public Stream {
+public:
+    // contentLength: value of Content-Length, or -1 if unknown (read until the server closes)
+    // chunked: true if the response uses chunked transfer encoding
+    // rawCapture: optional String that receives a copy of the body
+    AI_API_Response_Stream(Client& client, int contentLength, bool chunked, String* rawCapture = nullptr);
+
+    // Stream interface (body bytes only). read() and peek() never wait; readBytes(), which
+    // ArduinoJson reads through, waits up to the stream timeout for the next bytes, yielding
+    // instead of spinning on read() the way Stream::timedRead() does.
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    using Stream::readBytes;
+    size_t write(uint8_t) override { return 0; }
+
+    // Consume the rest of the body so the connection can carry another request.
+    // Returns true if the body was read to its end.
+    bool drain();
+
+    // True once the last body byte (or the terminating chunk) has been read
+    bool isComplete() const { return _complete; }
+
+    // Number of body bytes read so far
+    size_t bytesRead() const { return _bytesRead; }
+
+private:
+    Client& _client;
+    bool _chunked;
+    bool _unbounded;        // No Content-Length and not chunked: body ends when the socket closes
+    bool _complete = false;
+    bool _firstChunk = true;
+    size_t _remaining = 0;  // Bytes left in the current chunk (or in the whole body)
+    size_t _bytesRead = 0;
+    String* _rawCapture;
+
+    // Small read-ahead buffer: avoids one TLS read call per byte
+    uint8_t _buffer[128];
+    size_t _bufferLength = 0;
+    size_t _bufferPos = 0;
+
+    // Make sure at least one body byte is pending. Returns false at the end of the body.
+    bool _prepare();
+    // Read the next chunk header; returns false on the terminating chunk or an error
+    bool _nextChunk();
+    // Read one body byte, optionally waiting up to the stream timeout; -1 at the end or on timeout
+    int _readBody(bool wait);
+    // Read one byte from the socket, optionally waiting up to the stream timeout
+    int _readByte(bool wait);
+    // Refill the read-ahead buffer from the socket
+    bool _fill(bool wait);
+};
+
+#endif // AI_API_RESPONSE_STREAM_H
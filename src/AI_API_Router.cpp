@@ -0,0 +1,437 @@
+// ESP32_AI_Connect/AI_API_Router.cpp
+
+#include "AI_API_Router.h"
+
+AI_API_Router::AI_API_Router() {
+    _mutex = xSemaphoreCreateMutex();
+#ifdef ENABLE_ASYNC_CHAT
+    _hedgeSignal = xSemaphoreCreateBinary();
+#endif
+}
+
+AI_API_Router::~AI_API_Router() {
+    // Deleting an instance waits for its running async request, whose callback still
+    // uses the semaphores, so they go last
+    for (size_t i = 0; i < _targetCount; i++) {
+        delete _targets[i].ai;
+        _targets[i].ai = nullptr;
+    }
+    _targetCount = 0;
+#ifdef ENABLE_ASYNC_CHAT
+    if (_hedgeSignal != nullptr) { vSemaphoreDelete(_hedgeSignal); _hedgeSignal = nullptr; }
+#endif
+    if (_mutex != nullptr) { vSemaphoreDelete(_mutex); _mutex = nullptr; }
+}
+
+int AI_API_Router::addTarget(const char* platformIdentifier, const char* apiKey, const char* modelName,
+                             const char* endpointUrl) {
+    if (_targetCount >= AI_API_ROUTER_MAX_TARGETS) {
+        _lastError = "Too many targets (AI_API_ROUTER_MAX_TARGETS = " + String(AI_API_ROUTER_MAX_TARGETS) + ")";
+        return -1;
+    }
+    ESP32_AI_Connect* ai = endpointUrl != nullptr
+        ? new ESP32_AI_Connect(platformIdentifier, apiKey, modelName, endpointUrl)
+        : new ESP32_AI_Connect(platformIdentifier, apiKey, modelName);
+
+    _targets[_targetCount] = Target();
+    _targets[_targetCount].ai = ai;
+    return _targetCount++;
+}
+
+ESP32_AI_Connect* AI_API_Router::getTarget(size_t index) const {
+    return index < _targetCount ? _targets[index].ai : nullptr;
+}
+
+void AI_API_Router::setHealthPolicy(uint8_t failureThreshold, uint32_t cooldownMs) {
+    _failureThreshold = failureThreshold > 0 ? failureThreshold : 1;
+    _cooldownMs = cooldownMs;
+}
+
+AI_API_Router::TargetStats AI_API_Router::getTargetStats(size_t index) const {
+    TargetStats stats;
+    if (index >= _targetCount) return stats;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    stats = _targets[index].stats;
+    xSemaphoreGive(_mutex);
+    return stats;
+}
+
+void AI_API_Router::resetHealth() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < _targetCount; i++) {
+        _targets[i].stats = TargetStats();
+        _targets[i].unhealthySince = 0;
+    }
+    xSemaphoreGive(_mutex);
+}
+
+String AI_API_Router::chat(const String& userMessage) {
+    _lastTarget = -1;
+    _lastHedged = false;
+    _lastError = "";
+
+    uint8_t order[AI_API_ROUTER_MAX_TARGETS];
+    size_t count = _candidates(order);
+    if (count == 0) {
+        _lastError = _targetCount == 0 ? "No targets added" : "All targets are busy";
+        return "";
+    }
+
+#ifdef ENABLE_ASYNC_CHAT
+    if (_hedgeDelayMs > 0 && count > 1) {
+        return _chatHedged(userMessage, order, count);
+    }
+#endif
+    return _chatFailover(userMessage, order, count);
+}
+
+#ifdef ENABLE_STREAM_CHAT
+bool AI_API_Router::streamChat(const String& userMessage, ESP32_AI_Connect::StreamCallback callback) {
+    _lastTarget = -1;
+    _lastHedged = false;
+    _lastError = "";
+
+    if (!callback) {
+        _lastError = "Callback function is null";
+        return false;
+    }
+
+    uint8_t order[AI_API_ROUTER_MAX_TARGETS];
+    size_t count = _candidates(order);
+    if (count == 0) {
+        _lastError = _targetCount == 0 ? "No targets added" : "All targets are busy";
+        return false;
+    }
+
+#ifdef ENABLE_ASYNC_CHAT
+    if (_hedgeDelayMs > 0 && count > 1) {
+        return _streamHedged(userMessage, callback, order, count);
+    }
+#endif
+    return _streamFailover(userMessage, callback, order, count);
+}
+#endif
+
+size_t AI_API_Router::_candidates(uint8_t* order) {
+    bool available[AI_API_ROUTER_MAX_TARGETS];
+    uint32_t now = millis();
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < _targetCount; i++) {
+        // After the cooldown an unhealthy target is tried again; one success makes it healthy
+        available[i] = _targets[i].stats.healthy || now - _targets[i].unhealthySince >= _cooldownMs;
+    }
+    xSemaphoreGive(_mutex);
+
+    size_t count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < _targetCount; i++) {
+            if (available[i] != (pass == 0)) continue;
+#ifdef ENABLE_ASYNC_CHAT
+            if (_targets[i].ai->isAsyncBusy()) continue; // Still finishing a hedged request
+#endif
+            order[count++] = i;
+        }
+    }
+    return count;
+}
+
+void AI_API_Router::_record(size_t index, bool success, uint32_t latencyMs) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Target& target = _targets[index];
+    if (success) {
+        target.stats.successes++;
+        target.stats.consecutiveFailures = 0;
+        target.stats.healthy = true;
+        target.stats.lastLatencyMs = latencyMs;
+        target.stats.avgLatencyMs = target.stats.avgLatencyMs == 0
+            ? latencyMs : (target.stats.avgLatencyMs * 3 + latencyMs) / 4;
+    } else {
+        target.stats.failures++;
+        if (target.stats.consecutiveFailures < 255) target.stats.consecutiveFailures++;
+        if (target.stats.consecutiveFailures >= _failureThreshold) {
+            target.stats.healthy = false;
+            target.unhealthySince = millis(); // A failed retry after the cooldown restarts it
+        }
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void AI_API_Router::_addError(size_t index, const String& error) {
+    if (!_lastError.isEmpty()) _lastError += "; ";
+    _lastError += "Target " + String(index) + ": " + error;
+}
+
+String AI_API_Router::_chatFailover(const String& userMessage, const uint8_t* order, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        size_t index = order[k];
+        ESP32_AI_Connect* ai = _targets[index].ai;
+
+        uint32_t start = millis();
+        String reply = ai->chat(userMessage);
+        bool success = !reply.isEmpty();
+        _record(index, success, millis() - start);
+
+        if (success) {
+            _lastTarget = index;
+            _lastError = "";
+            return reply;
+        }
+        _addError(index, ai->getLastError());
+    }
+    return "";
+}
+
+#ifdef ENABLE_STREAM_CHAT
+bool AI_API_Router::_streamFailover(const String& userMessage, ESP32_AI_Connect::StreamCallback callback,
+                                    const uint8_t* order, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        size_t index = order[k];
+        ESP32_AI_Connect* ai = _targets[index].ai;
+
+        uint32_t start = millis();
+        uint32_t firstChunkMs = 0;
+        bool delivered = false;
+        auto forward = [&](const ESP32_AI_Connect::StreamChunkInfo& info) -> bool {
+            if (!delivered && !info.content.isEmpty()) {
+                delivered = true;
+                firstChunkMs = millis() - start;
+            }
+            return callback(info);
+        };
+
+        bool success = ai->streamChat(userMessage, forward);
+        _record(index, success, delivered ? firstChunkMs : millis() - start);
+
+        if (success) {
+            _lastTarget = index;
+            _lastError = "";
+            return true;
+        }
+        _addError(index, ai->getLastError());
+        if (delivered) return false; // Failed mid-stream: too late to switch targets
+    }
+    return false;
+}
+#endif
+
+#ifdef ENABLE_ASYNC_CHAT
+uint32_t AI_API_Router::_beginHedge() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    uint32_t generation = ++_hedge.generation;
+    _hedge = Hedge();
+    _hedge.generation = generation;
+    xSemaphoreGive(_mutex);
+    xSemaphoreTake(_hedgeSignal, 0); // Drop a signal left by an older request
+    return generation;
+}
+
+bool AI_API_Router::_waitHedge(uint32_t waitMs) {
+    TickType_t ticks = waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+    return xSemaphoreTake(_hedgeSignal, ticks) == pdTRUE;
+}
+
+bool AI_API_Router::_launchChat(uint32_t generation, size_t index, const String& userMessage) {
+    ESP32_AI_Connect* ai = _targets[index].ai;
+    uint32_t start = millis();
+    uint32_t requestId = ai->chatAsync(userMessage, [this, generation, index, start](const ESP32_AI_Connect::AsyncResult& result) {
+        _record(index, result.success, millis() - start);
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        if (generation == _hedge.generation) {
+            if (result.success && _hedge.winner < 0) {
+                _hedge.winner = index;
+                _hedge.reply = result.content;
+            } else if (!result.success) {
+                _hedge.failed++;
+                if (!_hedge.error.isEmpty()) _hedge.error += "; ";
+                _hedge.error += "Target " + String(index) + ": " + result.errorMsg;
+            }
+        }
+        xSemaphoreGive(_mutex);
+        xSemaphoreGive(_hedgeSignal);
+    });
+
+    if (requestId == 0) {
+        _addError(index, ai->getLastError());
+        return false;
+    }
+    return true;
+}
+
+String AI_API_Router::_chatHedged(const String& userMessage, const uint8_t* order, size_t count) {
+    uint32_t generation = _beginHedge();
+    size_t next = 0;
+    uint8_t launched = 0;
+    uint32_t launchedAt = millis();
+
+    while (true) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        int winner = _hedge.winner;
+        uint8_t failed = _hedge.failed;
+        xSemaphoreGive(_mutex);
+
+        if (winner >= 0) break;
+
+        if (failed >= launched) {
+            // Nothing in flight (first launch, or every request failed): fail over
+            if (next >= count) break;
+            if (_launchChat(generation, order[next++], userMessage)) {
+                launched++;
+                launchedAt = millis();
+            }
+            continue;
+        }
+
+        // One request in flight: hedge with the next target once the delay has passed
+        bool canHedge = next < count && launched - failed < 2;
+        uint32_t elapsed = millis() - launchedAt;
+        if (canHedge && elapsed >= _hedgeDelayMs) {
+            if (_launchChat(generation, order[next++], userMessage)) {
+                launched++;
+                launchedAt = millis();
+                _lastHedged = true;
+            }
+            continue;
+        }
+        _waitHedge(canHedge ? _hedgeDelayMs - elapsed : UINT32_MAX);
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    int winner = _hedge.winner;
+    String reply = _hedge.reply;
+    String error = _hedge.error;
+    xSemaphoreGive(_mutex);
+
+    if (winner < 0) {
+        if (!error.isEmpty()) {
+            if (!_lastError.isEmpty()) _lastError += "; ";
+            _lastError += error;
+        }
+        return "";
+    }
+    _lastTarget = winner;
+    _lastError = "";
+    return reply;
+}
+
+#ifdef ENABLE_STREAM_CHAT
+bool AI_API_Router::_launchStream(uint32_t generation, size_t index, const String& userMessage,
+                                  ESP32_AI_Connect::StreamCallback callback) {
+    ESP32_AI_Connect* ai = _targets[index].ai;
+    uint32_t start = millis();
+
+    // The first target to deliver content wins; the others stop at their first chunk
+    auto onChunk = [this, generation, index, callback, start](const ESP32_AI_Connect::StreamChunkInfo& info) -> bool {
+        bool first = false;
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool current = generation == _hedge.generation;
+        if (current && _hedge.winner < 0 && (!info.content.isEmpty() || info.isComplete)) {
+            _hedge.winner = index;
+            _hedge.firstChunkMs = millis() - start; // Recorded when the stream is done
+            first = true;
+        }
+        bool mine = current && _hedge.winner == (int)index;
+        xSemaphoreGive(_mutex);
+
+        if (first) xSemaphoreGive(_hedgeSignal);
+        if (!mine) return false;
+        return callback(info);
+    };
+
+    auto onDone = [this, generation, index, start](const ESP32_AI_Connect::AsyncResult& result) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        bool current = generation == _hedge.generation;
+        bool won = current && _hedge.winner == (int)index;
+        uint32_t latencyMs = won ? _hedge.firstChunkMs : millis() - start;
+        if (won) {
+            _hedge.finished = true;
+            _hedge.success = result.success;
+            if (!result.success) _hedge.error = "Target " + String(index) + ": " + result.errorMsg;
+        } else if (current && _hedge.winner < 0 && !result.success) {
+            _hedge.failed++;
+            if (!_hedge.error.isEmpty()) _hedge.error += "; ";
+            _hedge.error += "Target " + String(index) + ": " + result.errorMsg;
+        }
+        xSemaphoreGive(_mutex);
+
+        // A request stopped because it lost the race says nothing about its target
+        if (won || !result.success) _record(index, result.success, latencyMs);
+        xSemaphoreGive(_hedgeSignal);
+    };
+
+    if (ai->streamChatAsync(userMessage, onChunk, onDone) == 0) {
+        _addError(index, ai->getLastError());
+        return false;
+    }
+    return true;
+}
+
+bool AI_API_Router::_streamHedged(const String& userMessage, ESP32_AI_Connect::StreamCallback callback,
+                                  const uint8_t* order, size_t count) {
+    uint32_t generation = _beginHedge();
+    size_t next = 0;
+    uint8_t launched = 0;
+    uint8_t launchedTargets[AI_API_ROUTER_MAX_TARGETS];
+    uint32_t launchedAt = millis();
+    bool othersStopped = false;
+
+    while (true) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        int winner = _hedge.winner;
+        bool finished = _hedge.finished;
+        uint8_t failed = _hedge.failed;
+        xSemaphoreGive(_mutex);
+
+        if (winner >= 0) {
+            if (!othersStopped) {
+                for (uint8_t i = 0; i < launched; i++) {
+                    if (launchedTargets[i] != winner) _targets[launchedTargets[i]].ai->stopStreaming();
+                }
+                othersStopped = true;
+            }
+            if (finished) break;
+            _waitHedge(UINT32_MAX); // The winner streams until done
+            continue;
+        }
+
+        if (failed >= launched) {
+            if (next >= count) break;
+            size_t index = order[next++];
+            if (_launchStream(generation, index, userMessage, callback)) {
+                launchedTargets[launched++] = index;
+                launchedAt = millis();
+            }
+            continue;
+        }
+
+        // No first chunk yet: hedge with the next target once the delay has passed
+        bool canHedge = next < count && launched - failed < 2;
+        uint32_t elapsed = millis() - launchedAt;
+        if (canHedge && elapsed >= _hedgeDelayMs) {
+            size_t index = order[next++];
+            if (_launchStream(generation, index, userMessage, callback)) {
+                launchedTargets[launched++] = index;
+                launchedAt = millis();
+                _lastHedged = true;
+            }
+            continue;
+        }
+        _waitHedge(canHedge ? _hedgeDelayMs - elapsed : UINT32_MAX);
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    int winner = _hedge.winner;
+    bool success = _hedge.success;
+    String error = _hedge.error;
+    xSemaphoreGive(_mutex);
+
+    if (!error.isEmpty()) {
+        if (!_lastError.isEmpty()) _lastError += "; ";
+        _lastError += error;
+    }
+    _lastTarget = winner;
+    if (winner >= 0 && success) _lastError = "";
+    return winner >= 0 && success;
+}
+#endif // ENABLE_STREAM_CHAT
+#endif // ENABLE_ASYNC_CHAT
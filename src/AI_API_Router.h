@@ -0,0 +1,143 @@
+// ESP32_AI_Connect/AI_API_Router.h
+
+#ifndef AI_API_ROUTER_H
+#define AI_API_ROUTER_H
+
+#include "ESP32_AI_Connect.h"
+
+// Routes requests over an ordered list of targets (platform, model, key, endpoint),
+// failing over to the next target when one returns an error or times out.
+//
+// Each target is its own ESP32_AI_Connect instance, created once by addTarget(), so
+// switching providers never recreates a handler. Use getTarget() to configure one
+// (system role, temperature, connection reuse, retry policy...).
+//
+// Health: a target that failed failureThreshold times in a row is skipped for
+// cooldownMs, then tried again with the next request. If every target is cooling
+// down they are still tried, in order.
+//
+// Hedging (needs ENABLE_ASYNC_CHAT): with a hedge delay set, a request that has not
+// produced its reply (chat) or first chunk (streamChat) after hedgeDelayMs is also
+// sent to the next target, and the first one to answer wins. The other request is
+// stopped (streaming) or left to finish in the background; its target is skipped
+// until then. Hedged requests run on the targets' async worker tasks, so the
+// streamChat() callback is called from a worker task.
+//
+// Usage:
+//   AI_API_Router router;
+//   router.addTarget("openai", openaiKey, "gpt-4.1-mini");
+//   router.addTarget("claude", claudeKey, "claude-3-5-haiku-20241022");
+//   router.setHedgeDelay(3000);
+//   String reply = router.chat("Hello");   // router.getLastTargetIndex(): who answered
+class AI_API_Router {
+public:
+    struct TargetStats {
+        uint32_t successes = 0;
+        uint32_t failures = 0;
+        uint8_t consecutiveFailures = 0;
+        uint32_t lastLatencyMs = 0;   // Last successful request: time to the reply (first chunk when streaming)
+        uint32_t avgLatencyMs = 0;    // Moving average over successful requests
+        bool healthy = true;          // False while cooling down after repeated failures
+    };
+
+    AI_API_Router();
+    ~AI_API_Router();
+
+    // Add a target; targets are tried in the order they were added.
+    // Returns its index, or -1 if AI_API_ROUTER_MAX_TARGETS targets exist already.
+    int addTarget(const char* platformIdentifier, const char* apiKey, const char* modelName,
+                  const char* endpointUrl = nullptr);
+    size_t getTargetCount() const { return _targetCount; }
+    // The instance behind a target, for its settings (nullptr if index is out of range)
+    ESP32_AI_Connect* getTarget(size_t index) const;
+
+    // Skip a target for cooldownMs after failureThreshold consecutive failures
+    void setHealthPolicy(uint8_t failureThreshold, uint32_t cooldownMs);
+    TargetStats getTargetStats(size_t index) const;
+    // Mark every target healthy again and clear the statistics
+    void resetHealth();
+
+#ifdef ENABLE_ASYNC_CHAT
+    // Send a request to a second target too if the first has not answered after
+    // hedgeDelayMs. 0 disables hedging (the default).
+    void setHedgeDelay(uint32_t hedgeDelayMs) { _hedgeDelayMs = hedgeDelayMs; }
+    uint32_t getHedgeDelay() const { return _hedgeDelayMs; }
+#endif
+
+    // Send userMessage to the first available target, failing over on errors.
+    // Returns the reply, or "" if every target failed (see getLastError()).
+    String chat(const String& userMessage);
+#ifdef ENABLE_STREAM_CHAT
+    // Same for streaming. A target is only failed over before its first chunk:
+    // content already passed to the callback can't be taken back.
+    bool streamChat(const String& userMessage, ESP32_AI_Connect::StreamCallback callback);
+#endif
+
+    // Target that answered the last request, -1 if none did
+    int getLastTargetIndex() const { return _lastTarget; }
+    // True if the last request was sent to a second target by hedging
+    bool getLastRequestHedged() const { return _lastHedged; }
+    // Errors of the targets tried by the last request, "" on success
+    String getLastError() const { return _lastError; }
+
+private:
+    struct Target {
+        ESP32_AI_Connect* ai = nullptr;
+        TargetStats stats;
+        uint32_t unhealthySince = 0;  // millis() of the failure that made it unhealthy
+    };
+
+    Target _targets[AI_API_ROUTER_MAX_TARGETS];
+    size_t _targetCount = 0;
+    uint8_t _failureThreshold = AI_API_ROUTER_FAILURE_THRESHOLD;
+    uint32_t _cooldownMs = AI_API_ROUTER_COOLDOWN_MS;
+    SemaphoreHandle_t _mutex = nullptr; // Protects the statistics (hedged requests update them from worker tasks)
+
+    int _lastTarget = -1;
+    bool _lastHedged = false;
+    String _lastError = "";
+
+    // Targets to try, in order: available ones first, then cooling-down ones.
+    // Targets still busy with an earlier hedged request are left out.
+    size_t _candidates(uint8_t* order);
+    void _record(size_t index, bool success, uint32_t latencyMs);
+    void _addError(size_t index, const String& error);
+
+    String _chatFailover(const String& userMessage, const uint8_t* order, size_t count);
+#ifdef ENABLE_STREAM_CHAT
+    bool _streamFailover(const String& userMessage, ESP32_AI_Connect::StreamCallback callback,
+                         const uint8_t* order, size_t count);
+#endif
+
+#ifdef ENABLE_ASYNC_CHAT
+    uint32_t _hedgeDelayMs = 0;
+
+    // State of the hedged request in flight; callbacks of older requests are ignored by generation
+    struct Hedge {
+        uint32_t generation = 0;
+        int winner = -1;          // First target to answer
+        bool finished = false;    // Winner's request is done (streaming)
+        bool success = false;
+        String reply;             // Winner's reply (chat)
+        uint32_t firstChunkMs = 0; // Winner's time to its first chunk (streaming)
+        String error;
+        uint8_t failed = 0;       // Launched requests that failed before a winner was found
+    };
+    Hedge _hedge;
+    SemaphoreHandle_t _hedgeSignal = nullptr; // Given by the callbacks of the request in flight
+
+    uint32_t _beginHedge();
+    // Wait for the next callback of the hedged request; false when waitMs passed without one
+    bool _waitHedge(uint32_t waitMs);
+    String _chatHedged(const String& userMessage, const uint8_t* order, size_t count);
+    bool _launchChat(uint32_t generation, size_t index, const String& userMessage);
+#ifdef ENABLE_STREAM_CHAT
+    bool _streamHedged(const String& userMessage, ESP32_AI_Connect::StreamCallback callback,
+                       const uint8_t* order, size_t count);
+    bool _launchStream(uint32_t generation, size_t index, const String& userMessage,
+                       ESP32_AI_Connect::StreamCallback callback);
+#endif
+#endif
+};
+
+#endif // AI_API_ROUTER_H
@@ -0,0 +1,106 @@
+// ESP32_AI_Connect/AI_API_SSE_Reader.cpp
+
+#include "AI_API_SSE_Reader.h"
+
+#ifdef ENABLE_STREAM_CHAT // Only compile this file's content if flag is set
+
+AI_API_SSE_Reader::~AI_API_SSE_Reader() {
+    end();
+}
+
+bool AI_API_SSE_Reader::begin() {
+    if (_buffer == nullptr) {
+        _buffer = (char*)malloc(STREAM_CHAT_CHUNK_SIZE + 1); // +1 for the terminating NUL
+    }
+    _length = 0;
+    _consumed = 0;
+    _overflow = "";
+    _overflowLine = false;
+    return _buffer != nullptr;
+}
+
+void AI_API_SSE_Reader::end() {
+    free(_buffer);
+    _buffer = nullptr;
+    _length = 0;
+    _consumed = 0;
+    _overflow = "";
+    _overflowLine = false;
+}
+
+size_t AI_API_SSE_Reader::fill(Client& client) {
+    if (_buffer == nullptr) return 0;
+
+    // Move the unconsumed tail to the front of the buffer
+    if (_consumed > 0) {
+        memmove(_buffer, _buffer + _consumed, _length - _consumed);
+        _length -= _consumed;
+        _consumed = 0;
+    }
+
+    // A full buffer without a newline: the line is longer than the buffer, spill it
+    if (_length == STREAM_CHAT_CHUNK_SIZE) {
+        _overflow.concat(_buffer, _length);
+        _length = 0;
+    }
+
+    int available = client.available();
+    if (available <= 0) return 0;
+
+    size_t toRead = min((size_t)available, (size_t)(STREAM_CHAT_CHUNK_SIZE - _length));
+    int bytesRead = client.read((uint8_t*)(_buffer + _length), toRead);
+    if (bytesRead <= 0) return 0;
+
+    _length += bytesRead;
+    return bytesRead;
+}
+
+bool AI_API_SSE_Reader::nextLine(const char*& line, size_t& lineLength) {
+    if (_buffer == nullptr) return false;
+
+    // The previously returned line was spilled; it is no longer needed
+    if (_overflowLine) {
+        _overflow = "";
+        _overflowLine = false;
+    }
+
+    char* start = _buffer + _consumed;
+    char* newline = (char*)memchr(start, '\n', _length - _consumed);
+    if (newline == nullptr) return false;
+
+    size_t length = newline - start;
+    if (length > 0 && start[length - 1] == '\r') length--;
+    start[length] = '\0'; // Terminate in place so the view can be used as a C string
+    _consumed = (newline - _buffer) + 1;
+
+    if (_overflow.length() > 0) {
+        // Complete a line that started in earlier fills
+        _overflow.concat(start, length);
+        if (_overflow.length() > 0 && _overflow[_overflow.length() - 1] == '\r') {
+            _overflow.remove(_overflow.length() - 1);
+        }
+        _overflowLine = true;
+        line = _overflow.c_str();
+        lineLength = _overflow.length();
+        return true;
+    }
+
+    line = start;
+    lineLength = length;
+    return true;
+}
+
+const char* AI_API_SSE_Reader::dataPayload(const char* line, size_t lineLength, size_t& payloadLength) {
+    payloadLength = 0;
+    if (lineLength < 5 || strncmp(line, "data:", 5) != 0) return nullptr;
+
+    const char* payload = line + 5;
+    const char* end = line + lineLength;
+    while (payload < end && isspace((unsigned char)*payload)) payload++;
+    while (end > payload && isspace((unsigned char)end[-1])) end--;
+
+    payloadLength = end - payload;
+    return payload;
+}
+
+#endif // ENABLE_STREAM_CHAT
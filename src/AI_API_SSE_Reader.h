@@ -0,0 +1,61 @@
+// ESP32_AI_Connect/AI_API_SSE_Reader.h
+
+#ifndef AI_API_SSE_READER_H
+#define AI_API_SSE_READER_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#ifdef ENABLE_STREAM_CHAT // Only compile this file's content if flag is set
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Incremental Server-Sent Events (SSE) line reader shared by all streaming handlers.
+//
+// Socket data is read into one fixed buffer of STREAM_CHAT_CHUNK_SIZE bytes and
+// complete lines are handed out as NUL-terminated views into that buffer, so no
+// heap allocation happens per line. A line longer than the buffer is spilled into
+// a String instead of being truncated.
+//
+// Usage:
+//   reader.begin();
+//   while (...) {
+//       if (reader.nextLine(line, lineLength)) { ... }
+//       else if (reader.fill(client) == 0) { wait }
+//   }
+//   reader.end();
+class AI_API_SSE_Reader {
+public:
+    AI_API_SSE_Reader() {}
+    ~AI_API_SSE_Reader();
+
+    // Allocate the line buffer and discard any previous data. Returns false if out of memory.
+    bool begin();
+
+    // Release the line buffer
+    void end();
+
+    // Read the bytes currently available from client into the buffer (never blocks).
+    // Returns the number of bytes read. Call only after nextLine() returned false.
+    size_t fill(Client& client);
+
+    // Get the next complete line (without the trailing "\r\n").
+    // The view stays valid until the next call to nextLine(), fill() or end().
+    // Returns false if no complete line is buffered yet.
+    bool nextLine(const char*& line, size_t& lineLength);
+
+    // If line is an SSE "data:" field, returns a pointer to its payload (leading and
+    // trailing whitespace removed) and sets payloadLength. Returns nullptr otherwise
+    // (event:, id:, comments, blank lines).
+    static const char* dataPayload(const char* line, size_t lineLength, size_t& payloadLength);
+
+private:
+    char* _buffer = nullptr;
+    size_t _length = 0;     // Bytes stored in the buffer
+    size_t _consumed = 0;   // Bytes already handed out as lines
+    String _overflow = "";  // Spill area for lines longer than the buffer
+    bool _overflowLine = false; // Last returned line lives in _overflow
+};
+
+#endif // ENABLE_STREAM_CHAT
+#endif // AI_API_SSE_READER_H
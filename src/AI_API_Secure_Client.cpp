@@ -0,0 +1,66 @@
+// ESP32_AI_Connect/AI_API_Secure_Client.cpp
+
+#include "AI_API_Secure_Client.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+bool AI_API_Secure_Client::waitForData(uint32_t timeoutMs) {
+    // Records already decrypted or buffered by mbedTLS are not visible to select()
+    if (available() > 0) return true;
+
+    int fd = _socketFd();
+    if (fd < 0) {
+        delay(timeoutMs < 10 ? timeoutMs : 10); // No socket to wait on: fall back to polling
+        return available() > 0;
+    }
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+
+    return select(fd + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+}
+
+int AI_API_Secure_Client::connect(const char* host, uint16_t port, int32_t timeout) {
+    uint32_t start = millis();
+    IPAddress address;
+    bool resolved = WiFi.hostByName(host, address) == 1;
+    uint32_t resolvedAt = millis();
+    _timing.dnsMs += resolvedAt - start;
+    if (!resolved) return 0;
+
+    // Connect by name: the certificate is checked against it (SNI)
+    int result = WiFiClientSecure::connect(host, port, timeout);
+    _timing.connectMs += millis() - resolvedAt;
+    return result;
+}
+
+int AI_API_Secure_Client::read(uint8_t* buf, size_t size) {
+    int result = WiFiClientSecure::read(buf, size);
+    if (result > 0) {
+        if (_timing.requestSent && !_timing.responseStarted) {
+            _timing.responseStarted = true;
+            _timing.firstByteAt = millis();
+        }
+        _timing.bytesRead += result;
+    }
+    return result;
+}
+
+size_t AI_API_Secure_Client::write(const uint8_t* buf, size_t size) {
+    if (!_timing.requestSent) {
+        _timing.requestSent = true;
+        _timing.requestSentAt = millis();
+    }
+    size_t result = WiFiClientSecure::write(buf, size);
+    _timing.bytesWritten += result;
+    return result;
+}
+
+int AI_API_Secure_Client::_socketFd() const {
+    // sslclient is a raw pointer in core 2.x and a shared_ptr in core 3.x
+    return sslclient ? sslclient->socket : -1;
+}
@@ -0,0 +1,61 @@
+// ESP32_AI_Connect/AI_API_Secure_Client.h
+
+#ifndef AI_API_SECURE_CLIENT_H
+#define AI_API_SECURE_CLIENT_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+// WiFiClientSecure that can block until the socket has data, instead of polling
+// available() with delay(). The calling task sleeps in lwIP select() and wakes as soon
+// as a TLS record arrives (or the deadline passes), which lets the CPU idle between
+// stream chunks.
+//
+// It also times the connection setup and counts the bytes passing through it, for
+// ESP32_AI_Connect::getLastRequestMetrics().
+class AI_API_Secure_Client : public WiFiClientSecure {
+public:
+    // Connection timing and traffic since resetTiming()
+    struct Timing {
+        uint32_t dnsMs = 0;          // Host name lookups
+        uint32_t connectMs = 0;      // TCP connects and TLS handshakes (done in one call by WiFiClientSecure)
+        uint32_t bytesWritten = 0;   // Plaintext bytes, HTTP headers included
+        uint32_t bytesRead = 0;
+        bool requestSent = false;    // A write happened since markRequest()
+        bool responseStarted = false; // A read happened after that write
+        uint32_t requestSentAt = 0;  // millis() of the first write since markRequest()
+        uint32_t firstByteAt = 0;    // millis() of the first read after it
+    };
+
+    // Wait up to timeoutMs for readable data. Returns true if data is available now
+    // or the socket became readable (which includes the peer closing it); the caller
+    // still checks available()/connected(). Returns false on timeout.
+    bool waitForData(uint32_t timeoutMs);
+
+    // Clear all timing and counters
+    void resetTiming() { _timing = Timing(); }
+    // Start timing a new request attempt (time to first byte); counters keep running
+    void markRequest() { _timing.requestSent = false; _timing.responseStarted = false; }
+    const Timing& getTiming() const { return _timing; }
+
+    // Resolves the host first so the lookup and the handshake are timed separately
+    // (lwIP caches the address, so the lookup done by WiFiClientSecure is immediate).
+    // HTTPClient connects through this overload.
+    int connect(const char* host, uint16_t port, int32_t timeout) override;
+    using WiFiClientSecure::connect;
+
+    int read(uint8_t* buf, size_t size) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using WiFiClientSecure::read;
+    using WiFiClientSecure::write;
+
+private:
+    Timing _timing;
+
+    // Socket descriptor of the TLS connection, -1 if not connected
+    int _socketFd() const;
+};
+
+#endif // AI_API_SECURE_CLIENT_H
@@ -0,0 +1,157 @@
+// ESP32_AI_Connect/AI_API_Tool_Registry.cpp
+
+#include "AI_API_Tool_Registry.h"
+#include "AI_API_Log.h"
+#include <new>
+
+#ifdef ENABLE_TOOL_CALLS // Only compile this file's content if flag is set
+
+#include <freertos/task.h>
+
+bool AI_API_Tool_Registry::add(const String& name, ToolHandler handler, bool parallel) {
+    if (name.isEmpty() || !handler) return false;
+
+    Entry* entry = const_cast<Entry*>(_find(name));
+    if (entry == nullptr) {
+        if (_count >= AI_API_TOOL_HANDLERS_MAX) return false;
+        entry = &_entries[_count++];
+        entry->name = name;
+    }
+    entry->handler = handler;
+    entry->parallel = parallel;
+    return true;
+}
+
+bool AI_API_Tool_Registry::remove(const String& name) {
+    for (size_t i = 0; i < _count; i++) {
+        if (_entries[i].name == name) {
+            // Keep the entries packed
+            for (size_t j = i + 1; j < _count; j++) _entries[j - 1] = _entries[j];
+            _count--;
+            _entries[_count] = Entry();
+            return true;
+        }
+    }
+    return false;
+}
+
+void AI_API_Tool_Registry::clear() {
+    for (size_t i = 0; i < _count; i++) _entries[i] = Entry();
+    _count = 0;
+}
+
+const AI_API_Tool_Registry::Entry* AI_API_Tool_Registry::_find(const String& name) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (_entries[i].name == name) return &_entries[i];
+    }
+    return nullptr;
+}
+
+void AI_API_Tool_Registry::_runJob(Job& job) {
+    if (job.entry == nullptr) {
+        job.output = "{\"error\":\"Unknown tool\"}";
+        return;
+    }
+    job.output = job.entry->handler(job.arguments);
+}
+
+void AI_API_Tool_Registry::_taskEntry(void* param) {
+    Job* job = (Job*)param;
+    SemaphoreHandle_t done = job->done; // The job may be gone once done is given
+    _runJob(*job);
+    xSemaphoreGive(done);
+    vTaskDelete(nullptr);
+}
+
+String AI_API_Tool_Registry::execute(const String& toolCallsJson, String& errorMsg) {
+    uint32_t start = millis();
+    _lastParallelCount = 0;
+
+    JsonDocument callsDoc;
+    DeserializationError error = deserializeJson(callsDoc, toolCallsJson);
+    if (error || !callsDoc.is<JsonArray>()) {
+        errorMsg = "Invalid tool calls JSON: must be an array of tool calls.";
+        return "";
+    }
+    JsonArray calls = callsDoc.as<JsonArray>();
+    size_t count = calls.size();
+    if (count == 0) {
+        errorMsg = "No tool calls to execute.";
+        return "";
+    }
+
+    Job* jobs = new (std::nothrow) Job[count];
+    if (jobs == nullptr) {
+        errorMsg = "Out of memory for the tool calls.";
+        return "";
+    }
+
+    size_t index = 0;
+    for (JsonObject call : calls) {
+        jobs[index].entry = _find(call["function"]["name"] | "");
+        jobs[index].arguments = call["function"]["arguments"] | "{}";
+        index++;
+    }
+
+    // Parallel handlers: the first one runs on this task, up to AI_API_TOOL_PARALLEL_MAX - 1
+    // others on their own tasks. A job whose task could not be created runs here as well.
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(count, 0);
+    uint32_t started = 0;
+    bool callerHasJob = false;
+    for (size_t i = 0; i < count && done != nullptr; i++) {
+        if (jobs[i].entry == nullptr || !jobs[i].entry->parallel) continue;
+        if (!callerHasJob) {
+            callerHasJob = true;
+            continue;
+        }
+        if (started + 1 >= AI_API_TOOL_PARALLEL_MAX) break;
+
+        jobs[i].done = done;
+        if (xTaskCreatePinnedToCore(_taskEntry, "ai_tool", AI_API_TOOL_TASK_STACK_SIZE, &jobs[i],
+                                    AI_API_TOOL_TASK_PRIORITY, nullptr, tskNO_AFFINITY) == pdPASS) {
+            started++;
+        } else {
+            jobs[i].done = nullptr;
+            AI_API_LOGW("Could not start a task for a tool call, running it inline");
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        bool parallel = jobs[i].entry == nullptr || jobs[i].entry->parallel;
+        if (parallel && jobs[i].done == nullptr) _runJob(jobs[i]);
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    if (done != nullptr) vSemaphoreDelete(done);
+
+    // The others run alone, after all parallel handlers have returned
+    for (size_t i = 0; i < count; i++) {
+        if (jobs[i].entry != nullptr && !jobs[i].entry->parallel) _runJob(jobs[i]);
+    }
+
+    JsonDocument resultsDoc;
+    JsonArray results = resultsDoc.to<JsonArray>();
+    index = 0;
+    for (JsonObject call : calls) {
+        String id = call["id"] | "";
+        if (id.isEmpty()) id = "call_" + String(index); // Gemini calls carry no id
+        JsonObject result = results.add<JsonObject>();
+        result["tool_call_id"] = id;
+        result["function"]["name"] = call["function"]["name"];
+        result["function"]["output"] = jobs[index].output;
+        index++;
+    }
+    delete[] jobs;
+
+    String resultsJson;
+    serializeJson(resultsDoc, resultsJson);
+
+    _lastParallelCount = started;
+    _lastExecutionMs = millis() - start;
+    AI_API_LOGD("Ran %u tool calls in %u ms (%u on extra tasks)", (unsigned)count,
+                (unsigned)_lastExecutionMs, (unsigned)started);
+    return resultsJson;
+}
+
+#endif // ENABLE_TOOL_CALLS
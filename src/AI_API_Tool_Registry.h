@@ -0,0 +1,85 @@
+// ESP32_AI_Connect/AI_API_Tool_Registry.h
+
+#ifndef AI_API_TOOL_REGISTRY_H
+#define AI_API_TOOL_REGISTRY_H
+
+#include "ESP32_AI_Connect_config.h" // Include config first
+
+#ifdef ENABLE_TOOL_CALLS // Only compile this file's content if flag is set
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Handlers of the tools defined with setTCTools(), looked up by name when a response
+// calls them.
+//
+// execute() runs the handlers of all tool calls of one response and returns their
+// results in the format tcReply() takes. Handlers registered as parallel run at the
+// same time, on up to AI_API_TOOL_PARALLEL_MAX - 1 short-lived tasks (on any core)
+// plus the calling task, so tools waiting on slow sensors or a server overlap. The
+// other handlers run on the calling task afterwards, one at a time, never alongside
+// another handler. A parallel handler can run on several tasks at once if a response
+// calls its tool more than once.
+//
+// Usage:
+//   AI_API_Tool_Registry tools;
+//   tools.add("get_weather", [](const String& args) { return String("{\"temp\":21}"); });
+//   String results = tools.execute(toolCallsJson, errorMsg);
+class AI_API_Tool_Registry {
+public:
+    // Gets the arguments of a call as JSON text and returns the tool's output (JSON or text)
+    typedef std::function<String(const String& arguments)> ToolHandler;
+
+    AI_API_Tool_Registry() {}
+
+    // Register handler for the tool name, replacing an earlier one.
+    // parallel: false for handlers that must not run alongside others (e.g. sharing a bus).
+    // Returns false if AI_API_TOOL_HANDLERS_MAX handlers are registered already.
+    bool add(const String& name, ToolHandler handler, bool parallel = true);
+    // Returns false if no handler is registered for name
+    bool remove(const String& name);
+    void clear();
+
+    bool contains(const String& name) const { return _find(name) != nullptr; }
+    size_t getCount() const { return _count; }
+
+    // Run the handlers of toolCallsJson (a tool calls array as returned by tcChat()) and
+    // return the results as a JSON array for tcReply(). Calls of unregistered tools get an
+    // error output, so the model learns about it. Calls without an id are replied to as
+    // "call_<index>". Returns "" if toolCallsJson is not a tool calls array (errorMsg is set).
+    String execute(const String& toolCallsJson, String& errorMsg);
+
+    // Of the last execute(): wall time in ms and how many handlers ran on extra tasks
+    uint32_t getLastExecutionMs() const { return _lastExecutionMs; }
+    uint32_t getLastParallelCount() const { return _lastParallelCount; }
+
+private:
+    struct Entry {
+        String name;
+        ToolHandler handler;
+        bool parallel = true;
+    };
+
+    // One tool call; shared with the task running it until done is given
+    struct Job {
+        const Entry* entry = nullptr;
+        String arguments;
+        String output;
+        SemaphoreHandle_t done = nullptr;
+    };
+
+    Entry _entries[AI_API_TOOL_HANDLERS_MAX];
+    size_t _count = 0;
+    uint32_t _lastExecutionMs = 0;
+    uint32_t _lastParallelCount = 0;
+
+    const Entry* _find(const String& name) const;
+    static void _runJob(Job& job);
+    static void _taskEntry(void* param);
+};
+
+#endif // ENABLE_TOOL_CALLS
+#endif // AI_API_TOOL_REGISTRY_H
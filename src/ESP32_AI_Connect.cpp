@@ -1,4 +1,6 @@
 #include "ESP32_AI_Connect.h"
+#include <esp_system.h> // esp_random() for retry jitter
+#include <esp_heap_caps.h> // Free heap for the request metrics
 
 // Constructor
 ESP32_AI_Connect::ESP32_AI_Connect(const char* platformIdentifier, const char* apiKey, const char* modelName) {
@@ -9,9 +11,13 @@ ESP32_AI_Connect::ESP32_AI_Connect(const char* platformIdentifier, const char* a
     // Initialize FreeRTOS mutex for thread safety
     _streamMutex = xSemaphoreCreateMutex();
     if (_streamMutex == nullptr) {
-        Serial.println("ERROR: Failed to create stream mutex");
+        AI_API_LOGE("Failed to create stream mutex");
     }
 #endif
+
+#ifdef AI_API_USE_PSRAM
+    setAllocator(AI_API_Psram_Allocator::instance());
+#endif
     
     begin(platformIdentifier, apiKey, modelName); // Call helper to initialize
 }
@@ -25,15 +31,23 @@ ESP32_AI_Connect::ESP32_AI_Connect(const char* platformIdentifier, const char* a
     // Initialize FreeRTOS mutex for thread safety
     _streamMutex = xSemaphoreCreateMutex();
     if (_streamMutex == nullptr) {
-        Serial.println("ERROR: Failed to create stream mutex");
+        AI_API_LOGE("Failed to create stream mutex");
     }
 #endif
+
+#ifdef AI_API_USE_PSRAM
+    setAllocator(AI_API_Psram_Allocator::instance());
+#endif
     
     begin(platformIdentifier, apiKey, modelName, endpointUrl); // Call helper to initialize
 }
 
 // Destructor
 ESP32_AI_Connect::~ESP32_AI_Connect() {
+#ifdef ENABLE_ASYNC_CHAT
+    endAsync(); // The worker task must not outlive this object
+#endif
+
     _cleanupHandler();
     
 #ifdef ENABLE_TOOL_CALLS
@@ -59,7 +73,9 @@ ESP32_AI_Connect::~ESP32_AI_Connect() {
 
 // Cleanup helper
 void ESP32_AI_Connect::_cleanupHandler() {
-    delete _platformHandler;
+#ifndef AI_CONNECT_FIXED_PLATFORM
+    delete _platformHandler; // A fixed handler is a member, not a heap allocation
+#endif
     _platformHandler = nullptr;
 }
 
@@ -80,6 +96,24 @@ bool ESP32_AI_Connect::begin(const char* platformIdentifier, const char* apiKey,
     String platformStr = platformIdentifier;
     platformStr.toLowerCase(); // Case-insensitive comparison
 
+#ifdef AI_CONNECT_FIXED_PLATFORM
+    // --- Handler Bound at Compile Time: only check the identifier ---
+    #if AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_OPENAI
+    bool platformMatches = (platformStr == "openai" || platformStr == "openai-compatible");
+    #elif AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_GEMINI
+    bool platformMatches = (platformStr == "gemini");
+    #elif AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_DEEPSEEK
+    bool platformMatches = (platformStr == "deepseek");
+    #else
+    bool platformMatches = (platformStr == "claude");
+    #endif
+    if (!platformMatches) {
+        _lastError = "Platform '" + String(platformIdentifier) + "' is not the platform fixed by AI_CONNECT_FIXED_PLATFORM";
+        AI_API_LOGE("%s", _lastError.c_str());
+        return false;
+    }
+    _platformHandler = &_fixedHandler;
+#else
     // --- Conditionally Create Platform Handler Instance ---
     #ifdef USE_AI_API_OPENAI
     if (platformStr == "openai" || platformStr == "openai-compatible") {
@@ -108,11 +142,26 @@ bool ESP32_AI_Connect::begin(const char* platformIdentifier, const char* apiKey,
     { // Default case if no match found or platform not compiled
         if (_platformHandler == nullptr) { // Only set error if no handler was created
              _lastError = "Platform '" + String(platformIdentifier) + "' is not supported or was disabled with DISABLE_AI_API_<PLATFORM>";
-             Serial.println("ERROR: " + _lastError);
+             AI_API_LOGE("%s", _lastError.c_str());
              return false; // Indicate failure
         }
     }
+#endif // AI_CONNECT_FIXED_PLATFORM
+
+    _platformHandler->setPromptCaching(_promptCaching);
+    if (!_platformHandler->setCachedContent(_cachedContent)) {
+        AI_API_LOGW("Cached content is not supported by this platform, ignoring it");
+    }
+
+#ifdef ENABLE_TOOL_CALLS
+    // Tool definitions are converted per platform, redo it for the new handler
+    _tcToolsJson = "";
+    if (_tcToolsArraySize > 0 && !_buildTCToolsJson()) {
+        return false;
+    }
+#endif
 
+    _platformId = platformStr;
     return true; // Indicate success
 }
 
@@ -126,6 +175,7 @@ void ESP32_AI_Connect::setChatMaxTokens(int maxTokens) { _maxTokens = max(1, max
 
 // Set Root CA certificate for secure SSL/TLS connections
 void ESP32_AI_Connect::setRootCA(const char* rootCACert) {
+    closeConnection(); // An open connection was verified against the previous settings
     _rootCACert = rootCACert;
     if (_rootCACert != nullptr && strlen(_rootCACert) > 0) {
         _wifiClient.setCACert(_rootCACert);
@@ -137,6 +187,667 @@ void ESP32_AI_Connect::setRootCA(const char* rootCACert) {
 // Returns the currently set Root CA certificate
 const char* ESP32_AI_Connect::getRootCA() const { return _rootCACert; }
 
+// --- Connection Reuse ---
+void ESP32_AI_Connect::setConnectionReuse(bool enable) {
+    _connectionReuse = enable;
+    if (!enable) {
+        closeConnection(); // Drop any connection kept open by a previous request
+    }
+}
+
+bool ESP32_AI_Connect::getConnectionReuse() const { return _connectionReuse; }
+
+bool ESP32_AI_Connect::getLastRequestReusedConnection() const { return _lastRequestReused; }
+
+uint32_t ESP32_AI_Connect::getReusedConnectionCount() const { return _reusedConnectionCount; }
+
+uint32_t ESP32_AI_Connect::getNewConnectionCount() const { return _newConnectionCount; }
+
+void ESP32_AI_Connect::closeConnection() {
+    _endConnection(true);
+}
+
+void ESP32_AI_Connect::setDirectResponseParsing(bool enable, bool keepRawResponse) {
+    _directResponseParsing = enable;
+    _keepRawResponse = keepRawResponse;
+}
+
+bool ESP32_AI_Connect::getDirectResponseParsing() const { return _directResponseParsing; }
+
+bool ESP32_AI_Connect::hasOpenConnection() const { return !_connectedHost.isEmpty(); }
+
+// --- Automatic Retry ---
+void ESP32_AI_Connect::setRetryPolicy(uint8_t maxAttempts, uint32_t baseDelayMs, uint32_t maxDelayMs) {
+    _retryMaxAttempts = maxAttempts > 0 ? maxAttempts : 1;
+    _retryBaseDelayMs = baseDelayMs > 0 ? baseDelayMs : 1;
+    _retryMaxDelayMs = maxDelayMs > _retryBaseDelayMs ? maxDelayMs : _retryBaseDelayMs;
+}
+
+uint8_t ESP32_AI_Connect::getRetryMaxAttempts() const { return _retryMaxAttempts; }
+
+uint8_t ESP32_AI_Connect::getLastRequestAttempts() const { return _lastRequestAttempts; }
+
+// --- Request Metrics ---
+ESP32_AI_Connect::RequestMetrics ESP32_AI_Connect::getLastRequestMetrics() const { return _lastMetrics; }
+
+void ESP32_AI_Connect::setRequestMetricsCallback(RequestMetricsCallback callback) { _metricsCallback = callback; }
+
+void ESP32_AI_Connect::_metricsBegin(RequestType type) {
+    _metrics = RequestMetrics();
+    _metrics.type = type;
+    _metricsStartAt = millis();
+    _metricsResponded = false;
+    _metrics.heapFreeBefore = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    _metricsHeapLow = _metrics.heapFreeBefore;
+    _metricsHeapFloor = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    _wifiClient.resetTiming();
+}
+
+void ESP32_AI_Connect::_metricsSampleHeap() {
+    size_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    if (freeHeap < _metricsHeapLow) _metricsHeapLow = freeHeap;
+}
+
+void ESP32_AI_Connect::_metricsEnd(bool success) {
+    uint32_t now = millis();
+    _metricsSampleHeap();
+    // Samples can miss a short-lived peak. The all-time minimum can't, but it only
+    // tells something about this request if it was lowered during it.
+    size_t floor = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    if (floor < _metricsHeapFloor && floor < _metricsHeapLow) _metricsHeapLow = floor;
+
+    const AI_API_Secure_Client::Timing& timing = _wifiClient.getTiming();
+    _metrics.success = success;
+    _metrics.dnsMs = timing.dnsMs;
+    _metrics.connectMs = timing.connectMs;
+    if (timing.responseStarted) _metrics.firstByteMs = timing.firstByteAt - timing.requestSentAt;
+    if (_metricsResponded) _metrics.bodyMs = now - _metricsResponseAt;
+    _metrics.totalMs = now - _metricsStartAt;
+    _metrics.bytesSent = timing.bytesWritten;
+    _metrics.bytesReceived = timing.bytesRead;
+    _metrics.heapMinFree = _metricsHeapLow;
+    _metrics.heapPeakUsed = _metrics.heapFreeBefore - _metricsHeapLow;
+#ifdef ENABLE_RESPONSE_CACHE
+    _metrics.cached = _metrics.type == RequestType::CHAT && _lastResponseCached;
+#endif
+
+    _lastMetrics = _metrics;
+    if (_metricsCallback) _metricsCallback(_lastMetrics);
+}
+
+// --- Memory Allocation ---
+void ESP32_AI_Connect::setAllocator(ArduinoJson::Allocator* allocator) {
+    _allocator = allocator;
+    _rebindDocument(_reqDoc, allocator);
+    _rebindDocument(_respDoc, allocator);
+    _rebindDocument(_chatCustomParamsDoc, allocator);
+#ifdef ENABLE_STREAM_CHAT
+    if (_acquireStreamLock(100)) {
+        _rebindDocument(_streamCustomParamsDoc, allocator);
+        _releaseStreamLock();
+    }
+#endif
+}
+
+ArduinoJson::Allocator* ESP32_AI_Connect::getAllocator() const { return _allocator; }
+
+void ESP32_AI_Connect::_rebindDocument(JsonDocument& doc, ArduinoJson::Allocator* allocator) {
+    // An ArduinoJson document keeps its allocator for life; swap in a new one instead
+    JsonDocument rebound = allocator != nullptr ? JsonDocument(allocator) : JsonDocument();
+    rebound.set(doc);
+    doc = std::move(rebound);
+}
+
+// --- Conversation History ---
+bool ESP32_AI_Connect::setChatHistory(size_t arenaBytes, bool usePsram) {
+    if (!_chatHistory.begin(arenaBytes, usePsram)) {
+        _lastError = "Failed to allocate chat history (" + String(arenaBytes) + " bytes)";
+        return false;
+    }
+    return true;
+}
+
+void ESP32_AI_Connect::setChatHistoryTokenBudget(size_t maxTokens) {
+    _chatHistory.setTokenBudget(maxTokens);
+}
+
+void ESP32_AI_Connect::chatHistoryClear() {
+    _chatHistory.clear();
+}
+
+size_t ESP32_AI_Connect::getChatHistoryTurnCount() const { return _chatHistory.getTurnCount(); }
+
+size_t ESP32_AI_Connect::getChatHistoryBytes() const { return _chatHistory.getUsedBytes(); }
+
+// --- Prompt Caching ---
+void ESP32_AI_Connect::setPromptCaching(bool enabled) {
+    _promptCaching = enabled;
+    if (_platformHandler) _platformHandler->setPromptCaching(enabled);
+#ifdef ENABLE_TOOL_CALLS
+    _tcToolsJson = ""; // Cache breakpoints are part of the converted tools, rebuild them
+#endif
+}
+
+bool ESP32_AI_Connect::getPromptCaching() const { return _promptCaching; }
+
+bool ESP32_AI_Connect::setCachedContent(const String& name) {
+    if (_platformHandler && !_platformHandler->setCachedContent(name)) {
+        _lastError = "Cached content is not supported by this platform";
+        return false;
+    }
+    _cachedContent = name;
+    return true;
+}
+
+String ESP32_AI_Connect::getCachedContent() const { return _cachedContent; }
+
+int ESP32_AI_Connect::getCachedTokens() const {
+    return _platformHandler ? _platformHandler->getCachedTokens() : 0;
+}
+
+int ESP32_AI_Connect::getCacheWriteTokens() const {
+    return _platformHandler ? _platformHandler->getCacheWriteTokens() : 0;
+}
+
+#ifdef ENABLE_RESPONSE_CACHE
+// --- Response Cache ---
+bool ESP32_AI_Connect::setResponseCache(size_t maxEntries, size_t maxBytes) {
+    if (!_responseCache.begin(maxEntries, maxBytes)) {
+        _lastError = "Failed to allocate response cache";
+        return false;
+    }
+    return true;
+}
+
+void ESP32_AI_Connect::setResponseCacheStorage(fs::FS* fs, const char* directory, size_t maxFiles) {
+    _responseCache.setStorage(fs, directory, maxFiles);
+}
+
+void ESP32_AI_Connect::setResponseCacheForce(bool force) { _responseCacheForce = force; }
+
+void ESP32_AI_Connect::responseCacheClear() { _responseCache.clear(); }
+
+bool ESP32_AI_Connect::getLastResponseCached() const { return _lastResponseCached; }
+
+uint32_t ESP32_AI_Connect::getResponseCacheHits() const { return _responseCache.getHits(); }
+
+uint32_t ESP32_AI_Connect::getResponseCacheMisses() const { return _responseCache.getMisses(); }
+
+bool ESP32_AI_Connect::_responseCacheUsable() const {
+    if (!_responseCache.isEnabled()) return false;
+    // With history the reply depends on earlier turns, and a hit would skip storing the new one
+    if (_historyForRequest() != nullptr) return false;
+    // Unset (-1) means the API default, which samples
+    return _responseCacheForce || _temperature == 0.0f;
+}
+
+uint64_t ESP32_AI_Connect::_responseCacheKey(const String& url, const String& userMessage) const {
+    uint64_t key = AI_API_Response_Cache::HASH_SEED;
+    key = AI_API_Response_Cache::hashField(key, url); // Platform and custom endpoint
+    key = AI_API_Response_Cache::hashField(key, _modelName);
+    key = AI_API_Response_Cache::hashField(key, _systemRole);
+    key = AI_API_Response_Cache::hashField(key, &_temperature, sizeof(_temperature));
+    key = AI_API_Response_Cache::hashField(key, &_maxTokens, sizeof(_maxTokens));
+    key = AI_API_Response_Cache::hashField(key, _chatCustomParams);
+    // Both change the request body; a cached context may also hold a different conversation
+    key = AI_API_Response_Cache::hashField(key, &_promptCaching, sizeof(_promptCaching));
+    key = AI_API_Response_Cache::hashField(key, _cachedContent);
+    key = AI_API_Response_Cache::hashField(key, userMessage);
+    return key;
+}
+#endif
+
+#ifdef ENABLE_STATE_SAVE
+// --- State Save / Restore ---
+// Version of the state record; records of another version are rejected
+static const uint8_t AI_API_STATE_VERSION = 1;
+
+size_t ESP32_AI_Connect::saveState(uint8_t* buffer, size_t size) {
+    JsonDocument doc;
+    if (!_buildStateDoc(doc)) return 0;
+    size_t needed = measureMsgPack(doc);
+    if (buffer == nullptr || size < needed) {
+        _lastError = "State buffer too small (" + String(needed) + " bytes needed)";
+        return 0;
+    }
+    return serializeMsgPack(doc, buffer, size);
+}
+
+size_t ESP32_AI_Connect::saveState(Print& output) {
+    JsonDocument doc;
+    if (!_buildStateDoc(doc)) return 0;
+    return serializeMsgPack(doc, output);
+}
+
+size_t ESP32_AI_Connect::getStateSize() {
+    JsonDocument doc;
+    if (!_buildStateDoc(doc)) return 0;
+    return measureMsgPack(doc);
+}
+
+bool ESP32_AI_Connect::restoreState(const uint8_t* data, size_t length) {
+    JsonDocument doc;
+    DeserializationError error = deserializeMsgPack(doc, data, length);
+    if (error) {
+        _lastError = "Invalid state: " + String(error.c_str());
+        return false;
+    }
+    return _applyStateDoc(doc);
+}
+
+bool ESP32_AI_Connect::restoreState(Stream& input) {
+    JsonDocument doc;
+    DeserializationError error = deserializeMsgPack(doc, input);
+    if (error) {
+        _lastError = "Invalid state: " + String(error.c_str());
+        return false;
+    }
+    return _applyStateDoc(doc);
+}
+
+// Short keys keep the record small; strings are stored as-is, without JSON escaping
+bool ESP32_AI_Connect::_buildStateDoc(JsonDocument& doc) {
+    doc["v"] = AI_API_STATE_VERSION;
+    doc["pf"] = _platformId;
+
+    JsonObject chat = doc["c"].to<JsonObject>();
+    chat["s"] = _systemRole;
+    chat["t"] = _temperature;
+    chat["n"] = _maxTokens;
+    chat["p"] = _chatCustomParams;
+
+    JsonObject options = doc["o"].to<JsonObject>();
+    options["cr"] = _connectionReuse;
+    options["ra"] = _retryMaxAttempts;
+    options["rb"] = _retryBaseDelayMs;
+    options["rm"] = _retryMaxDelayMs;
+    options["dp"] = _directResponseParsing;
+    options["kr"] = _keepRawResponse;
+    options["pc"] = _promptCaching;
+    options["cc"] = _cachedContent;
+
+    // Turns are kept as the JSON literals of the arena, so restoring them skips the escaping
+    if (_chatHistory.isEnabled()) {
+        JsonObject history = doc["h"].to<JsonObject>();
+        history["c"] = _chatHistory.getCapacity();
+        history["b"] = _chatHistory.getTokenBudget();
+        JsonArray turns = history["t"].to<JsonArray>();
+        AI_API_Chat_History::Turn turn;
+        for (size_t pos = 0; _chatHistory.readTurn(pos, turn); ) {
+            turns.add((uint8_t)turn.role);
+            turns.add(turn.json);
+        }
+    }
+
+#ifdef ENABLE_TOOL_CALLS
+    JsonObject tc = doc["tc"].to<JsonObject>();
+    JsonArray tools = tc["d"].to<JsonArray>();
+    for (int i = 0; i < _tcToolsArraySize; i++) tools.add(_tcToolsArray[i]);
+    tc["j"] = _tcToolsJson;
+    tc["s"] = _tcSystemRole;
+    tc["c"] = _tcToolChoice;
+    tc["n"] = _tcMaxToken;
+    tc["fc"] = _tcFollowUpToolChoice;
+    tc["fn"] = _tcFollowUpMaxToken;
+    if (_lastMessageWasToolCalls) {
+        tc["u"] = _lastUserMessage;
+        tc["a"] = _lastAssistantToolCallsJson;
+    }
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+    // A record without the stream settings would restore them to defaults, so save none at all
+    if (!_acquireStreamLock(100)) {
+        _lastError = "State not saved: stream settings are locked by a running stream";
+        return false;
+    }
+    {
+        JsonObject stream = doc["st"].to<JsonObject>();
+        stream["s"] = _streamSystemRole;
+        stream["t"] = _streamTemperature;
+        stream["n"] = _streamMaxTokens;
+        stream["p"] = _streamCustomParams;
+        stream["cb"] = _streamCoalesceBytes;
+        stream["cm"] = _streamCoalesceMs;
+        stream["cd"] = (uint8_t)_streamCoalesceBoundary;
+        stream["bb"] = _streamBudgetBytes;
+        stream["bm"] = _streamBudgetMs;
+        stream["bt"] = _streamBudgetTokens;
+        JsonArray stops = stream["x"].to<JsonArray>();
+        for (size_t i = 0; i < _streamStopStringCount; i++) stops.add(_streamStopStrings[i]);
+        _releaseStreamLock();
+    }
+#endif
+    return true;
+}
+
+bool ESP32_AI_Connect::_applyStateDoc(JsonDocument& doc) {
+    if (!doc.is<JsonObject>() || (doc["v"] | 0) != AI_API_STATE_VERSION) {
+        _lastError = "Invalid state: not a state record of this library version";
+        return false;
+    }
+    // Converted tools and tool calls only make sense to the platform they were made for
+    bool samePlatform = !_platformId.isEmpty() && _platformId == (doc["pf"] | "");
+    String failed = ""; // Parts that could not be restored, reported once everything else is
+
+    JsonObject chat = doc["c"];
+    _systemRole = chat["s"] | "";
+    _temperature = chat["t"] | -1.0f;
+    _maxTokens = chat["n"] | -1;
+    if (!setChatParameters(chat["p"] | "")) failed += "chat parameters, ";
+
+    JsonObject options = doc["o"];
+    setConnectionReuse(options["cr"] | false);
+    setRetryPolicy(options["ra"] | AI_API_RETRY_MAX_ATTEMPTS, options["rb"] | AI_API_RETRY_BASE_DELAY_MS,
+                   options["rm"] | AI_API_RETRY_MAX_DELAY_MS);
+    setDirectResponseParsing(options["dp"] | false, options["kr"] | false);
+    setPromptCaching(options["pc"] | false);
+    if (!setCachedContent(options["cc"] | "")) {
+        AI_API_LOGW("Saved cached content is not supported by this platform, ignoring it");
+    }
+
+    JsonObject history = doc["h"];
+    if (!history.isNull()) {
+        size_t capacity = history["c"] | 0;
+        JsonArray turns = history["t"];
+        if (!_chatHistory.isEnabled() && !_chatHistory.begin(capacity)) {
+            failed += "history (" + String(capacity) + " bytes could not be allocated), ";
+        } else {
+            _chatHistory.clear();
+            _chatHistory.setTokenBudget(history["b"] | 0);
+            size_t dropped = 0;
+            for (size_t i = 0; i + 1 < turns.size(); i += 2) {
+                const char* json = turns[i + 1] | "";
+                AI_API_Chat_History::Role role = (turns[i] | 0) == AI_API_Chat_History::ASSISTANT
+                    ? AI_API_Chat_History::ASSISTANT : AI_API_Chat_History::USER;
+                if (!_chatHistory.addEncodedTurn(role, json, strlen(json))) dropped++;
+            }
+            if (dropped > 0) failed += "history (" + String(dropped) + " invalid turns), ";
+        }
+    }
+
+#ifdef ENABLE_TOOL_CALLS
+    JsonObject tc = doc["tc"];
+    if (!tc.isNull()) {
+        JsonArray tools = tc["d"];
+        delete[] _tcToolsArray;
+        _tcToolsArray = nullptr;
+        _tcToolsArraySize = 0;
+        if (tools.size() > 0) {
+            _tcToolsArray = new String[tools.size()];
+            for (JsonVariant tool : tools) _tcToolsArray[_tcToolsArraySize++] = tool.as<String>();
+        }
+        // Converted tools are reused as they are; otherwise converted again on first use
+        _tcToolsJson = samePlatform ? tc["j"].as<String>() : String("");
+        _tcSystemRole = tc["s"] | "";
+        _tcToolChoice = tc["c"] | "";
+        _tcMaxToken = tc["n"] | -1;
+        _tcFollowUpToolChoice = tc["fc"] | "";
+        _tcFollowUpMaxToken = tc["fn"] | -1;
+        _lastMessageWasToolCalls = samePlatform && !tc["a"].isNull();
+        _lastUserMessage = _lastMessageWasToolCalls ? tc["u"].as<String>() : String("");
+        _lastAssistantToolCallsJson = _lastMessageWasToolCalls ? tc["a"].as<String>() : String("");
+    }
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+    JsonObject stream = doc["st"];
+    if (!stream.isNull()) {
+        if (!setStreamChatParameters(stream["p"] | "")) failed += "stream parameters, ";
+        if (_acquireStreamLock(100)) {
+            _streamSystemRole = stream["s"] | "";
+            _streamTemperature = stream["t"] | -1.0f;
+            _streamMaxTokens = stream["n"] | -1;
+            _streamCoalesceBytes = stream["cb"] | 0;
+            _streamCoalesceMs = stream["cm"] | 0;
+            _streamCoalesceBoundary = (StreamBoundary)(stream["cd"] | 0);
+            _streamBudgetBytes = stream["bb"] | 0;
+            _streamBudgetMs = stream["bm"] | 0;
+            _streamBudgetTokens = stream["bt"] | 0;
+            for (size_t i = 0; i < _streamStopStringCount; i++) _streamStopStrings[i] = "";
+            _streamStopStringCount = 0;
+            for (JsonVariant stop : stream["x"].as<JsonArray>()) {
+                if (_streamStopStringCount >= AI_API_STREAM_STOP_STRINGS_MAX) break;
+                _streamStopStrings[_streamStopStringCount++] = stop.as<String>();
+            }
+            _releaseStreamLock();
+        } else {
+            failed += "stream settings (locked by a running stream), ";
+        }
+    }
+#endif
+
+    if (!failed.isEmpty()) {
+        failed.remove(failed.length() - 2); // Trailing ", "
+        _lastError = "State restored partly, could not restore: " + failed;
+        AI_API_LOGW("%s", _lastError.c_str());
+        return false;
+    }
+    AI_API_LOGD("State restored (%u history turns)", (unsigned)_chatHistory.getTurnCount());
+    return true;
+}
+#endif // ENABLE_STATE_SAVE
+
+// --- Connection Helpers ---
+// Response headers the library reads (HTTPClient discards all others)
+static const char* AI_API_COLLECTED_HEADERS[] = { "Transfer-Encoding", "Retry-After", "retry-after-ms" };
+
+// Extracts "host[:port]" from a URL such as "https://api.openai.com/v1/chat/completions"
+String ESP32_AI_Connect::_extractHost(const String& url) {
+    int start = url.indexOf("://");
+    start = (start == -1) ? 0 : start + 3;
+    int end = url.indexOf('/', start);
+    int query = url.indexOf('?', start);
+    if (end == -1 || (query != -1 && query < end)) end = query;
+    return (end == -1) ? url.substring(start) : url.substring(start, end);
+}
+
+// Prepares _httpClient for a request to url, reusing the open connection when possible
+bool ESP32_AI_Connect::_beginConnection(const String& url) {
+    String host = _extractHost(url);
+    bool reuse = _connectionReuse && host == _connectedHost && _wifiClient.connected();
+
+    if (!reuse) {
+        // Different host, reuse disabled, or the server closed the socket: start fresh.
+        // This is always a full handshake: start_ssl_client() sets up mbedTLS and runs the
+        // handshake in one call, leaving no point to install a saved session before it.
+        _endConnection(true);
+    }
+
+    _httpClient.setReuse(_connectionReuse); // Sends "Connection: keep-alive" when enabled
+    if (!_httpClient.begin(_wifiClient, url)) {
+        _endConnection(true);
+        return false;
+    }
+    _httpClient.collectHeaders(AI_API_COLLECTED_HEADERS, sizeof(AI_API_COLLECTED_HEADERS) / sizeof(AI_API_COLLECTED_HEADERS[0]));
+
+    _lastRequestReused = reuse;
+    if (reuse) {
+        _reusedConnectionCount++;
+    } else {
+        _newConnectionCount++;
+    }
+    _connectedHost = _connectionReuse ? host : "";
+    return true;
+}
+
+// Sends a POST request with the platform headers.
+// Returns the HTTP status code, a negative HTTPClient error code, or 0 if the
+// connection could not be started (in which case _lastError is set).
+// Sends _reqDoc as the request body. It is serialized window by window while being
+// written to the socket (see AI_API_Request_Stream), never into one large String.
+// Failures the retry policy covers are retried with the same body (see setRetryPolicy);
+// only the last attempt's response is left for the caller to read.
+int ESP32_AI_Connect::_sendPostRequest(const String& url) {
+    uint32_t measureStart = micros();
+    _requestStream.begin(_reqDoc); // Content-Length from measureJson()
+    _metrics.buildUs += micros() - measureStart;
+    _metricsSampleHeap(); // The request document is complete
+    String errorBefore = _lastError;
+    _lastRequestAttempts = 0;
+
+    while (true) {
+        _lastRequestAttempts++;
+        _wifiClient.markRequest();
+        int httpCode = _sendPostAttempt(url);
+
+        uint32_t waitMs = 0;
+        if (_lastRequestAttempts >= _retryMaxAttempts || !_retryDelay(httpCode, waitMs)) {
+            _metrics.httpCode = httpCode;
+            _metrics.attempts = _lastRequestAttempts;
+            _metrics.reusedConnection = _lastRequestReused;
+            if (httpCode > 0) {
+                _metricsResponseAt = millis();
+                _metricsResponded = true;
+            }
+            return httpCode;
+        }
+
+        AI_API_LOGW("Request failed (%d), retrying in %u ms (attempt %u of %u)", httpCode, (unsigned)waitMs,
+                    (unsigned)(_lastRequestAttempts + 1), (unsigned)_retryMaxAttempts);
+
+        // Discard this attempt. An error body is read to its end so the socket can be reused.
+        if (httpCode > 0) {
+            _httpClient.getString();
+            _endConnection();
+        } else if (httpCode < 0) {
+            _endConnection(true);
+        }
+        _lastError = errorBefore;
+
+        delay(waitMs);
+        _requestStream.rewind(); // The body is built once and sent again as-is
+    }
+}
+
+// Decides whether a failed attempt is retried, and after how long.
+// Retried: transport errors before the request was delivered (connect or send failed),
+// 408, 429, 500, 502, 503, 504 and 529 (Anthropic "overloaded"). Not retried: a read
+// timeout or a connection lost while reading, where the provider most likely got the
+// request and is still generating (and billing) it, and 0, a local begin() failure that
+// would fail the same way again.
+// A Retry-After (seconds) or retry-after-ms header replaces the backoff; if it asks for
+// longer than the maximum delay the request is not retried and fails right away.
+bool ESP32_AI_Connect::_retryDelay(int httpCode, uint32_t& waitMs) {
+    bool retryable = httpCode == HTTPC_ERROR_CONNECTION_REFUSED || httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                     httpCode == HTTPC_ERROR_SEND_PAYLOAD_FAILED || httpCode == HTTPC_ERROR_NOT_CONNECTED ||
+                     httpCode == 408 || httpCode == 429 || httpCode == 500 ||
+                     httpCode == 502 || httpCode == 503 || httpCode == 504 || httpCode == 529;
+    if (!retryable) return false;
+
+    // Exponential backoff with jitter: a random delay in [backoff / 2, backoff],
+    // so devices that failed together don't all retry at the same moment
+    uint32_t backoff = _retryBaseDelayMs;
+    for (uint8_t i = 1; i < _lastRequestAttempts && backoff < _retryMaxDelayMs; i++) {
+        backoff *= 2;
+    }
+    if (backoff > _retryMaxDelayMs) backoff = _retryMaxDelayMs;
+    waitMs = backoff / 2 + esp_random() % (backoff - backoff / 2 + 1);
+
+    if (httpCode > 0) {
+        String retryAfterMs = _httpClient.header("retry-after-ms");
+        String retryAfter = _httpClient.header("Retry-After");
+        long requestedMs = -1;
+        if (retryAfterMs.length() > 0 && isDigit(retryAfterMs[0])) {
+            requestedMs = retryAfterMs.toInt();
+        } else if (retryAfter.length() > 0 && isDigit(retryAfter[0])) {
+            requestedMs = retryAfter.toInt() * 1000L; // An HTTP-date is ignored: the backoff applies
+        }
+        if (requestedMs >= 0) {
+            if ((uint32_t)requestedMs > _retryMaxDelayMs) return false;
+            // Jitter on top, never below what the server asked for
+            if ((uint32_t)requestedMs > waitMs) waitMs = requestedMs + esp_random() % (backoff / 4 + 1);
+        }
+    }
+    return true;
+}
+
+// One attempt of _sendPostRequest()
+int ESP32_AI_Connect::_sendPostAttempt(const String& url) {
+    if (!_beginConnection(url)) {
+        _lastError = "HTTP Client failed to begin connection to: " + url;
+        return 0;
+    }
+
+    _platformHandler->setHeaders(_httpClient, _apiKey); // Set headers via handler
+    _httpClient.setTimeout(AI_API_HTTP_TIMEOUT_MS); // Use configured timeout
+    int httpCode = _httpClient.sendRequest("POST", &_requestStream, _requestStream.size());
+
+    // A kept-alive socket may have been closed by the server while idle. The request never
+    // reached it, so reconnect once and send it again. A connection lost while waiting for
+    // the reply only counts as stale if it failed right after sending, before any response
+    // byte: later, the provider may already be generating (and billing) the request.
+    bool staleLost = false;
+    if (httpCode == HTTPC_ERROR_CONNECTION_LOST) {
+        const AI_API_Secure_Client::Timing& timing = _wifiClient.getTiming();
+        staleLost = !timing.responseStarted &&
+                    (!timing.requestSent || millis() - timing.requestSentAt < AI_API_STALE_CONNECTION_MS);
+    }
+    if (_lastRequestReused &&
+        (staleLost || httpCode == HTTPC_ERROR_NOT_CONNECTED ||
+         httpCode == HTTPC_ERROR_SEND_HEADER_FAILED || httpCode == HTTPC_ERROR_SEND_PAYLOAD_FAILED)) {
+        AI_API_LOGI("Kept-alive connection was stale, reconnecting");
+        _reusedConnectionCount--;
+        _endConnection(true);
+        if (!_beginConnection(url)) {
+            _lastError = "HTTP Client failed to begin connection to: " + url;
+            return 0;
+        }
+        _platformHandler->setHeaders(_httpClient, _apiKey);
+        _httpClient.setTimeout(AI_API_HTTP_TIMEOUT_MS);
+        _requestStream.rewind();
+        httpCode = _httpClient.sendRequest("POST", &_requestStream, _requestStream.size());
+    }
+
+    return httpCode;
+}
+
+// Finishes the current request. The socket stays open for the next request when
+// connection reuse is enabled, unless forceClose is set.
+void ESP32_AI_Connect::_endConnection(bool forceClose) {
+    _metricsSampleHeap(); // The response body and document are still allocated here
+    _httpClient.end();
+    if (forceClose || !_connectionReuse) {
+        _wifiClient.stop();
+        _connectedHost = "";
+    }
+}
+
+// Parses a 200 response straight from the socket (see setDirectResponseParsing).
+// rawResponse receives a copy of the body only when raw capture was requested.
+// bodyComplete is false if the body could not be read to its end, in which case
+// the socket must be closed instead of reused.
+String ESP32_AI_Connect::_parseResponseStream(bool toolCalls, String& rawResponse, bool& bodyComplete) {
+    rawResponse = "";
+    bodyComplete = false;
+
+    WiFiClient* client = _httpClient.getStreamPtr();
+    if (client == nullptr) {
+        _lastError = "HTTP response stream is not available";
+        return "";
+    }
+
+    // getStreamPtr() is the raw socket, so chunked framing is removed here
+    bool chunked = _httpClient.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    AI_API_Response_Stream body(*client, _httpClient.getSize(), chunked,
+                                _keepRawResponse ? &rawResponse : nullptr);
+    body.setTimeout(AI_API_HTTP_TIMEOUT_MS);
+
+    String responseContent;
+#ifdef ENABLE_TOOL_CALLS
+    if (toolCalls) {
+        responseContent = _platformHandler->parseToolCallsResponseStream(body, _lastError, _respDoc);
+    } else
+#endif
+    {
+        responseContent = _platformHandler->parseResponseStream(body, _lastError, _respDoc);
+    }
+
+    // Consume what follows the JSON document (trailing newline, terminating chunk)
+    bodyComplete = body.drain();
+    return responseContent;
+}
+
 // --- Configuration Getters ---
 // Returns the current System Role set for standard chat requests.
 String ESP32_AI_Connect::getChatSystemRole() const {
@@ -159,11 +870,14 @@ bool ESP32_AI_Connect::setChatParameters(String userParameterJsonStr) {
     // If empty string, clear the parameters
     if (userParameterJsonStr.isEmpty()) {
         _chatCustomParams = "";
+        _chatCustomParamsDoc.clear();
         return true;
     }
     
     // Validate JSON format
-    JsonDocument tempDoc; // Temporary document for validation
+    // Temporary document for validation, on the documents' allocator: moved in below, it
+    // brings that allocator along (see _rebindDocument)
+    JsonDocument tempDoc = _allocator != nullptr ? JsonDocument(_allocator) : JsonDocument();
     DeserializationError error = deserializeJson(tempDoc, userParameterJsonStr);
     
     if (error) {
@@ -171,8 +885,9 @@ bool ESP32_AI_Connect::setChatParameters(String userParameterJsonStr) {
         return false;
     }
     
-    // Store validated JSON string
+    // Store validated JSON string, and keep the parsed form for the request builders
     _chatCustomParams = userParameterJsonStr;
+    _chatCustomParamsDoc = std::move(tempDoc);
     return true;
 }
 
@@ -213,6 +928,7 @@ void ESP32_AI_Connect::chatReset() {
     _temperature = -1.0;  // Reset temperature set by setChatTemperature to API default
     _maxTokens = -1;      // Reset max tokens set by setChatMaxTokens to API default
     _chatCustomParams = ""; // Reset custom parameters to empty string
+    _chatCustomParamsDoc.clear();
 }
 
 // --- Get Last Error ---
@@ -287,6 +1003,7 @@ String ESP32_AI_Connect::getTCReplyToolChoice() const {
 
 // --- Tool Setup ---
 bool ESP32_AI_Connect::setTCTools(String* tcTools, int tcToolsSize) {
+    if (_rejectDuringAgent()) return false;
     _lastError = "";
     
     // --- VALIDATION STEP 1: Check total length ---
@@ -369,6 +1086,21 @@ bool ESP32_AI_Connect::setTCTools(String* tcTools, int tcToolsSize) {
         _tcToolsArraySize = tcToolsSize;
     }
     
+    // Convert the tools to the platform format once, instead of on every request
+    _tcToolsJson = "";
+    if (_platformHandler != nullptr && _tcToolsArraySize > 0) {
+        return _buildTCToolsJson();
+    }
+    
+    return true;
+}
+
+bool ESP32_AI_Connect::_buildTCToolsJson() {
+    _tcToolsJson = _platformHandler->buildToolsJson(_tcToolsArray, _tcToolsArraySize, _lastError);
+    if (_tcToolsJson.isEmpty()) {
+        if (_lastError.isEmpty()) _lastError = "Failed to convert tool definitions for this platform.";
+        return false;
+    }
     return true;
 }
 
@@ -380,8 +1112,11 @@ void ESP32_AI_Connect::tcChatReset() {
     _tcRawResponse = ""; // Clear the raw tool calling response
     _tcChatResponseCode = 0; // Reset the stored tcChat HTTP response code
     _tcReplyResponseCode = 0; // Reset the stored tcReply HTTP response code
+    _tcToolResults = "";
+    _tcAgentSteps = 0;
+    _tcAgentTokens = 0;
     
-    // Reset but don't delete tool definitions
+    // Reset but don't delete tool definitions (or their handlers)
     // If users want to clear tools, they need to call setTCTools with empty array
     
     // Reset configuration to defaults
@@ -396,6 +1131,14 @@ void ESP32_AI_Connect::tcChatReset() {
 
 // --- Perform Tool Calls Chat ---
 String ESP32_AI_Connect::tcChat(const String& tcUserMessage) {
+    if (_rejectDuringAgent()) return "";
+    _metricsBegin(RequestType::TC_CHAT);
+    String reply = _tcChatRequest(tcUserMessage);
+    _metricsEnd(!reply.isEmpty());
+    return reply;
+}
+
+String ESP32_AI_Connect::_tcChatRequest(const String& tcUserMessage) {
     _lastError = "";
     _tcRawResponse = ""; // Clear previous raw response
     _tcChatResponseCode = 0; // Reset response code
@@ -411,6 +1154,9 @@ String ESP32_AI_Connect::tcChat(const String& tcUserMessage) {
         _lastError = "Tool calls not set up. Call setTCTools() first.";
         return "";
     }
+    if (_tcToolsJson.isEmpty() && !_buildTCToolsJson()) {
+        return ""; // _lastError already set
+    }
     
     // Reset conversation tracking for new chat
     _lastUserMessage = tcUserMessage;
@@ -425,49 +1171,49 @@ String ESP32_AI_Connect::tcChat(const String& tcUserMessage) {
     }
     
     // Build request body using the platform handler's tool calls method
-    String requestBody = _platformHandler->buildToolCallsRequestBody(
-        _modelName, _tcToolsArray, _tcToolsArraySize, 
-        _tcSystemRole, _tcToolChoice, _tcMaxToken, tcUserMessage, _reqDoc);
-    
-    if (requestBody.isEmpty()) {
+    uint32_t buildStart = micros();
+    bool bodyBuilt = _platformHandler->buildToolCallsRequestBody(
+        _modelName, _tcToolsJson,
+        _tcSystemRole, _tcToolChoice, _tcMaxToken, tcUserMessage, _reqDoc,
+        _historyForRequest());
+    _metrics.buildUs += micros() - buildStart;
+    
+    if (!bodyBuilt) {
         if (_lastError.isEmpty()) _lastError = "Failed to build tool calls request body.";
         return "";
     }
     
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.println("---------- AI Tool Calls Request ----------");
-    Serial.println("URL: " + url);
-    Serial.println("Body: " + requestBody);
-    Serial.println("-------------------------------------------");
-    #endif
+    AI_API_LOGD("Tool calls request: %s", url.c_str());
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Body", _reqDoc);
     
     // Perform HTTP POST Request (same pattern as regular chat)
-    _httpClient.end(); // Ensure previous connection is closed
-    if (_httpClient.begin(_wifiClient, url)) {
-        _platformHandler->setHeaders(_httpClient, _apiKey); // Same headers as regular chat
-        _httpClient.setTimeout(AI_API_HTTP_TIMEOUT_MS);
-        int httpCode = _httpClient.POST(requestBody);
-        
+    int httpCode = _sendPostRequest(url);
+    if (httpCode != 0) {
         // Store the HTTP response code
         _tcChatResponseCode = httpCode;
         
         // Handle Response
         if (httpCode > 0) {
-            String responsePayload = _httpClient.getString();
-            // Store the raw response
-            _tcRawResponse = responsePayload;
+            // In direct mode a successful body is parsed from the socket, error bodies are still buffered
+            bool parseDirect = _directResponseParsing && httpCode == HTTP_CODE_OK;
+            bool bodyComplete = true;
+            String responsePayload = "";
+            if (!parseDirect) {
+                responsePayload = _httpClient.getString();
+                // Store the raw response
+                _tcRawResponse = responsePayload;
+            }
             
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("---------- AI Tool Calls Response ----------");
-            Serial.println("HTTP Code: " + String(httpCode));
-            Serial.println("Payload: " + responsePayload);
-            Serial.println("--------------------------------------------");
-            #endif
+            AI_API_LOGD("Tool calls response: HTTP %d", httpCode);
+            if (!parseDirect) AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Payload", responsePayload.c_str(), responsePayload.length());
             
             if (httpCode == HTTP_CODE_OK) {
                 // Parse response using the platform handler's tool calls response parser
-                String responseContent = _platformHandler->parseToolCallsResponseBody(
-                    responsePayload, _lastError, _respDoc);
+                uint32_t parseStart = micros();
+                String responseContent = parseDirect
+                    ? _parseResponseStream(true, _tcRawResponse, bodyComplete)
+                    : _platformHandler->parseToolCallsResponseBody(responsePayload, _lastError, _respDoc);
+                _metrics.parseUs += micros() - parseStart;
                 
                 if (responseContent.isEmpty() && _lastError.isEmpty()) {
                     _lastError = "Handler failed to parse tool calls response.";
@@ -479,20 +1225,21 @@ String ESP32_AI_Connect::tcChat(const String& tcUserMessage) {
                         _lastAssistantToolCallsJson = responseContent;
                     } else {
                         _lastMessageWasToolCalls = false;
+                        // Answered without tools: remember the exchange
+                        if (_chatHistory.isEnabled()) _chatHistory.addExchange(tcUserMessage, responseContent);
                     }
                 }
                 
-                _httpClient.end(); // Clean up connection
+                _endConnection(!bodyComplete); // Release the request (keeps the socket if reuse is enabled)
                 return responseContent;
             } else {
                 _lastError = "HTTP Error: " + String(httpCode) + " - Response: " + responsePayload;
             }
+            _endConnection();
         } else {
             _lastError = String("HTTP Request Failed: ") + _httpClient.errorToString(httpCode).c_str();
+            _endConnection(true); // Transport error: the socket can't be trusted anymore
         }
-        _httpClient.end(); // Clean up connection
-    } else {
-        _lastError = "HTTP Client failed to begin connection to: " + url;
     }
     
     return ""; // Return empty string on error
@@ -500,6 +1247,14 @@ String ESP32_AI_Connect::tcChat(const String& tcUserMessage) {
 
 // --- Reply to Tool Calls with Results ---
 String ESP32_AI_Connect::tcReply(const String& toolResultsJson) {
+    if (_rejectDuringAgent()) return "";
+    _metricsBegin(RequestType::TC_REPLY);
+    String reply = _tcReplyRequest(toolResultsJson);
+    _metricsEnd(!reply.isEmpty());
+    return reply;
+}
+
+String ESP32_AI_Connect::_tcReplyRequest(const String& toolResultsJson) {
     _lastError = "";
     _tcRawResponse = ""; // Clear previous raw response
     _tcReplyResponseCode = 0; // Reset response code
@@ -515,6 +1270,9 @@ String ESP32_AI_Connect::tcReply(const String& toolResultsJson) {
         _lastError = "Tool calls not set up. Call setTCTools() first.";
         return "";
     }
+    if (_tcToolsJson.isEmpty() && !_buildTCToolsJson()) {
+        return ""; // _lastError already set
+    }
     
     // Check if the last message was a tool call
     if (!_lastMessageWasToolCalls) {
@@ -574,51 +1332,56 @@ String ESP32_AI_Connect::tcReply(const String& toolResultsJson) {
     }
     
     // Build request body using the platform handler's tool calls follow-up method
-    String requestBody = _platformHandler->buildToolCallsFollowUpRequestBody(
-        _modelName, _tcToolsArray, _tcToolsArraySize,
+    uint32_t buildStart = micros();
+    bool bodyBuilt = _platformHandler->buildToolCallsFollowUpRequestBody(
+        _modelName, _tcToolsJson,
         _tcSystemRole, _tcToolChoice,
         _lastUserMessage, _lastAssistantToolCallsJson,
-        toolResultsJson, _tcFollowUpMaxToken, _tcFollowUpToolChoice, _reqDoc);
+        toolResultsJson, _tcFollowUpMaxToken, _tcFollowUpToolChoice, _reqDoc,
+        _historyForRequest());
+    _metrics.buildUs += micros() - buildStart;
     
-    if (requestBody.isEmpty()) {
+    if (!bodyBuilt) {
         if (_lastError.isEmpty()) _lastError = "Failed to build tool calls follow-up request body.";
         return "";
     }
     
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.println("---------- AI Tool Calls Follow-up Request ----------");
-    Serial.println("URL: " + url);
-    Serial.println("Body: " + requestBody);
-    Serial.println("--------------------------------------------------");
-    #endif
+    return _tcFollowUpRequest(url);
+}
+
+// Sends the follow-up request in _reqDoc and tracks the tool calls of its response
+String ESP32_AI_Connect::_tcFollowUpRequest(const String& url) {
+    AI_API_LOGD("Tool calls follow-up request: %s", url.c_str());
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Body", _reqDoc);
     
     // Perform HTTP POST Request
-    _httpClient.end(); // Ensure previous connection is closed
-    if (_httpClient.begin(_wifiClient, url)) {
-        _platformHandler->setHeaders(_httpClient, _apiKey);
-        _httpClient.setTimeout(AI_API_HTTP_TIMEOUT_MS);
-        int httpCode = _httpClient.POST(requestBody);
-        
+    int httpCode = _sendPostRequest(url);
+    if (httpCode != 0) {
         // Store the HTTP response code
         _tcReplyResponseCode = httpCode;
         
         // Handle Response
         if (httpCode > 0) {
-            String responsePayload = _httpClient.getString();
-            // Store the raw response
-            _tcRawResponse = responsePayload;
+            // In direct mode a successful body is parsed from the socket, error bodies are still buffered
+            bool parseDirect = _directResponseParsing && httpCode == HTTP_CODE_OK;
+            bool bodyComplete = true;
+            String responsePayload = "";
+            if (!parseDirect) {
+                responsePayload = _httpClient.getString();
+                // Store the raw response
+                _tcRawResponse = responsePayload;
+            }
             
-            #ifdef ENABLE_DEBUG_OUTPUT
-            Serial.println("---------- AI Tool Calls Follow-up Response ----------");
-            Serial.println("HTTP Code: " + String(httpCode));
-            Serial.println("Payload: " + responsePayload);
-            Serial.println("-----------------------------------------------------");
-            #endif
+            AI_API_LOGD("Tool calls follow-up response: HTTP %d", httpCode);
+            if (!parseDirect) AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Payload", responsePayload.c_str(), responsePayload.length());
             
             if (httpCode == HTTP_CODE_OK) {
                 // Parse response - same as regular tool calls
-                String responseContent = _platformHandler->parseToolCallsResponseBody(
-                    responsePayload, _lastError, _respDoc);
+                uint32_t parseStart = micros();
+                String responseContent = parseDirect
+                    ? _parseResponseStream(true, _tcRawResponse, bodyComplete)
+                    : _platformHandler->parseToolCallsResponseBody(responsePayload, _lastError, _respDoc);
+                _metrics.parseUs += micros() - parseStart;
                 
                 if (responseContent.isEmpty() && _lastError.isEmpty()) {
                     _lastError = "Handler failed to parse tool calls follow-up response.";
@@ -633,32 +1396,202 @@ String ESP32_AI_Connect::tcReply(const String& toolResultsJson) {
                     } else {
                         // If the response is a regular message, mark that we can't do more follow-ups
                         _lastMessageWasToolCalls = false;
+                        // Tool rounds are not stored, only the question and the final answer
+                        if (_chatHistory.isEnabled()) _chatHistory.addExchange(_lastUserMessage, responseContent);
                     }
                 }
                 
-                _httpClient.end(); // Clean up connection
+                _endConnection(!bodyComplete); // Release the request (keeps the socket if reuse is enabled)
                 return responseContent;
             } else {
                 _lastError = "HTTP Error: " + String(httpCode) + " - Response: " + responsePayload;
             }
+            _endConnection();
         } else {
             _lastError = String("HTTP Request Failed: ") + _httpClient.errorToString(httpCode).c_str();
+            _endConnection(true); // Transport error: the socket can't be trusted anymore
         }
-        _httpClient.end(); // Clean up connection
-    } else {
-        _lastError = "HTTP Client failed to begin connection to: " + url;
     }
     
     return ""; // Return empty string on error
 }
-#endif // ENABLE_TOOL_CALLS
 
-// --- Main Chat Function (Delegates to Handler) ---
-String ESP32_AI_Connect::chat(const String& userMessage) {
+// --- Tool Handlers ---
+bool ESP32_AI_Connect::setTCToolHandler(const String& name, ToolHandler handler, bool parallel) {
+    if (!handler) {
+        _tcToolRegistry.remove(name);
+        return true;
+    }
+    if (!_tcToolRegistry.add(name, handler, parallel)) {
+        _lastError = name.isEmpty() ? "Tool handler needs a tool name."
+                                    : "Too many tool handlers. Maximum: " + String(AI_API_TOOL_HANDLERS_MAX);
+        return false;
+    }
+    return true;
+}
+
+String ESP32_AI_Connect::tcRunTools() {
+    if (_rejectDuringAgent()) return "";
+    _lastError = "";
+    _tcToolResults = "";
+    
+    if (!_lastMessageWasToolCalls) {
+        _lastError = "No tool calls to run. Call tcChat first and ensure it returns tool calls.";
+        return "";
+    }
+    
+    _tcToolResults = _tcToolRegistry.execute(_lastAssistantToolCallsJson, _lastError);
+    if (_tcToolResults.isEmpty()) {
+        return ""; // _lastError already set
+    }
+    return tcReply(_tcToolResults);
+}
+
+String ESP32_AI_Connect::getTCToolResults() const { return _tcToolResults; }
+
+uint32_t ESP32_AI_Connect::getTCToolRunTime() const { return _tcToolRegistry.getLastExecutionMs(); }
+
+// --- Agent Loop ---
+String ESP32_AI_Connect::tcAgentChat(const String& tcUserMessage, uint8_t maxSteps, uint32_t maxTokens) {
+    if (_rejectDuringAgent()) return "";
+    _tcAgentRunning = true;
+    String response = _tcAgentRun(tcUserMessage, maxSteps, maxTokens);
+    _tcAgentRunning = false;
+    return response;
+}
+
+String ESP32_AI_Connect::_tcAgentRun(const String& tcUserMessage, uint8_t maxSteps, uint32_t maxTokens) {
+    _tcAgentSteps = 0;
+    _tcAgentTokens = 0;
+    
+    _metricsBegin(RequestType::TC_CHAT);
+    String response = _tcChatRequest(tcUserMessage);
+    _metricsEnd(!response.isEmpty());
+    if (response.isEmpty()) {
+        return ""; // _lastError already set
+    }
+    _tcAgentTokens += getTotalTokens();
+    
+    while (_lastMessageWasToolCalls) {
+        if (_tcAgentSteps >= maxSteps) {
+            _lastError = "Agent stopped: still calling tools after " + String(maxSteps) + " steps.";
+            return "";
+        }
+        if (maxTokens > 0 && _tcAgentTokens >= maxTokens) {
+            _lastError = "Agent stopped: token budget used up (" + String(_tcAgentTokens) + " of " +
+                         String(maxTokens) + " tokens).";
+            return "";
+        }
+        _tcAgentSteps++;
+        
+        _tcToolResults = _tcToolRegistry.execute(_lastAssistantToolCallsJson, _lastError);
+        if (_tcToolResults.isEmpty()) {
+            return ""; // _lastError already set
+        }
+        
+        // The first round builds the follow-up body in _reqDoc, later rounds extend it
+        _metricsBegin(RequestType::TC_REPLY);
+        response = _tcAgentSteps == 1 ? _tcReplyRequest(_tcToolResults)
+                                      : _tcAgentRoundRequest(_tcToolResults);
+        _metricsEnd(!response.isEmpty());
+        if (response.isEmpty()) {
+            return ""; // _lastError already set
+        }
+        _tcAgentTokens += getTotalTokens();
+        AI_API_LOGD("Agent step %u done, %u tokens so far", (unsigned)_tcAgentSteps, (unsigned)_tcAgentTokens);
+    }
+    
+    return response;
+}
+
+uint8_t ESP32_AI_Connect::getTCAgentSteps() const { return _tcAgentSteps; }
+
+uint32_t ESP32_AI_Connect::getTCAgentTokens() const { return _tcAgentTokens; }
+
+String ESP32_AI_Connect::_tcAgentRoundRequest(const String& toolResultsJson) {
+    _lastError = "";
+    _tcRawResponse = ""; // Clear previous raw response
+    _tcReplyResponseCode = 0; // Reset response code
+    
+    String url = _platformHandler->getEndpoint(_modelName, _apiKey, _customEndpoint);
+    if (url.isEmpty()) {
+        _lastError = "Failed to get endpoint URL from platform handler.";
+        return "";
+    }
+    if (toolResultsJson.length() > AI_API_REQ_JSON_DOC_SIZE / 2) {
+        _lastError = "Tool results JSON too large. Maximum size: " + 
+                    String(AI_API_REQ_JSON_DOC_SIZE / 2) + " bytes.";
+        return "";
+    }
+    
+    // _reqDoc still holds the previous round's request: add this round to it
+    uint32_t buildStart = micros();
+    bool appended = _platformHandler->appendToolCallsRound(_lastAssistantToolCallsJson, toolResultsJson, _reqDoc);
+    _metrics.buildUs += micros() - buildStart;
+    
+    if (!appended) {
+        _lastError = "Failed to add the tool calls round to the follow-up request.";
+        return "";
+    }
+    if (_reqDoc.overflowed()) {
+        _lastError = "Not enough memory for the follow-up request of round " + String(_tcAgentSteps) + ".";
+        return "";
+    }
+    
+    return _tcFollowUpRequest(url);
+}
+#endif // ENABLE_TOOL_CALLS
+
+// --- Main Chat Function (Delegates to Handler) ---
+String ESP32_AI_Connect::chat(const String& userMessage) {
+    if (_rejectDuringAgent()) return "";
+    _metricsBegin(RequestType::CHAT);
+    String reply = _chatRequest(userMessage);
+    _metricsEnd(!reply.isEmpty());
+    return reply;
+}
+
+size_t ESP32_AI_Connect::chatBatch(const String* prompts, String* replies, size_t count, String* errors) {
+    if (_rejectDuringAgent()) return 0;
+    if (count > 0 && (prompts == nullptr || replies == nullptr)) {
+        _lastError = "Prompts or replies array is null";
+        return 0;
+    }
+    
+    // One connection for the whole batch, so only the first prompt pays for the handshake
+    bool connectionReuse = _connectionReuse;
+    _connectionReuse = true;
+    _historyPaused = true;
+    
+    uint32_t start = millis();
+    size_t answered = 0;
+    String lastFailure = "";
+    for (size_t i = 0; i < count; i++) {
+        replies[i] = chat(prompts[i]);
+        if (!replies[i].isEmpty()) {
+            answered++;
+        } else {
+            lastFailure = _lastError;
+        }
+        if (errors != nullptr) errors[i] = replies[i].isEmpty() ? _lastError : String("");
+    }
+    
+    _historyPaused = false;
+    if (!connectionReuse) setConnectionReuse(false); // Closes the connection again
+    _lastError = lastFailure;
+    AI_API_LOGD("Batch: %u of %u prompts answered in %u ms", (unsigned)answered, (unsigned)count,
+                (unsigned)(millis() - start));
+    return answered;
+}
+
+String ESP32_AI_Connect::_chatRequest(const String& userMessage) {
     _lastError = "";
     String responseContent = "";
     _chatRawResponse = ""; // Clear previous raw response
     _chatResponseCode = 0; // Reset response code
+#ifdef ENABLE_RESPONSE_CACHE
+    _lastResponseCached = false;
+#endif
 
     if (!_platformHandler) {
         _lastError = "Platform handler not initialized. Call begin() with a supported platform.";
@@ -672,68 +1605,90 @@ String ESP32_AI_Connect::chat(const String& userMessage) {
         return "";
     }
 
+#ifdef ENABLE_RESPONSE_CACHE
+    // Serve a repeated deterministic request locally
+    bool cacheable = _responseCacheUsable();
+    uint64_t cacheKey = 0;
+    if (cacheable) {
+        cacheKey = _responseCacheKey(url, userMessage);
+        String finishReason = "";
+        if (_responseCache.lookup(cacheKey, responseContent, finishReason)) {
+            _lastResponseCached = true;
+            _chatResponseCode = HTTP_CODE_OK;
+            _platformHandler->setResultMetadata(finishReason, 0); // No tokens were used
+            AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Response (cached)", responseContent.c_str(), responseContent.length());
+            return responseContent;
+        }
+    }
+#endif
+
     // Build request body using handler and shared JSON doc
     // Using values set by setChatSystemRole, setChatTemperature, setChatMaxTokens, and setChatParameters
-    String requestBody = _platformHandler->buildRequestBody(_modelName, _systemRole,
+    uint32_t buildStart = micros();
+    bool bodyBuilt = _platformHandler->buildRequestBody(_modelName, _systemRole,
                                                             _temperature, _maxTokens,
-                                                            userMessage, _reqDoc, _chatCustomParams);
-    if (requestBody.isEmpty()) {
+                                                            userMessage, _reqDoc, _chatCustomParamsDoc.as<JsonObjectConst>(),
+                                                            _historyForRequest());
+    _metrics.buildUs += micros() - buildStart;
+    if (!bodyBuilt) {
         // Assume handler sets _lastError or check its return value pattern if defined
         if (_lastError.isEmpty()) _lastError = "Failed to build request body (handler returned empty).";
         return "";
     }
-    #ifdef ENABLE_DEBUG_OUTPUT
-     // --- Debug Start: Request ---
-     Serial.println("---------- AI Request ----------");
-     Serial.println("URL: " + url);
-     Serial.println("Body: " + requestBody);
-     Serial.println("-------------------------------");
-     // --- Debug End: Request ---
-    #endif // ENABLE_DEBUG_OUTPUT
+    AI_API_LOGD("Request: %s", url.c_str());
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Body", _reqDoc);
 
 
     // --- Perform HTTP POST Request ---
-    _httpClient.end(); // Ensure previous connection is closed
-    if (_httpClient.begin(_wifiClient, url)) {
-        _platformHandler->setHeaders(_httpClient, _apiKey); // Set headers via handler
-        _httpClient.setTimeout(AI_API_HTTP_TIMEOUT_MS); // Use configured timeout
-        int httpCode = _httpClient.POST(requestBody);
-        
+    int httpCode = _sendPostRequest(url);
+    if (httpCode != 0) {
         // Store the HTTP response code
         _chatResponseCode = httpCode;
 
         // --- Handle Response ---
         if (httpCode > 0) {
-            String responsePayload = _httpClient.getString();
-            // Store the raw response
-            _chatRawResponse = responsePayload;
+            // In direct mode a successful body is parsed from the socket, error bodies are still buffered
+            bool parseDirect = _directResponseParsing && httpCode == HTTP_CODE_OK;
+            bool bodyComplete = true;
+            String responsePayload = "";
+            if (!parseDirect) {
+                responsePayload = _httpClient.getString();
+                // Store the raw response
+                _chatRawResponse = responsePayload;
+            }
             
-            #ifdef ENABLE_DEBUG_OUTPUT
-            // --- Debug Start: Response ---
-            Serial.println("---------- AI Response ----------");
-            Serial.println("HTTP Code: " + String(httpCode));
-            Serial.println("Payload: " + responsePayload);
-            Serial.println("--------------------------------");
-            // --- Debug End: Response ---
-            #endif // ENABLE_DEBUG_OUTPUT
+            AI_API_LOGD("Response: HTTP %d", httpCode);
+            if (!parseDirect) AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Payload", responsePayload.c_str(), responsePayload.length());
 
             if (httpCode == HTTP_CODE_OK) {
                 // Parse response using handler and shared JSON doc
                 // Handler's parseResponseBody should set _lastError on failure
-                responseContent = _platformHandler->parseResponseBody(responsePayload, _lastError, _respDoc);
+                uint32_t parseStart = micros();
+                if (parseDirect) {
+                    responseContent = _parseResponseStream(false, _chatRawResponse, bodyComplete);
+                } else {
+                    responseContent = _platformHandler->parseResponseBody(responsePayload, _lastError, _respDoc);
+                }
+                _metrics.parseUs += micros() - parseStart;
                 // If responseContent is "" but _lastError is also "", handler failed silently
                 if(responseContent.isEmpty() && _lastError.isEmpty()){
                     _lastError = "Handler failed to parse response or returned empty content.";
+                } else if (!responseContent.isEmpty() && _historyForRequest() != nullptr) {
+                    _chatHistory.addExchange(userMessage, responseContent);
+                }
+#ifdef ENABLE_RESPONSE_CACHE
+                if (cacheable && !responseContent.isEmpty()) {
+                    _responseCache.store(cacheKey, responseContent, _platformHandler->getFinishReason());
                 }
+#endif
             } else {
                 _lastError = "HTTP Error: " + String(httpCode) + " - Response: " + responsePayload;
             }
+            _endConnection(!bodyComplete); // Release the request (keeps the socket if reuse is enabled)
         } else {
             _lastError = String("HTTP Request Failed: ") + _httpClient.errorToString(httpCode).c_str();
+            _endConnection(true); // Transport error: the socket can't be trusted anymore
         }
-        _httpClient.end(); // Clean up connection
-    } else {
-         _lastError = "HTTP Client failed to begin connection to: " + url;
     }
 
 
@@ -756,22 +1711,34 @@ void ESP32_AI_Connect::_releaseStreamLock() const {
 }
 
 bool ESP32_AI_Connect::_setStreamState(StreamState newState) {
-    if (!_acquireStreamLock(100)) return false;
+    StreamState oldState = _streamState.exchange(newState);
     
-    StreamState oldState = _streamState;
-    _streamState = newState;
+    AI_API_LOGV("Stream state: %d -> %d", (int)oldState, (int)newState);
     
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.printf("Stream state: %d -> %d\n", (int)oldState, (int)newState);
-    #endif
-    
-    _releaseStreamLock();
     return true;
 }
 
 ESP32_AI_Connect::StreamState ESP32_AI_Connect::_getStreamState() const {
-    // Atomic read of volatile variable - no lock needed for simple read
-    return _streamState;
+    return _streamState.load();
+}
+
+void ESP32_AI_Connect::_publishStreamStats(uint32_t chunkCount, uint32_t totalBytes,
+                                           uint32_t startTime, int responseCode) {
+    // Seqlock write: odd sequence while the fields change, even again when done.
+    // The odd value is claimed with a compare-exchange, so only one writer holds it.
+    uint32_t seq = _streamStatsSeq.load(std::memory_order_relaxed);
+    while ((seq & 1) || !_streamStatsSeq.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed)) {
+        if (seq & 1) {
+            taskYIELD(); // Another writer is publishing
+            seq = _streamStatsSeq.load(std::memory_order_relaxed);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    _streamChunkCount.store(chunkCount, std::memory_order_relaxed);
+    _streamTotalBytes.store(totalBytes, std::memory_order_relaxed);
+    _streamStartTime.store(startTime, std::memory_order_relaxed);
+    _streamResponseCode.store(responseCode, std::memory_order_relaxed);
+    _streamStatsSeq.store(seq + 2, std::memory_order_release);
 }
 
 // --- Streaming Chat Implementation ---
@@ -803,13 +1770,16 @@ bool ESP32_AI_Connect::setStreamChatParameters(String userParameterJsonStr) {
     if (userParameterJsonStr.isEmpty()) {
         if (_acquireStreamLock(100)) {
             _streamCustomParams = "";
+            _streamCustomParamsDoc.clear();
             _releaseStreamLock();
         }
         return true;
     }
     
     // Validate JSON format
-    JsonDocument tempDoc; // Temporary document for validation
+    // Temporary document for validation, on the documents' allocator: moved in below, it
+    // brings that allocator along (see _rebindDocument)
+    JsonDocument tempDoc = _allocator != nullptr ? JsonDocument(_allocator) : JsonDocument();
     DeserializationError error = deserializeJson(tempDoc, userParameterJsonStr);
     
     if (error) {
@@ -817,9 +1787,10 @@ bool ESP32_AI_Connect::setStreamChatParameters(String userParameterJsonStr) {
         return false;
     }
     
-    // Store validated JSON string with thread safety
+    // Store validated JSON string and its parsed form with thread safety
     if (_acquireStreamLock(100)) {
         _streamCustomParams = userParameterJsonStr;
+        _streamCustomParamsDoc = std::move(tempDoc);
         _releaseStreamLock();
     }
     return true;
@@ -853,6 +1824,67 @@ int ESP32_AI_Connect::getStreamChatMaxTokens() const {
     return -1;
 }
 
+void ESP32_AI_Connect::setStreamChatCoalescing(size_t minBytes, uint32_t maxDelayMs, StreamBoundary boundary) {
+    if (_acquireStreamLock(100)) {
+        _streamCoalesceBytes = minBytes;
+        _streamCoalesceMs = maxDelayMs;
+        _streamCoalesceBoundary = boundary;
+        _releaseStreamLock();
+    }
+}
+
+size_t ESP32_AI_Connect::getStreamChatCoalescingBytes() const { return _streamCoalesceBytes; }
+
+uint32_t ESP32_AI_Connect::getStreamChatCoalescingDelay() const { return _streamCoalesceMs; }
+
+ESP32_AI_Connect::StreamBoundary ESP32_AI_Connect::getStreamChatCoalescingBoundary() const {
+    return _streamCoalesceBoundary;
+}
+
+void ESP32_AI_Connect::setStreamChatBudget(size_t maxBytes, uint32_t maxTimeMs, size_t maxTokens) {
+    if (_acquireStreamLock(100)) {
+        _streamBudgetBytes = maxBytes;
+        _streamBudgetMs = maxTimeMs;
+        _streamBudgetTokens = maxTokens;
+        _releaseStreamLock();
+    }
+}
+
+bool ESP32_AI_Connect::addStreamChatStopString(const String& stop) {
+    if (stop.isEmpty()) {
+        _lastError = "Stop string is empty";
+        return false;
+    }
+    if (!_acquireStreamLock(100)) {
+        _lastError = "Failed to acquire stream lock (timeout)";
+        return false;
+    }
+    bool added = _streamStopStringCount < AI_API_STREAM_STOP_STRINGS_MAX;
+    if (added) {
+        _streamStopStrings[_streamStopStringCount++] = stop;
+    } else {
+        _lastError = "Too many stop strings (AI_API_STREAM_STOP_STRINGS_MAX is " + String(AI_API_STREAM_STOP_STRINGS_MAX) + ")";
+    }
+    _releaseStreamLock();
+    return added;
+}
+
+void ESP32_AI_Connect::clearStreamChatStopStrings() {
+    if (_acquireStreamLock(100)) {
+        for (size_t i = 0; i < _streamStopStringCount; i++) _streamStopStrings[i] = "";
+        _streamStopStringCount = 0;
+        _releaseStreamLock();
+    }
+}
+
+size_t ESP32_AI_Connect::getStreamChatBudgetBytes() const { return _streamBudgetBytes; }
+
+uint32_t ESP32_AI_Connect::getStreamChatBudgetTime() const { return _streamBudgetMs; }
+
+size_t ESP32_AI_Connect::getStreamChatBudgetTokens() const { return _streamBudgetTokens; }
+
+size_t ESP32_AI_Connect::getStreamChatStopStringCount() const { return _streamStopStringCount; }
+
 String ESP32_AI_Connect::getStreamChatParameters() const {
     if (_acquireStreamLock(100)) {
         String result = _streamCustomParams;
@@ -869,10 +1901,10 @@ bool ESP32_AI_Connect::isStreaming() const {
 }
 
 void ESP32_AI_Connect::stopStreaming() {
+    // Compare-and-swap: never turns a stream that just finished back into STOPPING
     StreamState currentState = _getStreamState();
-    
-    if (currentState == StreamState::ACTIVE || currentState == StreamState::STARTING) {
-        _setStreamState(StreamState::STOPPING);
+    while (currentState == StreamState::ACTIVE || currentState == StreamState::STARTING) {
+        if (_streamState.compare_exchange_weak(currentState, StreamState::STOPPING)) break;
     }
 }
 
@@ -882,16 +1914,39 @@ ESP32_AI_Connect::StreamState ESP32_AI_Connect::getStreamState() const {
 
 // Enhanced streaming status methods
 uint32_t ESP32_AI_Connect::getStreamChunkCount() const {
-    return _streamChunkCount; // Atomic read of volatile
+    return _streamChunkCount.load(std::memory_order_relaxed);
 }
 
 uint32_t ESP32_AI_Connect::getStreamTotalBytes() const {
-    return _streamTotalBytes; // Atomic read of volatile
+    return _streamTotalBytes.load(std::memory_order_relaxed);
 }
 
 uint32_t ESP32_AI_Connect::getStreamElapsedTime() const {
-    if (_streamStartTime == 0) return 0;
-    return millis() - _streamStartTime;
+    uint32_t startTime = _streamStartTime.load(std::memory_order_relaxed);
+    if (startTime == 0) return 0;
+    return millis() - startTime;
+}
+
+ESP32_AI_Connect::StreamStats ESP32_AI_Connect::getStreamStats() const {
+    StreamStats stats;
+    uint32_t seqBefore, seqAfter, startTime;
+    uint32_t attempts = 0;
+    do {
+        // A writer preempted mid-update on this core only finishes if the reader sleeps
+        if (attempts++ >= 16) vTaskDelay(1);
+        // Seqlock read: retry if the writer was active before or during the copy
+        seqBefore = _streamStatsSeq.load(std::memory_order_acquire);
+        stats.chunkCount = _streamChunkCount.load(std::memory_order_relaxed);
+        stats.totalBytes = _streamTotalBytes.load(std::memory_order_relaxed);
+        startTime = _streamStartTime.load(std::memory_order_relaxed);
+        stats.responseCode = _streamResponseCode.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seqAfter = _streamStatsSeq.load(std::memory_order_relaxed);
+    } while ((seqBefore & 1) || seqBefore != seqAfter);
+    
+    stats.state = _getStreamState();
+    stats.elapsedMs = (startTime == 0) ? 0 : millis() - startTime;
+    return stats;
 }
 
 String ESP32_AI_Connect::getStreamChatRawResponse() const {
@@ -904,34 +1959,41 @@ String ESP32_AI_Connect::getStreamChatRawResponse() const {
 }
 
 int ESP32_AI_Connect::getStreamChatResponseCode() const {
-    if (_acquireStreamLock(100)) {
-        int code = _streamResponseCode;
-        _releaseStreamLock();
-        return code;
-    }
-    return 0;
+    return _streamResponseCode.load(std::memory_order_relaxed);
 }
 
 void ESP32_AI_Connect::streamChatReset() {
+    // The stream statistics belong to a running stream; leave it alone
+    StreamState state = _getStreamState();
+    if (state != StreamState::IDLE && state != StreamState::ERROR) {
+        AI_API_LOGW("streamChatReset() ignored while a stream is running");
+        return;
+    }
     if (!_acquireStreamLock(1000)) return;
     
     _streamState = StreamState::IDLE;
     _streamCallback = nullptr;
     _streamRawResponse = "";
-    _streamResponseCode = 0;
-    _streamChunkCount = 0;
-    _streamTotalBytes = 0;
-    _streamStartTime = 0;
+    _publishStreamStats(0, 0, 0, 0);
     _streamSystemRole = "";
     _streamTemperature = -1.0;
     _streamMaxTokens = -1;
     _streamCustomParams = "";
+    _streamCustomParamsDoc.clear();
+    _streamCoalesceBytes = 0;
+    _streamCoalesceMs = 0;
+    _streamCoalesceBoundary = StreamBoundary::NONE;
+    _streamBudgetBytes = 0;
+    _streamBudgetMs = 0;
+    _streamBudgetTokens = 0;
+    for (size_t i = 0; i < _streamStopStringCount; i++) _streamStopStrings[i] = "";
+    _streamStopStringCount = 0;
     
     _releaseStreamLock();
 }
 
-// Enhanced thread-safe streaming method
-bool ESP32_AI_Connect::streamChat(const String& userMessage, StreamCallback callback) {
+// Takes the stream for a new request: only one can run at a time
+bool ESP32_AI_Connect::_claimStream(const StreamCallback& callback) {
     // Quick state check without lock first
     if (_getStreamState() != StreamState::IDLE) {
         _lastError = "Streaming operation already in progress";
@@ -958,23 +2020,30 @@ bool ESP32_AI_Connect::streamChat(const String& userMessage, StreamCallback call
         return false;
     }
     
-    if (!callback) {
-        _lastError = "Callback function is null";
-        _releaseStreamLock();
-        return false;
-    }
-    
     // Initialize streaming state
     _streamState = StreamState::STARTING;
     _streamCallback = callback;
-    _streamChunkCount = 0;
-    _streamTotalBytes = 0;
-    _streamStartTime = millis();
+    _publishStreamStats(0, 0, millis(), 0);
     _streamRawResponse = "";
-    _streamResponseCode = 0;
     _lastError = "";
     
     _releaseStreamLock();
+    return true;
+}
+
+// Enhanced thread-safe streaming method
+bool ESP32_AI_Connect::streamChat(const String& userMessage, StreamCallback callback) {
+    if (_rejectDuringAgent()) return false;
+    if (!callback) {
+        _lastError = "Callback function is null";
+        return false;
+    }
+    if (!_claimStream(callback)) {
+        return false;
+    }
+    
+    // Metrics start once this call owns the stream, so a rejected call can't reset them
+    _metricsBegin(RequestType::STREAM_CHAT);
     
     // Get endpoint URL from handler - use streaming endpoint if available
     String url = _platformHandler->getStreamEndpoint(_modelName, _apiKey, _customEndpoint);
@@ -982,40 +2051,42 @@ bool ESP32_AI_Connect::streamChat(const String& userMessage, StreamCallback call
     if (url.isEmpty()) {
         _lastError = "Failed to get endpoint URL from platform handler";
         _setStreamState(StreamState::ERROR);
+        _metricsEnd(false);
         return false;
     }
 
-    // Build streaming request body using handler (get parameters safely)
-    String systemRole, customParams;
-    float temperature;
-    int maxTokens;
-    
+    // Build streaming request body using handler. The settings are used under the lock
+    // so the parsed custom parameters can be read in place instead of being copied.
+    bool bodyBuilt = false;
     if (_acquireStreamLock(100)) {
-        systemRole = _streamSystemRole;
-        temperature = _streamTemperature;
-        maxTokens = _streamMaxTokens;
-        customParams = _streamCustomParams;
+        uint32_t buildStart = micros();
+        bodyBuilt = _platformHandler->buildStreamRequestBody(_modelName, _streamSystemRole,
+                                                             _streamTemperature, _streamMaxTokens,
+                                                             userMessage, _reqDoc,
+                                                             _streamCustomParamsDoc.as<JsonObjectConst>(),
+                                                             _historyForRequest());
+        _metrics.buildUs += micros() - buildStart;
         _releaseStreamLock();
+    } else {
+        _lastError = "Failed to acquire stream lock (timeout)";
     }
-    
-    String requestBody = _platformHandler->buildStreamRequestBody(_modelName, systemRole,
-                                                                 temperature, maxTokens,
-                                                                 userMessage, _reqDoc, customParams);
-    if (requestBody.isEmpty()) {
+    if (!bodyBuilt) {
         if (_lastError.isEmpty()) _lastError = "Failed to build streaming request body";
         _setStreamState(StreamState::ERROR);
+        _metricsEnd(false);
         return false;
     }
 
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.println("---------- AI Streaming Request ----------");
-    Serial.println("URL: " + url);
-    Serial.println("Body: " + requestBody);
-    Serial.println("------------------------------------------");
-    #endif
+    AI_API_LOGD("Streaming request: %s", url.c_str());
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Body", _reqDoc);
 
     // Perform streaming setup (outside of lock to avoid blocking)
-    bool success = _processStreamResponse(url, requestBody);
+    String reply = "";
+    bool success = _processStreamResponse(url, _chatHistory.isEnabled() ? &reply : nullptr);
+    
+    if (success && !reply.isEmpty()) {
+        _chatHistory.addExchange(userMessage, reply);
+    }
     
     if (success) {
         // Successful completion (including user interruption)
@@ -1025,85 +2096,148 @@ bool ESP32_AI_Connect::streamChat(const String& userMessage, StreamCallback call
         _setStreamState(StreamState::ERROR);
     }
     
+    _metricsEnd(success);
     return success;
 }
 
 // Enhanced stream processing with thread safety and metrics
-bool ESP32_AI_Connect::_processStreamResponse(const String& url, const String& requestBody) {
-    // Clean up any previous connections first
-    _httpClient.end();
-    _wifiClient.stop();
-    delay(50); // Give time for cleanup
+bool ESP32_AI_Connect::_processStreamResponse(const String& url, String* reply, bool toolCalls) {
+    if (reply != nullptr) *reply = "";
     
-    // Start new connection
-    if (!_httpClient.begin(_wifiClient, url)) {
-        _lastError = "HTTP Client failed to begin connection to: " + url;
-        return false;
+    // Start the request, reusing a kept-alive connection when enabled
+    int httpCode = _sendPostRequest(url);
+    if (httpCode == 0) {
+        return false; // _lastError already set
     }
-
-    _platformHandler->setHeaders(_httpClient, _apiKey); // Set headers via handler
-    _httpClient.setTimeout(AI_API_HTTP_TIMEOUT_MS); // Use configured timeout
-    
-    int httpCode = _httpClient.POST(requestBody);
     
-    // Store HTTP response code safely
-    if (_acquireStreamLock(10)) {
-        _streamResponseCode = httpCode;
-        _releaseStreamLock();
-    }
+    // Publish the HTTP response code
+    uint32_t startTime = _streamStartTime.load(std::memory_order_relaxed);
+    _publishStreamStats(0, 0, startTime, httpCode);
 
-    if (httpCode <= 0) {
+    if (httpCode < 0) {
         _lastError = String("HTTP Request Failed: ") + _httpClient.errorToString(httpCode).c_str();
-        _httpClient.end();
-        _wifiClient.stop();
+        _endConnection(true);
         return false;
     }
 
     if (httpCode != HTTP_CODE_OK) {
         String responsePayload = _httpClient.getString();
         _lastError = "HTTP Error: " + String(httpCode) + " - Response: " + responsePayload;
-        _httpClient.end();
-        _wifiClient.stop();
+        _endConnection(); // Error body was fully read, the socket can be reused
         return false;
     }
 
-    #ifdef ENABLE_DEBUG_OUTPUT
-    Serial.println("---------- AI Streaming Response ----------");
-    Serial.println("HTTP Code: " + String(httpCode));
-    Serial.println("Reading stream...");
-    Serial.println("------------------------------------------");
-    #endif
+    AI_API_LOGD("Streaming response: HTTP %d, reading stream", httpCode);
 
     // Set state to active now that we're connected
     _setStreamState(StreamState::ACTIVE);
 
     // Process streaming response with enhanced metrics
-    Stream* stream = _httpClient.getStreamPtr();
+    WiFiClient* client = _httpClient.getStreamPtr();
+    if (client == nullptr || !_sseReader.begin()) {
+        _lastError = "Failed to allocate stream buffer";
+        _endConnection(true);
+        return false;
+    }
+    
+    // Finish reason and token counts are gathered across all chunks of this stream
+    _platformHandler->beginStream();
+    
+    // Snapshot the callback and coalescing settings once instead of locking per chunk
+    StreamCallback callback = nullptr;
+    size_t coalesceBytes = 0;
+    uint32_t coalesceMs = 0;
+    StreamBoundary coalesceBoundary = StreamBoundary::NONE;
+    StreamLimits limits;
+    uint32_t budgetMs = 0;
+    if (_acquireStreamLock(100)) {
+        callback = _streamCallback;
+        coalesceBytes = _streamCoalesceBytes;
+        coalesceMs = _streamCoalesceMs;
+        coalesceBoundary = _streamCoalesceBoundary;
+        budgetMs = _streamBudgetMs;
+        limits.maxBytes = _streamBudgetBytes;
+        limits.bytesReason = "max_bytes";
+        if (_streamBudgetTokens > 0 && (limits.maxBytes == 0 || _streamBudgetTokens * 4 < limits.maxBytes)) {
+            limits.maxBytes = _streamBudgetTokens * 4;
+            limits.bytesReason = "max_tokens";
+        }
+        for (size_t i = 0; i < _streamStopStringCount; i++) limits.stops[i] = _streamStopStrings[i];
+        limits.stopCount = _streamStopStringCount;
+        _releaseStreamLock();
+    }
+    bool limited = limits.maxBytes > 0 || limits.stopCount > 0;
+    String held = "";                // Content that may begin a stop string
+    size_t passedBytes = 0;          // Content let through the limits
+    const char* stopReason = nullptr; // Set when a budget or stop string ends the stream
+    bool coalescing = coalesceBytes > 0 || coalesceMs > 0 || coalesceBoundary != StreamBoundary::NONE;
+    String pending = "";             // Content buffered while coalescing
+    unsigned long pendingSince = 0;  // millis() when the oldest buffered content arrived
+    
     unsigned long lastChunkTime = millis();
     bool streamComplete = false;
     bool userInterrupted = false;
+    bool contentReceived = false;
     uint32_t localChunkCount = 0;
+    uint32_t localTotalBytes = 0;
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    size_t toolCallsDelivered = 0;
+#endif
     
-    while (_httpClient.connected() && _getStreamState() == StreamState::ACTIVE && 
-           !streamComplete && !userInterrupted) {
+    while (_getStreamState() == StreamState::ACTIVE && !streamComplete && !userInterrupted) {
         
-        if (stream->available()) {
-            String chunk = stream->readStringUntil('\n');
+        if (budgetMs > 0 && millis() - startTime >= budgetMs) {
+            // Out of time: what is buffered goes out as the final content, the held tail
+            // still within the byte limit
+            stopReason = "max_time";
+            String tail = "";
+            if (limited) _limitStreamContent(limits, tail, held, passedBytes, true);
+            if (reply != nullptr) *reply += tail;
+            _deliverStreamChunk(callback, pending + tail, true, localChunkCount);
+            pending = "";
+            break;
+        }
+        
+        const char* line = nullptr;
+        size_t lineLength = 0;
+        if (_sseReader.nextLine(line, lineLength)) {
             lastChunkTime = millis();
             localChunkCount++;
             
-            // Thread-safe update of raw response and metrics
-            if (_acquireStreamLock(10)) {
-                _streamRawResponse = chunk;
-                _streamTotalBytes += chunk.length();
-                _streamChunkCount = localChunkCount;
+            // Metrics are published lock-free, so no update is ever lost
+            localTotalBytes += lineLength;
+            _publishStreamStats(localChunkCount, localTotalBytes, startTime, httpCode);
+            
+            // The raw line still needs the mutex; it is only a "last line" view, so skip on contention
+            if (_acquireStreamLock(0)) {
+                _streamRawResponse = line;
                 _releaseStreamLock();
             }
             
+            // Only "data:" lines carry a payload; event names, comments and blank lines are skipped
+            size_t payloadLength = 0;
+            const char* payload = AI_API_SSE_Reader::dataPayload(line, lineLength, payloadLength);
+            if (payload == nullptr) {
+                continue;
+            }
+            
             // Process chunk with platform handler
             bool isComplete = false;
             String errorMsg = "";
-            String content = _platformHandler->processStreamChunk(chunk, isComplete, errorMsg);
+            uint32_t parseStart = micros();
+#ifdef ENABLE_STREAM_TOOL_CALLS
+            String content = toolCalls
+                ? _platformHandler->processToolCallsStreamChunk(payload, payloadLength, isComplete, errorMsg)
+                : _platformHandler->processStreamChunk(payload, payloadLength, isComplete, errorMsg);
+#else
+            String content = _platformHandler->processStreamChunk(payload, payloadLength, isComplete, errorMsg);
+#endif
+            _metrics.parseUs += micros() - parseStart;
+            _metricsSampleHeap();
+            if (!contentReceived && !content.isEmpty()) {
+                contentReceived = true;
+                _metrics.firstTokenMs = millis() - _metricsStartAt;
+            }
             
             if (!errorMsg.isEmpty()) {
                 _lastError = errorMsg;
@@ -1113,40 +2247,75 @@ bool ESP32_AI_Connect::_processStreamResponse(const String& url, const String& r
             if (isComplete) {
                 streamComplete = true;
             }
+            if (limited) {
+                stopReason = _limitStreamContent(limits, content, held, passedBytes, isComplete);
+            }
+            bool finalChunk = isComplete || stopReason != nullptr;
+            if (reply != nullptr) {
+                *reply += content;
+            }
             
-            // Create enhanced chunk info
-            StreamChunkInfo chunkInfo;
-            chunkInfo.content = content;
-            chunkInfo.isComplete = isComplete;
-            chunkInfo.chunkIndex = localChunkCount;
-            chunkInfo.totalBytes = _streamTotalBytes;
-            chunkInfo.elapsedMs = getStreamElapsedTime();
-            chunkInfo.errorMsg = errorMsg;
+            if (!content.isEmpty()) AI_API_LOGV("Stream chunk: %s", content.c_str());
             
-            // Call user callback with enhanced info
-            if (!content.isEmpty() || isComplete) {
-                // Get callback safely
-                StreamCallback callback = nullptr;
-                if (_acquireStreamLock(10)) {
-                    callback = _streamCallback;
-                    _releaseStreamLock();
+#ifdef ENABLE_STREAM_TOOL_CALLS
+            // Tool calls completed by this chunk; text that came before them goes first,
+            // also when it is still being coalesced or held back (a stop string can't span a tool call)
+            if (toolCalls && _platformHandler->getStreamToolCallsCompleted() > toolCallsDelivered) {
+                String text = pending + content + held;
+                if (!held.isEmpty()) {
+                    passedBytes += held.length(); // Fits: the byte limit is checked with held counted
+                    if (reply != nullptr) *reply += held;
+                    held = "";
                 }
-                
-                if (callback && !callback(chunkInfo)) {
+                pending = "";
+                content = "";
+                if (!text.isEmpty() && !_deliverStreamChunk(callback, text, false, localChunkCount)) {
+                    userInterrupted = true;
+                    break;
+                }
+                if (!_deliverStreamToolCalls(toolCallsDelivered)) {
                     userInterrupted = true;
                     break;
                 }
             }
+#endif
             
-            #ifdef ENABLE_DEBUG_OUTPUT
-            if (!content.isEmpty()) {
-                Serial.print("Stream chunk: ");
-                Serial.println(content);
+            if (coalescing) {
+                if (!content.isEmpty()) {
+                    if (pending.isEmpty()) pendingSince = millis();
+                    pending += content;
+                }
+                // The final callback carries everything still buffered
+                size_t flushLength = finalChunk ? pending.length()
+                    : _coalescedLength(pending, pendingSince, coalesceBytes, coalesceMs, coalesceBoundary);
+                if (flushLength == 0 && !finalChunk) {
+                    continue;
+                }
+                content = pending.substring(0, flushLength);
+                pending.remove(0, flushLength);
+                pendingSince = millis();
             }
-            #endif
-        } else {
+            
+            // Call user callback with enhanced info
+            if (!content.isEmpty() || finalChunk) {
+                if (!_deliverStreamChunk(callback, content, finalChunk, localChunkCount)) {
+                    userInterrupted = true;
+                    break;
+                }
+            }
+            if (stopReason != nullptr) {
+                AI_API_LOGD("Stream ended early (%s) after %u bytes", stopReason, (unsigned)passedBytes);
+                break;
+            }
+        } else if (_sseReader.fill(*client) == 0) {
+            // No complete line buffered and nothing new on the socket
+            if (!_httpClient.connected()) {
+                break;
+            }
+            
             // Check for timeout and state changes
-            if (millis() - lastChunkTime > STREAM_CHAT_CHUNK_TIMEOUT_MS) {
+            uint32_t idleMs = millis() - lastChunkTime;
+            if (idleMs > STREAM_CHAT_CHUNK_TIMEOUT_MS) {
                 _lastError = "Stream timeout: No data received within " + String(STREAM_CHAT_CHUNK_TIMEOUT_MS) + "ms";
                 break;
             }
@@ -1156,23 +2325,464 @@ bool ESP32_AI_Connect::_processStreamResponse(const String& url, const String& r
                 break;
             }
             
-            delay(10); // Yield to other tasks
+            // Sleep until the socket has data; the slice bounds how long stopStreaming() waits
+            uint32_t waitMs = STREAM_CHAT_CHUNK_TIMEOUT_MS - idleMs + 1;
+            if (waitMs > STREAM_CHAT_WAIT_SLICE_MS) waitMs = STREAM_CHAT_WAIT_SLICE_MS;
+            if (budgetMs > 0) {
+                uint32_t usedMs = millis() - startTime;
+                if (usedMs < budgetMs && waitMs > budgetMs - usedMs) waitMs = budgetMs - usedMs;
+            }
+            
+            // Coalesced content must not wait longer than its delay limit
+            if (coalesceMs > 0 && !pending.isEmpty()) {
+                uint32_t bufferedMs = millis() - pendingSince;
+                if (bufferedMs >= coalesceMs) {
+                    String content = pending;
+                    pending = "";
+                    if (!_deliverStreamChunk(callback, content, false, localChunkCount)) {
+                        userInterrupted = true;
+                        break;
+                    }
+                    continue;
+                }
+                if (waitMs > coalesceMs - bufferedMs) waitMs = coalesceMs - bufferedMs;
+            }
+            _wifiClient.waitForData(waitMs);
         }
     }
     
-    // Comprehensive cleanup
-    _httpClient.end();
-    _wifiClient.stop();
-    delay(100); // Give extra time for connection cleanup
+    // Stream ended early (error or closed connection): still hand over buffered content
+    if (!userInterrupted && !streamComplete && stopReason == nullptr && !(pending + held).isEmpty()) {
+        String tail = "";
+        if (limited) _limitStreamContent(limits, tail, held, passedBytes, true);
+        if (reply != nullptr) *reply += tail;
+        _deliverStreamChunk(callback, pending + tail, false, localChunkCount);
+    }
+    
+    _sseReader.end();
+    _platformHandler->endStream();
+    if (stopReason != nullptr && !streamComplete) {
+        _platformHandler->setFinishReason(stopReason);
+    }
+    
+    // An event stream is not drained to its end, so the socket is always closed here.
+    // The next request opens a fresh connection (or reuses one if it is kept alive).
+    _endConnection(true);
     
     // Handle different exit conditions
     if (userInterrupted) {
         // User interruption is not an error - it's a normal way to stop streaming
         // Don't set _lastError for user interruption
+        if (reply != nullptr) *reply = ""; // Partial answer: not kept in the history
         return true; // Return true to indicate successful (user-controlled) completion
     }
     
+    if (stopReason != nullptr && !streamComplete) {
+        // Ended by a budget on purpose, not an error. Cut at a stop string the answer is
+        // complete and kept in the history; cut by a budget it is partial.
+        if (strcmp(stopReason, "stop_string") != 0 && reply != nullptr) *reply = "";
+        return true;
+    }
+    
+    if (!streamComplete && reply != nullptr) *reply = "";
     return streamComplete;
 }
 
-#endif // ENABLE_STREAM_CHAT
\ No newline at end of file
+const char* ESP32_AI_Connect::_limitStreamContent(const StreamLimits& limits, String& content, String& held,
+                                                  size_t& passedBytes, bool isComplete) {
+    String text = held + content;
+    held = "";
+    const char* reason = nullptr;
+    
+    int stopAt = -1;
+    for (size_t i = 0; i < limits.stopCount; i++) {
+        int found = text.indexOf(limits.stops[i]);
+        if (found >= 0 && (stopAt < 0 || found < stopAt)) stopAt = found;
+    }
+    if (stopAt >= 0) {
+        text.remove(stopAt);
+        reason = "stop_string";
+    } else if (!isComplete) {
+        // Hold back the longest tail that is the start of a stop string
+        size_t keep = 0;
+        for (size_t i = 0; i < limits.stopCount; i++) {
+            const String& stop = limits.stops[i];
+            size_t k = stop.length() - 1;
+            if (k > text.length()) k = text.length();
+            for (; k > keep; k--) {
+                if (memcmp(text.c_str() + text.length() - k, stop.c_str(), k) == 0) {
+                    keep = k;
+                    break;
+                }
+            }
+        }
+        if (keep > 0) {
+            held = text.substring(text.length() - keep);
+            text.remove(text.length() - keep);
+        }
+    }
+    
+    if (limits.maxBytes > 0) {
+        size_t room = limits.maxBytes - passedBytes;
+        bool over = reason == nullptr ? text.length() + held.length() >= room : text.length() > room;
+        if (over) {
+            // The stream ends here, so a held tail is plain content after all
+            text += held;
+            size_t cut = text.length() < room ? text.length() : room;
+            // Don't split a UTF-8 character
+            while (cut > 0 && cut < text.length() && ((uint8_t)text[cut] & 0xC0) == 0x80) cut--;
+            text.remove(cut);
+            held = "";
+            reason = limits.bytesReason;
+        }
+    }
+    
+    passedBytes += text.length();
+    content = text;
+    return reason;
+}
+
+// Builds the chunk info and calls the user callback; returns false if the callback asked to stop
+bool ESP32_AI_Connect::_deliverStreamChunk(const StreamCallback& callback, const String& content,
+                                           bool isComplete, uint32_t chunkIndex) {
+    if (!callback) return true;
+    
+    StreamChunkInfo chunkInfo;
+    chunkInfo.content = content;
+    chunkInfo.isComplete = isComplete;
+    chunkInfo.chunkIndex = chunkIndex;
+    chunkInfo.totalBytes = _streamTotalBytes.load(std::memory_order_relaxed);
+    chunkInfo.elapsedMs = getStreamElapsedTime();
+    chunkInfo.errorMsg = "";
+    return callback(chunkInfo);
+}
+
+// Number of buffered bytes to pass to the callback now (0 = keep buffering).
+// Size and delay limits flush everything; a boundary flushes up to the last one found.
+size_t ESP32_AI_Connect::_coalescedLength(const String& pending, unsigned long pendingSince,
+                                          size_t minBytes, uint32_t maxDelayMs, StreamBoundary boundary) {
+    size_t length = pending.length();
+    if (length == 0) return 0;
+    if (minBytes > 0 && length >= minBytes) return length;
+    if (maxDelayMs > 0 && millis() - pendingSince >= maxDelayMs) return length;
+    
+    if (boundary == StreamBoundary::NONE) return 0;
+    for (size_t i = length; i > 0; i--) {
+        char c = pending[i - 1];
+        if (c == '\n') return i;
+        if (c != ' ' && c != '\t') continue;
+        if (boundary == StreamBoundary::WORD) return i;
+        // Sentence: whitespace right after '.', '!' or '?'
+        if (i >= 2 && strchr(".!?", pending[i - 2]) != nullptr) return i;
+    }
+    return 0;
+}
+
+#endif // ENABLE_STREAM_CHAT
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+// --- Streaming Tool Calls ---
+bool ESP32_AI_Connect::streamTcChat(const String& tcUserMessage, StreamCallback onText, ToolCallCallback onToolCall) {
+    if (_rejectDuringAgent()) return false;
+    if (!onToolCall) {
+        _lastError = "Tool call callback is null";
+        return false;
+    }
+    if (_tcToolsArray == nullptr || _tcToolsArraySize == 0) {
+        _lastError = "Tool calls not set up. Call setTCTools() first.";
+        return false;
+    }
+    if (!_claimStream(onText)) {
+        return false;
+    }
+    _streamToolCallback = onToolCall;
+    _metricsBegin(RequestType::STREAM_TC_CHAT);
+    
+    // Reset conversation tracking for new chat, as tcChat() does
+    _lastUserMessage = tcUserMessage;
+    _lastAssistantToolCallsJson = "";
+    _lastMessageWasToolCalls = false;
+    
+    String url = _platformHandler->getStreamEndpoint(_modelName, _apiKey, _customEndpoint);
+    bool bodyBuilt = false;
+    if (url.isEmpty()) {
+        _lastError = "Failed to get endpoint URL from platform handler";
+    } else if (!_tcToolsJson.isEmpty() || _buildTCToolsJson()) {
+        uint32_t buildStart = micros();
+        bodyBuilt = _platformHandler->buildToolCallsStreamRequestBody(
+            _modelName, _tcToolsJson,
+            _tcSystemRole, _tcToolChoice, _tcMaxToken, tcUserMessage, _reqDoc,
+            _historyForRequest());
+        _metrics.buildUs += micros() - buildStart;
+        if (!bodyBuilt && _lastError.isEmpty()) _lastError = "Failed to build streaming tool calls request body";
+    }
+    if (!bodyBuilt) {
+        _streamToolCallback = nullptr;
+        _setStreamState(StreamState::ERROR);
+        _metricsEnd(false);
+        return false;
+    }
+    
+    AI_API_LOGD("Streaming tool calls request: %s", url.c_str());
+    AI_API_LOG_JSON(AI_API_LOG_LEVEL_DEBUG, "Body", _reqDoc);
+    
+    String reply = "";
+    bool success = _processStreamResponse(url, _chatHistory.isEnabled() ? &reply : nullptr, true);
+    _streamToolCallback = nullptr;
+    
+    // Calls completed before the stream ended (or was stopped) can be replied to with tcReply()
+    String toolCallsJson = _platformHandler->getStreamToolCallsJson();
+    if (!toolCallsJson.isEmpty()) {
+        AI_API_LOG_PREVIEW(AI_API_LOG_LEVEL_DEBUG, "Streamed tool calls", toolCallsJson.c_str(), toolCallsJson.length());
+        _lastMessageWasToolCalls = true;
+        _lastAssistantToolCallsJson = toolCallsJson;
+    } else if (success && !reply.isEmpty()) {
+        // Answered without tools: remember the exchange
+        _chatHistory.addExchange(tcUserMessage, reply);
+    }
+    
+    _setStreamState(success ? StreamState::IDLE : StreamState::ERROR);
+    _metricsEnd(success);
+    return success;
+}
+
+String ESP32_AI_Connect::getStreamTCToolCalls() const {
+    return _lastMessageWasToolCalls ? _lastAssistantToolCallsJson : String("");
+}
+
+bool ESP32_AI_Connect::_deliverStreamToolCalls(size_t& delivered) {
+    size_t completed = _platformHandler->getStreamToolCallsCompleted();
+    for (; delivered < completed; delivered++) {
+        const AI_API_Platform_Handler::StreamToolCall& call = _platformHandler->getStreamToolCall(delivered);
+        AI_API_LOGD("Tool call %u complete: %s", (unsigned)delivered, call.name.c_str());
+        
+        ToolCallInfo info;
+        info.index = delivered;
+        info.id = call.id;
+        info.name = call.name;
+        info.arguments = call.arguments.isEmpty() ? String("{}") : call.arguments;
+        info.elapsedMs = getStreamElapsedTime();
+        if (!_streamToolCallback(info)) {
+            delivered++;
+            return false;
+        }
+    }
+    return true;
+}
+#endif // ENABLE_STREAM_TOOL_CALLS
+
+#ifdef ENABLE_ASYNC_CHAT
+// --- Async Requests ---
+
+bool ESP32_AI_Connect::beginAsync(BaseType_t core, UBaseType_t priority) {
+    if (_asyncTask != nullptr) return true; // Already running
+
+    if (_asyncJobQueue == nullptr) _asyncJobQueue = xQueueCreate(AI_API_ASYNC_QUEUE_LENGTH, sizeof(AsyncJob*));
+    if (_asyncResultQueue == nullptr) _asyncResultQueue = xQueueCreate(AI_API_ASYNC_QUEUE_LENGTH, sizeof(AsyncResult*));
+    if (_asyncStopped == nullptr) _asyncStopped = xSemaphoreCreateBinary();
+    if (_asyncJobQueue == nullptr || _asyncResultQueue == nullptr || _asyncStopped == nullptr) {
+        _lastError = "Failed to create async request queues";
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(_asyncTaskEntry, "ai_connect", AI_API_ASYNC_TASK_STACK_SIZE,
+                                this, priority, &_asyncTask, core) != pdPASS) {
+        _asyncTask = nullptr;
+        _lastError = "Failed to create async worker task";
+        return false;
+    }
+    return true;
+}
+
+void ESP32_AI_Connect::endAsync() {
+    if (_asyncTask == nullptr) return;
+    if (xTaskGetCurrentTaskHandle() == _asyncTask) return; // Called from onDone: the worker can't wait for itself
+
+    // Drop requests that have not started, then ask the worker to exit after the current one
+    AsyncJob* job = nullptr;
+    while (xQueueReceive(_asyncJobQueue, &job, 0) == pdTRUE) {
+        delete job;
+        portENTER_CRITICAL(&_asyncMux);
+        _asyncPending--;
+        portEXIT_CRITICAL(&_asyncMux);
+    }
+#ifdef ENABLE_STREAM_CHAT
+    stopStreaming(); // Ends a running stream early
+#endif
+    AsyncJob* stopJob = new AsyncJob();
+    stopJob->type = AsyncJobType::STOP;
+    xQueueSend(_asyncJobQueue, &stopJob, portMAX_DELAY);
+    xSemaphoreTake(_asyncStopped, portMAX_DELAY);
+    _asyncTask = nullptr;
+
+    // Discard undelivered results
+    AsyncResult* result = nullptr;
+    while (xQueueReceive(_asyncResultQueue, &result, 0) == pdTRUE) {
+        delete result;
+    }
+    vQueueDelete(_asyncJobQueue);
+    vQueueDelete(_asyncResultQueue);
+    vSemaphoreDelete(_asyncStopped);
+    _asyncJobQueue = nullptr;
+    _asyncResultQueue = nullptr;
+    _asyncStopped = nullptr;
+}
+
+uint32_t ESP32_AI_Connect::chatAsync(const String& userMessage, AsyncCallback onDone) {
+    AsyncJob* job = new AsyncJob();
+    job->type = AsyncJobType::CHAT;
+    job->message = userMessage;
+    job->onDone = onDone;
+    return _queueAsyncJob(job);
+}
+
+#ifdef ENABLE_TOOL_CALLS
+uint32_t ESP32_AI_Connect::tcChatAsync(const String& tcUserMessage, AsyncCallback onDone) {
+    AsyncJob* job = new AsyncJob();
+    job->type = AsyncJobType::TC_CHAT;
+    job->message = tcUserMessage;
+    job->onDone = onDone;
+    return _queueAsyncJob(job);
+}
+
+uint32_t ESP32_AI_Connect::tcReplyAsync(const String& toolResultsJson, AsyncCallback onDone) {
+    AsyncJob* job = new AsyncJob();
+    job->type = AsyncJobType::TC_REPLY;
+    job->message = toolResultsJson;
+    job->onDone = onDone;
+    return _queueAsyncJob(job);
+}
+#endif
+
+#ifdef ENABLE_STREAM_CHAT
+uint32_t ESP32_AI_Connect::streamChatAsync(const String& userMessage, StreamCallback onChunk, AsyncCallback onDone) {
+    if (!onChunk) {
+        _lastError = "Callback function is null";
+        return 0;
+    }
+    AsyncJob* job = new AsyncJob();
+    job->type = AsyncJobType::STREAM_CHAT;
+    job->message = userMessage;
+    job->onChunk = onChunk;
+    job->onDone = onDone;
+    return _queueAsyncJob(job);
+}
+#endif
+
+bool ESP32_AI_Connect::pollAsyncResult(AsyncResult& result, uint32_t waitMs) {
+    if (_asyncResultQueue == nullptr) return false;
+
+    AsyncResult* finished = nullptr;
+    if (xQueueReceive(_asyncResultQueue, &finished, pdMS_TO_TICKS(waitMs)) != pdTRUE) return false;
+    result = *finished;
+    delete finished;
+    return true;
+}
+
+bool ESP32_AI_Connect::isAsyncBusy() const {
+    return _asyncPending > 0;
+}
+
+uint32_t ESP32_AI_Connect::getAsyncPendingCount() const {
+    return _asyncPending;
+}
+
+uint32_t ESP32_AI_Connect::_queueAsyncJob(AsyncJob* job) {
+    if (!beginAsync()) { // Starts the worker on first use
+        delete job;
+        return 0; // _lastError already set
+    }
+
+    portENTER_CRITICAL(&_asyncMux);
+    job->requestId = _asyncNextId++;
+    if (_asyncNextId == 0) _asyncNextId = 1; // 0 means "not queued"
+    _asyncPending++;
+    portEXIT_CRITICAL(&_asyncMux);
+
+    uint32_t requestId = job->requestId;
+    if (xQueueSend(_asyncJobQueue, &job, 0) != pdTRUE) {
+        portENTER_CRITICAL(&_asyncMux);
+        _asyncPending--;
+        portEXIT_CRITICAL(&_asyncMux);
+        delete job;
+        _lastError = "Async request queue is full";
+        return 0;
+    }
+    return requestId;
+}
+
+ESP32_AI_Connect::AsyncResult ESP32_AI_Connect::_executeAsyncJob(const AsyncJob* job) {
+    AsyncResult result;
+    result.requestId = job->requestId;
+
+    // Runs the blocking call on the worker task
+    switch (job->type) {
+        case AsyncJobType::CHAT:
+            result.content = chat(job->message);
+            result.httpCode = _chatResponseCode;
+            result.success = _lastError.isEmpty();
+            break;
+#ifdef ENABLE_TOOL_CALLS
+        case AsyncJobType::TC_CHAT:
+            result.content = tcChat(job->message);
+            result.httpCode = _tcChatResponseCode;
+            result.success = _lastError.isEmpty();
+            break;
+        case AsyncJobType::TC_REPLY:
+            result.content = tcReply(job->message);
+            result.httpCode = _tcReplyResponseCode;
+            result.success = _lastError.isEmpty();
+            break;
+#endif
+#ifdef ENABLE_STREAM_CHAT
+        case AsyncJobType::STREAM_CHAT:
+            result.success = streamChat(job->message, job->onChunk);
+            result.httpCode = getStreamChatResponseCode();
+            break;
+#endif
+        default:
+            _lastError = "Async request type is not supported in this build";
+            break;
+    }
+    result.errorMsg = _lastError;
+    result.finishReason = getFinishReason();
+    result.totalTokens = getTotalTokens();
+    return result;
+}
+
+void ESP32_AI_Connect::_runAsyncJob(AsyncJob* job) {
+    AsyncResult result = _executeAsyncJob(job);
+
+    if (job->onDone) {
+        job->onDone(result);
+        return;
+    }
+
+    AsyncResult* queued = new AsyncResult(result);
+    if (xQueueSend(_asyncResultQueue, &queued, 0) != pdTRUE) {
+        AI_API_LOGW("Async result dropped: result queue is full (call pollAsyncResult())");
+        delete queued;
+    }
+}
+
+void ESP32_AI_Connect::_asyncTaskEntry(void* param) {
+    ESP32_AI_Connect* self = static_cast<ESP32_AI_Connect*>(param);
+
+    AsyncJob* job = nullptr;
+    while (xQueueReceive(self->_asyncJobQueue, &job, portMAX_DELAY) == pdTRUE) {
+        if (job->type == AsyncJobType::STOP) {
+            delete job;
+            break;
+        }
+        self->_runAsyncJob(job);
+        delete job;
+
+        portENTER_CRITICAL(&self->_asyncMux);
+        self->_asyncPending--;
+        portEXIT_CRITICAL(&self->_asyncMux);
+    }
+
+    xSemaphoreGive(self->_asyncStopped);
+    vTaskDelete(nullptr);
+}
+#endif // ENABLE_ASYNC_CHAT
@@ -8,12 +8,24 @@
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <functional>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 
 // Include configuration and base handler FIRST
 #include "ESP32_AI_Connect_config.h"
 #include "AI_API_Platform_Handler.h"
+#include "AI_API_SSE_Reader.h"
+#include "AI_API_Response_Stream.h"
+#include "AI_API_Request_Stream.h"
+#include "AI_API_Chat_History.h"
+#include "AI_API_Secure_Client.h"
+#include "AI_API_Allocator.h"
+#include "AI_API_Response_Cache.h"
+#include "AI_API_Log.h"
+#include "AI_API_Tool_Registry.h"
 
 // --- Conditionally Include Platform Implementations ---
 // The preprocessor will only include headers for platforms enabled in the config file
@@ -31,7 +43,29 @@
 #endif
 // Add other conditional includes here
 
+// --- Fixed Platform Build (see AI_CONNECT_FIXED_PLATFORM in the config file) ---
+#ifdef AI_CONNECT_FIXED_PLATFORM
+#if AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_OPENAI && defined(USE_AI_API_OPENAI)
+typedef AI_API_OpenAI_Handler AI_API_Fixed_Handler;
+#elif AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_GEMINI && defined(USE_AI_API_GEMINI)
+typedef AI_API_Gemini_Handler AI_API_Fixed_Handler;
+#elif AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_DEEPSEEK && defined(USE_AI_API_DEEPSEEK)
+typedef AI_API_DeepSeek_Handler AI_API_Fixed_Handler;
+#elif AI_CONNECT_FIXED_PLATFORM == AI_PLATFORM_CLAUDE && defined(USE_AI_API_CLAUDE)
+typedef AI_API_Claude_Handler AI_API_Fixed_Handler;
+#else
+#error "AI_CONNECT_FIXED_PLATFORM must be AI_PLATFORM_OPENAI, AI_PLATFORM_GEMINI, AI_PLATFORM_DEEPSEEK or AI_PLATFORM_CLAUDE (and not disabled)"
+#endif
+#endif
+
+#ifdef ENABLE_ASYNC_CHAT
+class AI_API_Dispatcher; // Schedules requests of several instances (AI_API_Dispatcher.h)
+#endif
+
 class ESP32_AI_Connect {
+#ifdef ENABLE_ASYNC_CHAT
+    friend class AI_API_Dispatcher;
+#endif
 public:
     // Constructor: Takes platform identifier string, API key, model name
     ESP32_AI_Connect(const char* platformIdentifier, const char* apiKey, const char* modelName);
@@ -73,6 +107,13 @@ public:
 
     // Main chat function - delegates to the handler
     String chat(const String& userMessage);
+
+    // Send count independent prompts one after the other over one kept-alive connection
+    // (also when connection reuse is off), with the chat settings. replies[i] gets the reply
+    // to prompts[i], "" if it failed; errors (optional) gets the error of each failed prompt.
+    // The prompts neither see nor add to the conversation history.
+    // Returns the number of prompts answered; getLastError() holds the last failure.
+    size_t chatBatch(const String* prompts, String* replies, size_t count, String* errors = nullptr);
     
     // Raw response access methods
     String getChatRawResponse() const;
@@ -103,6 +144,167 @@ public:
     // Returns the currently set Root CA certificate, or nullptr if using insecure mode.
     const char* getRootCA() const;
 
+    // --- Connection Reuse (HTTP/1.1 keep-alive) ---
+    // Keeps the TLS connection open between requests to the same host, skipping the
+    // TCP + TLS handshake on subsequent calls. Disabled by default.
+    // Stale sockets are detected and re-established transparently.
+    void setConnectionReuse(bool enable);
+    // Returns true if connection reuse is enabled.
+    bool getConnectionReuse() const;
+    // Returns true if the last request was sent over a reused (already open) connection.
+    bool getLastRequestReusedConnection() const;
+    // Number of requests sent over a reused connection since construction.
+    uint32_t getReusedConnectionCount() const;
+    // Number of requests that required a fresh TCP + TLS handshake since construction.
+    uint32_t getNewConnectionCount() const;
+    // Closes the kept-alive connection, if any.
+    void closeConnection();
+    // Returns true if a kept-alive connection is currently open.
+    bool hasOpenConnection() const;
+
+    // --- Automatic Retry ---
+    // Retries chat(), tcChat(), tcReply() and streamChat() requests that could not be delivered
+    // (connect or send failed) or got HTTP 408/429/500/502/503/504/529, resending the request body that
+    // was already built (over the kept-alive connection when reuse is enabled).
+    // Waits a jittered exponential backoff starting at baseDelayMs, or what the server asks
+    // for in Retry-After; a request asked to wait longer than maxDelayMs fails right away.
+    // maxAttempts = 1 disables retries (the default).
+    void setRetryPolicy(uint8_t maxAttempts, uint32_t baseDelayMs = AI_API_RETRY_BASE_DELAY_MS,
+                        uint32_t maxDelayMs = AI_API_RETRY_MAX_DELAY_MS);
+    // Returns the maximum number of attempts per request.
+    uint8_t getRetryMaxAttempts() const;
+    // Attempts used by the last request (1 = it was not retried).
+    uint8_t getLastRequestAttempts() const;
+
+    // --- Request Metrics ---
+    // Timing, traffic and memory use of the last chat(), tcChat(), tcReply(), streamChat() or
+    // streamTcChat() call, to tell Wi-Fi, TLS, the provider and parsing apart. Network phases are in
+    // milliseconds, the library's own work in microseconds. With retries, connection
+    // times and bytes are summed over the attempts; time to first byte is the last attempt's.
+    enum class RequestType : uint8_t { CHAT, TC_CHAT, TC_REPLY, STREAM_CHAT, STREAM_TC_CHAT };
+
+    struct RequestMetrics {
+        RequestType type = RequestType::CHAT;
+        bool success = false;
+        int httpCode = 0;              // Of the last attempt, 0 if nothing was sent
+        uint8_t attempts = 0;
+        bool reusedConnection = false;
+        bool cached = false;           // Served from the response cache, nothing was sent
+        uint32_t buildUs = 0;          // Building the request body and measuring its size
+        uint32_t dnsMs = 0;            // Host name lookup (0 on a reused connection)
+        uint32_t connectMs = 0;        // TCP connect and TLS handshake (0 on a reused connection)
+        uint32_t firstByteMs = 0;      // Sending the request until the first response byte (upload + provider)
+        uint32_t firstTokenMs = 0;     // Call start until the first content arrived (streaming only)
+        uint32_t bodyMs = 0;           // Response headers until the body was read and parsed (the whole stream)
+        uint32_t parseUs = 0;          // Parsing the response JSON (with direct parsing, reading the body too)
+        uint32_t totalMs = 0;
+        uint32_t bytesSent = 0;        // Through the TLS socket, HTTP headers included
+        uint32_t bytesReceived = 0;
+        uint32_t heapFreeBefore = 0;   // Free heap when the call started
+        uint32_t heapMinFree = 0;      // Lowest free heap during the call
+        uint32_t heapPeakUsed = 0;     // heapFreeBefore - heapMinFree
+    };
+
+    typedef std::function<void(const RequestMetrics& metrics)> RequestMetricsCallback;
+
+    // Metrics of the last request. Read them from the task that made the request.
+    RequestMetrics getLastRequestMetrics() const;
+    // Called at the end of every request, on the task that made it. nullptr removes it.
+    void setRequestMetricsCallback(RequestMetricsCallback callback);
+
+    // --- Direct Response Parsing ---
+    // Parses chat(), tcChat() and tcReply() responses straight from the socket instead of
+    // buffering the whole body in a String first, so only the parsed document stays in RAM.
+    // Error responses (non-200) are still buffered for getLastError(). Disabled by default.
+    // keepRawResponse: also keep a copy of the body for getChatRawResponse()/getTCRawResponse()
+    void setDirectResponseParsing(bool enable, bool keepRawResponse = false);
+    // Returns true if direct response parsing is enabled.
+    bool getDirectResponseParsing() const;
+
+    // --- Memory Allocation ---
+    // Allocates the request and response JSON documents, and the parsed custom parameters,
+    // with allocator instead of the default heap, e.g. AI_API_Psram_Allocator::instance()
+    // to move them to PSRAM. nullptr restores the default heap. The allocator must outlive
+    // this object. Call while no request is running.
+    void setAllocator(ArduinoJson::Allocator* allocator);
+    // Returns the allocator set with setAllocator(), or nullptr for the default heap.
+    ArduinoJson::Allocator* getAllocator() const;
+
+    // --- Conversation History ---
+    // Keeps previous turns and sends them with every chat(), streamChat() and tcChat() request.
+    // Turns are stored pre-encoded in one arena of arenaBytes bytes; when it is full the
+    // oldest turns are dropped. Disabled by default (arenaBytes = 0 disables it again).
+    // usePsram: place the arena in PSRAM when available
+    // Returns false if the arena could not be allocated.
+    bool setChatHistory(size_t arenaBytes, bool usePsram = false);
+    // Also drop the oldest turns once the history exceeds about maxTokens (0 = no limit)
+    void setChatHistoryTokenBudget(size_t maxTokens);
+    // Forget all stored turns (keeps the arena)
+    void chatHistoryClear();
+    // Number of stored turns (user and assistant messages)
+    size_t getChatHistoryTurnCount() const;
+    // Arena bytes in use
+    size_t getChatHistoryBytes() const;
+
+    // --- Prompt Caching ---
+    // Lets the platform reuse the processed system role and tool definitions when they repeat
+    // across requests, which lowers the latency and cost of the prompt. OpenAI, DeepSeek and
+    // Gemini do this by themselves for long enough prompts; for Claude, setPromptCaching(true)
+    // marks them as cacheable. Off by default.
+    void setPromptCaching(bool enabled);
+    bool getPromptCaching() const;
+    // Gemini only: use a cached content created with the Gemini API (e.g. "cachedContents/abc123")
+    // instead of sending the system role and tools with each request. "" stops using it.
+    // Returns false if the platform does not support it.
+    bool setCachedContent(const String& name);
+    String getCachedContent() const;
+    // Of the last response: prompt tokens read from the cache, and (Claude) written to it
+    int getCachedTokens() const;
+    int getCacheWriteTokens() const;
+
+#ifdef ENABLE_RESPONSE_CACHE
+    // --- Response Cache ---
+    // Serves repeated chat() requests locally instead of over the network. The key covers the
+    // endpoint (platform), model, system role, temperature, max tokens, custom parameters and
+    // the message. Only deterministic requests (temperature exactly 0) are cached unless
+    // forced, and requests are never cached while conversation history is enabled.
+    // Keeps up to maxEntries replies totalling maxBytes in RAM (maxEntries = 0 disables it).
+    // Returns false if the cache could not be allocated. Disabled by default.
+    bool setResponseCache(size_t maxEntries, size_t maxBytes = 8192);
+    // Also keep up to maxFiles replies on a file system (e.g. &LittleFS) so they survive a
+    // reboot. The directory must only be used by the cache. fs = nullptr detaches it.
+    void setResponseCacheStorage(fs::FS* fs, const char* directory = AI_API_RESPONSE_CACHE_DIR, size_t maxFiles = 32);
+    // Cache requests at any temperature (replies are no longer sampled again)
+    void setResponseCacheForce(bool force);
+    // Remove all cached replies (RAM and file system)
+    void responseCacheClear();
+    // Returns true if the last chat() reply came from the cache
+    bool getLastResponseCached() const;
+    uint32_t getResponseCacheHits() const;
+    uint32_t getResponseCacheMisses() const;
+#endif
+
+#ifdef ENABLE_STATE_SAVE
+    // --- State Save / Restore ---
+    // Saves the chat, tool calls and streaming settings, the tools (already converted for the
+    // platform), a tool calls conversation waiting for tcReply() and the conversation history
+    // as one compact MessagePack record, e.g. to RTC memory, NVS or a file before deep sleep.
+    // The API key, callbacks, tool handlers and the response cache are not saved.
+    // Returns the bytes written, 0 if buffer is smaller than getStateSize() or a stream held the
+    // settings lock for over 100 ms (see getLastError()).
+    size_t saveState(uint8_t* buffer, size_t size);
+    size_t saveState(Print& output);
+    // Bytes saveState() would write now
+    size_t getStateSize();
+    // Restores a record written by saveState(). Call after begin(); to choose where the history
+    // goes, call setChatHistory() first, otherwise it is allocated in internal RAM with the saved
+    // size. Tools saved for another platform are converted again. Returns false, changing
+    // nothing, if the record is not a valid state; also returns false, with everything else
+    // restored, if the history or custom parameters could not be (_lastError says which).
+    bool restoreState(const uint8_t* data, size_t length);
+    bool restoreState(Stream& input);
+#endif
+
 #ifdef ENABLE_TOOL_CALLS
     // --- Tool Calls Methods ---
     
@@ -163,6 +365,41 @@ public:
     // Reset the tool calls conversation history and configuration
     // Call this when you want to start a new conversation
     void tcChatReset();
+
+    // --- Tool Handlers ---
+    // Gets the arguments of a tool call as JSON text and returns the tool's output
+    typedef AI_API_Tool_Registry::ToolHandler ToolHandler;
+
+    // Register the handler of a tool defined with setTCTools(); nullptr removes it.
+    // Handlers stay registered across tcChatReset(). Parallel handlers of one response run
+    // at the same time on separate tasks, so they may not share unprotected state; set
+    // parallel to false for handlers that must run alone (e.g. on a shared I2C bus).
+    // Returns false if AI_API_TOOL_HANDLERS_MAX handlers are registered already.
+    bool setTCToolHandler(const String& name, ToolHandler handler, bool parallel = true);
+    // Run the registered handlers for the tool calls of the last tcChat(), tcReply() or
+    // streamTcChat() response and send their results with tcReply().
+    // Returns: same as tcReply - call it again while it returns tool calls
+    String tcRunTools();
+    // The tool results sent by the last tcRunTools() (the format tcReply() takes)
+    String getTCToolResults() const;
+    // Time the handlers of the last tcRunTools() took, in ms
+    uint32_t getTCToolRunTime() const;
+
+    // --- Agent Loop ---
+    // tcChat() followed by rounds of running the registered tool handlers and sending their
+    // results, until the AI answers without calling tools. Each round is appended to the
+    // request of the round before, so the AI sees all earlier tool calls and results (tcReply()
+    // sends only the latest round) and the request is not rebuilt from Strings every time.
+    // maxSteps: tool rounds allowed; maxTokens: stop before a round once the requests used
+    // this many tokens together (0: no limit). Metrics are recorded per request.
+    // Requests sent with this instance from a tool handler fail, as _reqDoc holds the conversation.
+    // Returns the final answer, "" on error or when a limit was reached (see getLastError()).
+    String tcAgentChat(const String& tcUserMessage, uint8_t maxSteps = AI_API_TC_AGENT_MAX_STEPS,
+                       uint32_t maxTokens = 0);
+    // Tool rounds run by the last tcAgentChat()
+    uint8_t getTCAgentSteps() const;
+    // Tokens used by all requests of the last tcAgentChat()
+    uint32_t getTCAgentTokens() const;
 #endif
 
 #ifdef ENABLE_STREAM_CHAT
@@ -189,6 +426,13 @@ public:
     
     typedef std::function<bool(const StreamChunkInfo& chunkInfo)> StreamCallback;
 
+    // Text boundaries at which coalesced stream content is passed on
+    enum class StreamBoundary : uint8_t {
+        NONE = 0,       // Only the size and delay limits apply
+        WORD = 1,       // After whitespace
+        SENTENCE = 2    // After ". ", "! ", "? " or a newline
+    };
+
     // Main streaming method with enhanced thread safety
     bool streamChat(const String& userMessage, StreamCallback callback);
 
@@ -204,7 +448,18 @@ public:
     uint32_t getStreamTotalBytes() const;
     uint32_t getStreamElapsedTime() const;
     
-    // Thread-safe reset
+    // Consistent snapshot of the stream progress, safe to poll from any task or core.
+    // Lock-free: never delays the streaming task, and only waits for it while an update is in progress.
+    struct StreamStats {
+        StreamState state;
+        uint32_t chunkCount;
+        uint32_t totalBytes;
+        uint32_t elapsedMs;
+        int responseCode;
+    };
+    StreamStats getStreamStats() const;
+    
+    // Thread-safe reset of the streaming settings and state; ignored while a stream is running
     void streamChatReset();
 
     // Streaming parameter setters (separate from regular chat)
@@ -213,11 +468,108 @@ public:
     void setStreamChatMaxTokens(int maxTokens);
     bool setStreamChatParameters(String userParameterJsonStr);
 
+    // Coalesce small deltas into fewer, larger callbacks. Content is buffered and passed
+    // on once minBytes are buffered, maxDelayMs after the oldest buffered content arrived,
+    // or at a boundary (whichever comes first); the final callback gets the rest.
+    // All zero / NONE disables coalescing (default): one callback per received delta.
+    void setStreamChatCoalescing(size_t minBytes, uint32_t maxDelayMs = 0,
+                                 StreamBoundary boundary = StreamBoundary::NONE);
+
+    // End a stream early, closing the connection as soon as the content passed on reaches
+    // maxBytes, about maxTokens (estimated at 4 bytes each) or maxTimeMs after the request
+    // started. The content is cut to fit and the last callback has isComplete set.
+    // getFinishReason() then returns "max_bytes", "max_tokens" or "max_time". 0 = no limit.
+    void setStreamChatBudget(size_t maxBytes, uint32_t maxTimeMs = 0, size_t maxTokens = 0);
+    // End a stream as soon as its content contains stop; the content from stop on is not
+    // passed on and getFinishReason() returns "stop_string". Checked locally, also across
+    // chunks. Returns false for "" or once AI_API_STREAM_STOP_STRINGS_MAX strings are set.
+    bool addStreamChatStopString(const String& stop);
+    void clearStreamChatStopStrings();
+
     // Streaming parameter getters
     String getStreamChatSystemRole() const;
     float getStreamChatTemperature() const;
     int getStreamChatMaxTokens() const;
     String getStreamChatParameters() const;
+    size_t getStreamChatCoalescingBytes() const;
+    uint32_t getStreamChatCoalescingDelay() const;
+    StreamBoundary getStreamChatCoalescingBoundary() const;
+    size_t getStreamChatBudgetBytes() const;
+    uint32_t getStreamChatBudgetTime() const;
+    size_t getStreamChatBudgetTokens() const;
+    size_t getStreamChatStopStringCount() const;
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // --- Streaming Tool Calls ---
+
+    // A tool call of streamTcChat(), passed on as soon as its arguments are complete
+    struct ToolCallInfo {
+        uint32_t index;        // Position among the tool calls of the response
+        String id;             // Id to reply with ("" on Gemini)
+        String name;
+        String arguments;      // Complete arguments as JSON text
+        uint32_t elapsedMs;    // Since the stream started
+    };
+
+    typedef std::function<bool(const ToolCallInfo& toolCall)> ToolCallCallback;
+
+    // tcChat() as a stream with the same tool calls settings: text is passed to onText as it
+    // arrives (as with streamChat(), may be nullptr) and each tool call to onToolCall as soon
+    // as its arguments are complete, while the model may still be generating the next one.
+    // Either callback can return false to stop the stream. Afterwards tcReply() sends the
+    // results of the completed tool calls, as after tcChat(). The stream state and statistics
+    // are the ones of streamChat() (isStreaming(), stopStreaming(), getStreamStats()...).
+    // Returns false on error (see getLastError()).
+    bool streamTcChat(const String& tcUserMessage, StreamCallback onText, ToolCallCallback onToolCall);
+    // After streamTcChat(): its complete tool calls in the format tcChat() returns (what
+    // tcReply() replies to), "" if it called no tools
+    String getStreamTCToolCalls() const;
+#endif
+
+#ifdef ENABLE_ASYNC_CHAT
+    // --- Async (Non-Blocking) Requests ---
+    // Each call queues the request for a worker task and returns immediately with a
+    // request id (0 if the request could not be queued, see getLastError()).
+    // Requests run one at a time, in order, using the current chat/tool/stream settings.
+    // The result is passed to onDone on the worker task; without onDone it is placed
+    // in a queue to be collected with pollAsyncResult(), e.g. from loop().
+    // While requests are pending, don't call the blocking methods from another task.
+
+    struct AsyncResult {
+        uint32_t requestId = 0;
+        bool success = false;
+        String content;         // Reply text (tool calls JSON for tcChat/tcReply), "" on error
+        String errorMsg;        // Error message of the request, "" on success
+        int httpCode = 0;
+        String finishReason;
+        int totalTokens = 0;
+    };
+
+    typedef std::function<void(const AsyncResult& result)> AsyncCallback;
+
+    // Start the worker task (optional: it is started with the configured defaults on first use).
+    // core: AI_API_ASYNC_TASK_CORE by default, tskNO_AFFINITY to let the scheduler choose
+    bool beginAsync(BaseType_t core = AI_API_ASYNC_TASK_CORE, UBaseType_t priority = AI_API_ASYNC_TASK_PRIORITY);
+    // Stop the worker task. Queued requests that have not started are dropped.
+    void endAsync();
+
+    uint32_t chatAsync(const String& userMessage, AsyncCallback onDone = nullptr);
+#ifdef ENABLE_TOOL_CALLS
+    uint32_t tcChatAsync(const String& tcUserMessage, AsyncCallback onDone = nullptr);
+    uint32_t tcReplyAsync(const String& toolResultsJson, AsyncCallback onDone = nullptr);
+#endif
+#ifdef ENABLE_STREAM_CHAT
+    // onChunk is called on the worker task for each chunk, as with streamChat()
+    uint32_t streamChatAsync(const String& userMessage, StreamCallback onChunk, AsyncCallback onDone = nullptr);
+#endif
+
+    // Take the next finished result (requests without onDone). Waits up to waitMs.
+    bool pollAsyncResult(AsyncResult& result, uint32_t waitMs = 0);
+    // True while a request is queued or running
+    bool isAsyncBusy() const;
+    // Number of requests queued or running
+    uint32_t getAsyncPendingCount() const;
 #endif
 
     // --- Optional: Access platform-specific features ---
@@ -235,10 +587,79 @@ private:
     String _modelName = "";
     String _systemRole = "";
     String _customEndpoint = "";  // New member for custom endpoint
+    String _platformId = "";      // Lowercase platform identifier of the last successful begin()
     float _temperature = -1.0; // Use API default
     int _maxTokens = -1;       // Use API default
     String _chatCustomParams = ""; // Store custom parameters as JSON string
+    JsonDocument _chatCustomParamsDoc; // The same parameters, parsed once and copied into each request
     const char* _rootCACert = nullptr; // Root CA certificate for secure connections
+
+    // Connection reuse state
+    bool _connectionReuse = false;      // Keep the connection open between requests
+    String _connectedHost = "";         // Host (and port) of the kept-alive connection
+    bool _lastRequestReused = false;    // Whether the last request reused the connection
+    uint32_t _reusedConnectionCount = 0;
+    uint32_t _newConnectionCount = 0;
+
+    // Retry policy state
+    uint8_t _retryMaxAttempts = AI_API_RETRY_MAX_ATTEMPTS;
+    uint32_t _retryBaseDelayMs = AI_API_RETRY_BASE_DELAY_MS;
+    uint32_t _retryMaxDelayMs = AI_API_RETRY_MAX_DELAY_MS;
+    uint8_t _lastRequestAttempts = 0;
+
+    // Request metrics state
+    RequestMetrics _metrics;            // Request in progress
+    RequestMetrics _lastMetrics;        // Last finished request
+    RequestMetricsCallback _metricsCallback = nullptr;
+    uint32_t _metricsStartAt = 0;       // millis() when the request started
+    uint32_t _metricsResponseAt = 0;    // millis() when the response headers arrived
+    bool _metricsResponded = false;
+    size_t _metricsHeapLow = 0;         // Lowest free heap sampled so far
+    size_t _metricsHeapFloor = 0;       // All-time minimum free heap when the request started
+
+    // Direct response parsing state
+    bool _directResponseParsing = false; // Deserialize 200 responses from the socket
+    bool _keepRawResponse = false;       // Also capture the body while parsing directly
+
+    // Prompt caching state, applied to the handler in begin()
+    bool _promptCaching = false;
+    String _cachedContent = "";
+
+#ifdef ENABLE_RESPONSE_CACHE
+    // Response cache state
+    AI_API_Response_Cache _responseCache;
+    bool _responseCacheForce = false;    // Cache even when temperature != 0
+    bool _lastResponseCached = false;
+    // True if a chat() request with the current settings may be served from the cache
+    bool _responseCacheUsable() const;
+    uint64_t _responseCacheKey(const String& url, const String& userMessage) const;
+#endif
+
+    // Allocator of the JSON documents below, nullptr for the default heap
+    ArduinoJson::Allocator* _allocator = nullptr;
+
+    // Conversation history (disabled until setChatHistory() allocates its arena)
+    AI_API_Chat_History _chatHistory;
+    // History passed to the request builders, nullptr while disabled
+    const AI_API_Chat_History* _historyForRequest() const {
+        return _chatHistory.isEnabled() && !_historyPaused ? &_chatHistory : nullptr;
+    }
+    bool _historyPaused = false;     // Set by chatBatch() while it runs
+    // Set while tcAgentChat() runs: _reqDoc holds the agent's conversation between rounds
+    bool _tcAgentRunning = false;
+    // True (with _lastError set) if a tool handler calls a request method during tcAgentChat()
+    bool _rejectDuringAgent() {
+        if (!_tcAgentRunning) return false;
+        _lastError = "Not allowed while tcAgentChat() runs (called from a tool handler?)";
+        return true;
+    }
+
+#ifdef ENABLE_STATE_SAVE
+    // Fill doc with the state saved by saveState(); false if the stream settings are locked
+    bool _buildStateDoc(JsonDocument& doc);
+    // Apply a parsed state record; false if it is not one
+    bool _applyStateDoc(JsonDocument& doc);
+#endif
     
     // Raw response storage
     String _chatRawResponse = "";    // Store the raw response from chat method
@@ -251,6 +672,7 @@ private:
     // Tool calls configuration storage
     String* _tcToolsArray = nullptr;
     int _tcToolsArraySize = 0;
+    String _tcToolsJson = "";        // Tools converted to the platform format, spliced into each request
     String _tcSystemRole = "";
     String _tcToolChoice = "";
     int _tcMaxToken = -1;
@@ -263,6 +685,12 @@ private:
     String _lastUserMessage = "";         // Original user query
     String _lastAssistantToolCallsJson = ""; // Assistant's tool calls JSON (extracted from response)
     bool _lastMessageWasToolCalls = false; // Flag to track if follow-up is valid
+    
+    // Tool handlers for tcRunTools()
+    AI_API_Tool_Registry _tcToolRegistry;
+    String _tcToolResults = "";           // Results sent by the last tcRunTools()
+    uint8_t _tcAgentSteps = 0;            // Of the last tcAgentChat()
+    uint32_t _tcAgentTokens = 0;
     JsonDocument* _tcConversationDoc = nullptr; // Used to track conversation for follow-up
 #endif
 
@@ -272,51 +700,170 @@ private:
     // FreeRTOS-based synchronization (more efficient than std::mutex on ESP32)
     mutable SemaphoreHandle_t _streamMutex = nullptr;
     
-    // Atomic state management using ESP32-optimized approach
-    volatile StreamState _streamState = StreamState::IDLE;
+    // Stream state, read and changed without the mutex
+    std::atomic<StreamState> _streamState{StreamState::IDLE};
     
     // Protected callback storage
     StreamCallback _streamCallback = nullptr;
     
-    // Streaming metrics (protected by mutex)
-    volatile uint32_t _streamChunkCount = 0;
-    volatile uint32_t _streamTotalBytes = 0;
-    volatile uint32_t _streamStartTime = 0;
+    // Streaming metrics, published through a seqlock (written by the streaming task, and by
+    // the task starting or resetting a stream while none runs). _streamStatsSeq is odd while
+    // an update is in progress; writers claim it with a compare-exchange, see _publishStreamStats().
+    std::atomic<uint32_t> _streamStatsSeq{0};
+    std::atomic<uint32_t> _streamChunkCount{0};
+    std::atomic<uint32_t> _streamTotalBytes{0};
+    std::atomic<uint32_t> _streamStartTime{0};
+    std::atomic<int> _streamResponseCode{0};
     
     // Configuration for streaming (protected by mutex)
     String _streamSystemRole = "";
     float _streamTemperature = -1.0;
     int _streamMaxTokens = -1;
     String _streamCustomParams = "";
+    JsonDocument _streamCustomParamsDoc;    // Parsed once, copied into each request
+    size_t _streamCoalesceBytes = 0;        // Callback coalescing (see setStreamChatCoalescing)
+    uint32_t _streamCoalesceMs = 0;
+    StreamBoundary _streamCoalesceBoundary = StreamBoundary::NONE;
+    size_t _streamBudgetBytes = 0;          // Early termination (see setStreamChatBudget)
+    uint32_t _streamBudgetMs = 0;
+    size_t _streamBudgetTokens = 0;
+    String _streamStopStrings[AI_API_STREAM_STOP_STRINGS_MAX];
+    size_t _streamStopStringCount = 0;
     
     // Raw response storage (protected by mutex)
     String _streamRawResponse = "";
-    int _streamResponseCode = 0;
+    
+    // Line reader for the event stream (buffer allocated only while streaming)
+    AI_API_SSE_Reader _sseReader;
     
     // Thread-safe helper methods
+    // Take the stream for a new request (IDLE -> STARTING); false if it is busy (_lastError is set)
+    bool _claimStream(const StreamCallback& callback);
     bool _acquireStreamLock(uint32_t timeoutMs = 1000) const;
     void _releaseStreamLock() const;
     bool _setStreamState(StreamState newState);
     StreamState _getStreamState() const;
+    // Publish new metric values as one seqlock update
+    void _publishStreamStats(uint32_t chunkCount, uint32_t totalBytes, uint32_t startTime, int responseCode);
     
     // Enhanced internal processing method
-    bool _processStreamResponse(const String& url, const String& requestBody);
+    // reply (optional) receives the complete streamed text, or "" if the stream did not complete
+    // toolCalls: parse the stream as a tool calls response (streamTcChat)
+    bool _processStreamResponse(const String& url, String* reply = nullptr, bool toolCalls = false);
+    bool _deliverStreamChunk(const StreamCallback& callback, const String& content,
+                             bool isComplete, uint32_t chunkIndex);
+    static size_t _coalescedLength(const String& pending, unsigned long pendingSince,
+                                   size_t minBytes, uint32_t maxDelayMs, StreamBoundary boundary);
+
+    // Content limits of one stream, snapshot from the settings when it starts
+    struct StreamLimits {
+        size_t maxBytes = 0;             // Tighter of the byte and token budgets (0 = none)
+        const char* bytesReason = "";    // Finish reason when maxBytes is reached
+        String stops[AI_API_STREAM_STOP_STRINGS_MAX];
+        size_t stopCount = 0;
+    };
+    // Cut new content to the limits. held carries a tail that may begin a stop string into
+    // the next call; passedBytes counts the content let through. Returns the finish reason
+    // if the stream must end, or nullptr.
+    static const char* _limitStreamContent(const StreamLimits& limits, String& content, String& held,
+                                           size_t& passedBytes, bool isComplete);
+#endif
+
+#ifdef ENABLE_STREAM_TOOL_CALLS
+    // Callback of the streamTcChat() call in progress; only used by the task running it
+    ToolCallCallback _streamToolCallback = nullptr;
+    // Pass the tool calls completed since the last call to _streamToolCallback.
+    // Returns false if the callback asked to stop.
+    bool _deliverStreamToolCalls(size_t& delivered);
+#endif
+
+#ifdef ENABLE_ASYNC_CHAT
+    // --- Async Worker State ---
+    enum class AsyncJobType : uint8_t { CHAT, TC_CHAT, TC_REPLY, STREAM_CHAT, STOP };
+
+    struct AsyncJob {
+        AsyncJobType type;
+        uint32_t requestId;
+        String message;
+        AsyncCallback onDone;
+#ifdef ENABLE_STREAM_CHAT
+        StreamCallback onChunk;
+#endif
+    };
+
+    TaskHandle_t _asyncTask = nullptr;
+    QueueHandle_t _asyncJobQueue = nullptr;    // AsyncJob* waiting for the worker
+    QueueHandle_t _asyncResultQueue = nullptr; // AsyncResult* for pollAsyncResult()
+    SemaphoreHandle_t _asyncStopped = nullptr; // Given by the worker when it exits
+    uint32_t _asyncNextId = 1;
+    volatile uint32_t _asyncPending = 0;       // Queued or running requests
+    portMUX_TYPE _asyncMux = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t _queueAsyncJob(AsyncJob* job);
+    // Run a job on the calling task and collect its result
+    AsyncResult _executeAsyncJob(const AsyncJob* job);
+    // Run a job and deliver its result (onDone or the result queue)
+    void _runAsyncJob(AsyncJob* job);
+    static void _asyncTaskEntry(void* param);
 #endif
 
     // Internal state
     String _lastError = "";
+#ifdef AI_CONNECT_FIXED_PLATFORM
+    // Handler bound at compile time: a member, and a final type so calls are not virtual
+    AI_API_Fixed_Handler _fixedHandler;
+    AI_API_Fixed_Handler* _platformHandler = nullptr; // &_fixedHandler after begin()
+#else
     AI_API_Platform_Handler* _platformHandler = nullptr; // Pointer to the active handler
+#endif
 
     // HTTP Client objects
-    WiFiClientSecure _wifiClient;
+    AI_API_Secure_Client _wifiClient; // WiFiClientSecure that can wait for socket data
     HTTPClient _httpClient;
 
     // Shared JSON documents (auto-sized in ArduinoJson v7)
     JsonDocument _reqDoc;
     JsonDocument _respDoc;
+    // Serializes _reqDoc while it is being sent
+    AI_API_Request_Stream _requestStream;
 
     // Private helper to clean up handler
     void _cleanupHandler();
+
+    // Connection helpers shared by chat, tool calls and streaming
+    bool _beginConnection(const String& url);
+    int _sendPostRequest(const String& url); // Sends _reqDoc, retrying per the retry policy
+    int _sendPostAttempt(const String& url);
+    bool _retryDelay(int httpCode, uint32_t& waitMs);
+    void _endConnection(bool forceClose = false);
+    String _parseResponseStream(bool toolCalls, String& rawResponse, bool& bodyComplete);
+
+    // Request metrics helpers
+    void _metricsBegin(RequestType type);
+    void _metricsSampleHeap();
+    void _metricsEnd(bool success);
+    // The request methods behind chat(), tcChat() and tcReply(), which add the metrics
+    String _chatRequest(const String& userMessage);
+#ifdef ENABLE_TOOL_CALLS
+    String _tcChatRequest(const String& tcUserMessage);
+    String _tcReplyRequest(const String& toolResultsJson);
+    // Send the follow-up body in _reqDoc (tcReply and the agent rounds)
+    String _tcFollowUpRequest(const String& url);
+    // Append the next agent round to the follow-up body in _reqDoc and send it
+    String _tcAgentRun(const String& tcUserMessage, uint8_t maxSteps, uint32_t maxTokens);
+    String _tcAgentRoundRequest(const String& toolResultsJson);
+#endif
+
+#ifdef ENABLE_TOOL_CALLS
+    // Converts _tcToolsArray with the active handler into _tcToolsJson
+    bool _buildTCToolsJson();
+#endif
+    static String _extractHost(const String& url);
+    // Move doc and its contents to allocator (nullptr: default heap)
+    static void _rebindDocument(JsonDocument& doc, ArduinoJson::Allocator* allocator);
 };
 
+#include "AI_API_Dispatcher.h"
+#include "AI_API_Router.h"
+
 #endif // ESP32_AI_CONNECT_H 
\ No newline at end of file
@@ -26,6 +26,45 @@
 #define ENABLE_DEBUG_OUTPUT
 #endif
 
+// --- Log Levels ---
+// Messages above AI_API_LOG_LEVEL are removed at compile time (see AI_API_Log.h).
+// Defaults to DEBUG with debug output enabled (requests and responses, no per-chunk lines)
+// and to NONE with DISABLE_DEBUG_OUTPUT. e.g. -DAI_API_LOG_LEVEL=AI_API_LOG_LEVEL_WARN
+#define AI_API_LOG_LEVEL_NONE    0
+#define AI_API_LOG_LEVEL_ERROR   1
+#define AI_API_LOG_LEVEL_WARN    2
+#define AI_API_LOG_LEVEL_INFO    3
+#define AI_API_LOG_LEVEL_DEBUG   4
+#define AI_API_LOG_LEVEL_VERBOSE 5       // Also every stream chunk and stream state change
+
+#ifndef AI_API_LOG_LEVEL
+#ifdef ENABLE_DEBUG_OUTPUT
+#define AI_API_LOG_LEVEL AI_API_LOG_LEVEL_DEBUG
+#else
+#define AI_API_LOG_LEVEL AI_API_LOG_LEVEL_NONE
+#endif
+#endif
+
+#ifndef AI_API_LOG_PREVIEW_BYTES
+#define AI_API_LOG_PREVIEW_BYTES 256     // Request and response bodies are logged up to this length
+#endif
+
+#ifndef AI_API_LOG_LINE_SIZE
+#define AI_API_LOG_LINE_SIZE (AI_API_LOG_PREVIEW_BYTES + 96) // Longer lines are cut (stack buffer)
+#endif
+
+#ifndef AI_API_LOG_BUFFER_SIZE
+#define AI_API_LOG_BUFFER_SIZE 0         // > 0: lines go through a ring buffer of this size, written by a task
+#endif
+
+#ifndef AI_API_LOG_TASK_PRIORITY
+#define AI_API_LOG_TASK_PRIORITY 1       // Writer task of the ring buffer (same as the Arduino loop task)
+#endif
+
+#ifndef AI_API_LOG_TASK_STACK_SIZE
+#define AI_API_LOG_TASK_STACK_SIZE 2048
+#endif
+
 // --- Tool Calls Support ---
 // Tool calls (function calling) support is ENABLED by default.
 // To disable: define DISABLE_TOOL_CALLS before including the library
@@ -35,6 +74,28 @@
 #define ENABLE_TOOL_CALLS
 #endif
 
+// --- Tool Handlers ---
+// Only used when ENABLE_TOOL_CALLS is defined (see setTCToolHandler / tcRunTools)
+#ifndef AI_API_TOOL_HANDLERS_MAX
+#define AI_API_TOOL_HANDLERS_MAX 8          // Tool handlers that can be registered
+#endif
+
+#ifndef AI_API_TOOL_PARALLEL_MAX
+#define AI_API_TOOL_PARALLEL_MAX 4          // Tool calls of one response executed at the same time
+#endif
+
+#ifndef AI_API_TOOL_TASK_STACK_SIZE
+#define AI_API_TOOL_TASK_STACK_SIZE 4096    // Stack of the tasks running tool handlers, in bytes
+#endif
+
+#ifndef AI_API_TOOL_TASK_PRIORITY
+#define AI_API_TOOL_TASK_PRIORITY 1         // Same as the Arduino loop task
+#endif
+
+#ifndef AI_API_TC_AGENT_MAX_STEPS
+#define AI_API_TC_AGENT_MAX_STEPS 4         // Default tool rounds of tcAgentChat()
+#endif
+
 // --- Streaming Chat Support ---
 // Streaming chat is ENABLED by default.
 // To disable: define DISABLE_STREAM_CHAT before including the library
@@ -50,13 +111,134 @@
 // or via build flags: -DSTREAM_CHAT_CHUNK_SIZE=1024
 
 #ifndef STREAM_CHAT_CHUNK_SIZE
-#define STREAM_CHAT_CHUNK_SIZE 512        // Size of each HTTP read chunk
+#define STREAM_CHAT_CHUNK_SIZE 1024       // Stream read buffer; longer SSE lines fall back to a heap String
 #endif
 
 #ifndef STREAM_CHAT_CHUNK_TIMEOUT_MS
 #define STREAM_CHAT_CHUNK_TIMEOUT_MS 5000 // Timeout for each chunk read
 #endif
 
+#ifndef STREAM_CHAT_WAIT_SLICE_MS
+#define STREAM_CHAT_WAIT_SLICE_MS 250     // Longest socket wait before checking stopStreaming()
+#endif
+
+#ifndef AI_API_STREAM_STOP_STRINGS_MAX
+#define AI_API_STREAM_STOP_STRINGS_MAX 4  // Stop strings checked locally per stream (see addStreamChatStopString)
+#endif
+
+// --- Streaming Tool Calls ---
+// streamTcChat() needs both tool calls and streaming chat
+#if defined(ENABLE_TOOL_CALLS) && defined(ENABLE_STREAM_CHAT)
+#define ENABLE_STREAM_TOOL_CALLS
+#endif
+
+#ifndef AI_API_STREAM_TOOL_CALLS_MAX
+#define AI_API_STREAM_TOOL_CALLS_MAX 4    // Tool calls assembled per streamed response; more are dropped
+#endif
+
+// --- Async Chat Support ---
+// Non-blocking chatAsync/streamChatAsync/tcChatAsync methods are ENABLED by default.
+// Requests are run one at a time by a FreeRTOS worker task, created on first use.
+// To disable: define DISABLE_ASYNC_CHAT before including the library
+// or use build flag: -DDISABLE_ASYNC_CHAT
+#ifndef DISABLE_ASYNC_CHAT
+#define ENABLE_ASYNC_CHAT
+#endif
+
+// --- Async Worker Configuration ---
+// Only used when ENABLE_ASYNC_CHAT is defined. Override via build flags,
+// e.g. -DAI_API_ASYNC_TASK_CORE=1
+
+#ifndef AI_API_ASYNC_TASK_STACK_SIZE
+#define AI_API_ASYNC_TASK_STACK_SIZE 8192  // Worker stack in bytes (TLS needs several KB)
+#endif
+
+#ifndef AI_API_ASYNC_TASK_PRIORITY
+#define AI_API_ASYNC_TASK_PRIORITY 1       // Same as the Arduino loop task
+#endif
+
+#ifndef AI_API_ASYNC_TASK_CORE
+#define AI_API_ASYNC_TASK_CORE 0           // Arduino loop() runs on core 1
+#endif
+
+#ifndef AI_API_ASYNC_QUEUE_LENGTH
+#define AI_API_ASYNC_QUEUE_LENGTH 4        // Requests waiting for the worker, and undelivered results
+#endif
+
+#ifndef AI_API_DISPATCHER_MAX_CONNECTIONS
+#define AI_API_DISPATCHER_MAX_CONNECTIONS 2  // Default TLS connections shared by an AI_API_Dispatcher
+#endif
+
+#ifndef AI_API_DISPATCHER_QUEUE_LENGTH
+#define AI_API_DISPATCHER_QUEUE_LENGTH 8     // Default requests an AI_API_Dispatcher can hold
+#endif
+
+// --- Response Cache Support ---
+// The optional cache of chat() replies (setResponseCache) is ENABLED by default.
+// It stays inactive until setResponseCache() is called.
+// To disable: define DISABLE_RESPONSE_CACHE before including the library
+// or use build flag: -DDISABLE_RESPONSE_CACHE
+#ifndef DISABLE_RESPONSE_CACHE
+#define ENABLE_RESPONSE_CACHE
+#endif
+
+#ifndef AI_API_RESPONSE_CACHE_DIR
+#define AI_API_RESPONSE_CACHE_DIR "/ai_cache" // Default directory of the file tier
+#endif
+
+// --- State Save Support ---
+// saveState()/restoreState() (settings, tools and conversation as MessagePack, e.g. to
+// resume after deep sleep) are ENABLED by default.
+// To disable: define DISABLE_STATE_SAVE before including the library
+// or use build flag: -DDISABLE_STATE_SAVE
+#ifndef DISABLE_STATE_SAVE
+#define ENABLE_STATE_SAVE
+#endif
+
+// --- Router Configuration ---
+// Defaults of AI_API_Router (multi-provider failover). Override via build flags,
+// e.g. -DAI_API_ROUTER_MAX_TARGETS=6
+
+#ifndef AI_API_ROUTER_MAX_TARGETS
+#define AI_API_ROUTER_MAX_TARGETS 4        // Targets one router can hold
+#endif
+
+#ifndef AI_API_ROUTER_FAILURE_THRESHOLD
+#define AI_API_ROUTER_FAILURE_THRESHOLD 3  // Consecutive failures before a target cools down
+#endif
+
+#ifndef AI_API_ROUTER_COOLDOWN_MS
+#define AI_API_ROUTER_COOLDOWN_MS 30000    // Time an unhealthy target is skipped
+#endif
+
+// --- Fixed Platform Build ---
+// By default the platform is chosen at runtime by begin("openai", ...).
+// If a project only ever uses one provider, define AI_CONNECT_FIXED_PLATFORM to bind
+// it at compile time: the other handlers are not compiled, the handler is a member
+// instead of a heap allocation, and calls to it are no longer virtual.
+//   #define AI_CONNECT_FIXED_PLATFORM AI_PLATFORM_CLAUDE
+// or use build flag: -DAI_CONNECT_FIXED_PLATFORM=AI_PLATFORM_CLAUDE
+// begin() then only accepts that platform's identifier.
+#define AI_PLATFORM_OPENAI   1   // "openai" and "openai-compatible"
+#define AI_PLATFORM_GEMINI   2   // "gemini"
+#define AI_PLATFORM_DEEPSEEK 3   // "deepseek"
+#define AI_PLATFORM_CLAUDE   4   // "claude"
+
+#ifdef AI_CONNECT_FIXED_PLATFORM
+#if AI_CONNECT_FIXED_PLATFORM != AI_PLATFORM_OPENAI && !defined(DISABLE_AI_API_OPENAI)
+#define DISABLE_AI_API_OPENAI
+#endif
+#if AI_CONNECT_FIXED_PLATFORM != AI_PLATFORM_GEMINI && !defined(DISABLE_AI_API_GEMINI)
+#define DISABLE_AI_API_GEMINI
+#endif
+#if AI_CONNECT_FIXED_PLATFORM != AI_PLATFORM_DEEPSEEK && !defined(DISABLE_AI_API_DEEPSEEK)
+#define DISABLE_AI_API_DEEPSEEK
+#endif
+#if AI_CONNECT_FIXED_PLATFORM != AI_PLATFORM_CLAUDE && !defined(DISABLE_AI_API_CLAUDE)
+#define DISABLE_AI_API_CLAUDE
+#endif
+#endif // AI_CONNECT_FIXED_PLATFORM
+
 // --- Platform Selection ---
 // All platforms are ENABLED by default.
 // To disable a platform: define DISABLE_AI_API_<PLATFORM> before including
@@ -92,8 +274,44 @@
 #define AI_API_RESP_JSON_DOC_SIZE 2048
 #endif
 
+// --- Memory Allocation ---
+// The request and response documents use the default heap unless setAllocator() is
+// called, e.g. ai.setAllocator(AI_API_Psram_Allocator::instance()).
+// To make PSRAM the default for every instance: define AI_API_USE_PSRAM
+// or use build flag: -DAI_API_USE_PSRAM
+// Streamed chunks are parsed using a small pool of internal-RAM blocks shared by all instances.
+
+#ifndef AI_API_CHUNK_POOL_BLOCK_SIZE
+#define AI_API_CHUNK_POOL_BLOCK_SIZE 1024 // Bytes per block; larger chunk documents use the heap
+#endif
+
+#ifndef AI_API_CHUNK_POOL_BLOCKS
+#define AI_API_CHUNK_POOL_BLOCKS 4        // A chunk document usually needs 2 (variants and strings)
+#endif
+
+#ifndef AI_API_REQUEST_WINDOW_SIZE
+#define AI_API_REQUEST_WINDOW_SIZE 1460 // Request body bytes serialized per pass while sending (HTTP_TCP_BUFFER_SIZE, see AI_API_Request_Stream.h)
+#endif
+
 #ifndef AI_API_HTTP_TIMEOUT_MS
 #define AI_API_HTTP_TIMEOUT_MS 30000 // 30 seconds
 #endif
 
+#ifndef AI_API_STALE_CONNECTION_MS
+#define AI_API_STALE_CONNECTION_MS 500 // A reused socket lost this soon after sending, with no reply byte, was stale
+#endif
+
+// Retry policy defaults (see setRetryPolicy); 1 attempt = no retries
+#ifndef AI_API_RETRY_MAX_ATTEMPTS
+#define AI_API_RETRY_MAX_ATTEMPTS 1
+#endif
+
+#ifndef AI_API_RETRY_BASE_DELAY_MS
+#define AI_API_RETRY_BASE_DELAY_MS 1000   // First backoff, doubled on every further attempt
+#endif
+
+#ifndef AI_API_RETRY_MAX_DELAY_MS
+#define AI_API_RETRY_MAX_DELAY_MS 30000   // Longest wait between attempts
+#endif
+
 #endif // ESP32_AI_CONNECT_CONFIG_H
\ No newline at end of file